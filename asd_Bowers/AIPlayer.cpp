@@ -1,130 +1,405 @@
 #include "AIPlayer.h"
 #include <algorithm>
 #include <climits>
+#include "Trace.h"
 
-AIPlayer::AIPlayer(Player player, int depth) : aiPlayer(player), maxDepth(depth) {}
+namespace {
+    const int DRAW_SCORE = 0;
+    const int MAX_NETWORK_SCORE = 9000;     // clear of the won and lost scores
+    const int SCORE_INFINITE = INT_MAX;     // window bound, negates without overflow
 
-int AIPlayer::evaluate(const GameBoard& board) const {
-    if (board.isGameOver()) {
-        Player winner = board.getWinner();
-        if (winner == aiPlayer) return 10000;
-        if (winner != NONE) return -10000;
+    constexpr Player opponentOf(Player player) { return (player == PLAYER1) ? PLAYER2 : PLAYER1; }
+}
+
+AIPlayer::AIPlayer(Player player, int depth) : aiPlayer(player), maxDepth(depth), nodes(0),
+proofTable(nullptr), tablebases(nullptr), network(nullptr), useNetwork(false), rootMoves(nullptr), stopFlag(nullptr),
+aborted(false) {}
+
+void AIPlayer::initBatchWeights(const BoardTopology& topology, BatchEvalWeights& weights) const {
+    Player opponent = (aiPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+    int aiTargetRow = topology.goalRow[aiPlayer];
+    int oppTargetRow = topology.goalRow[opponent];
+    int maxDist = topology.rows - 1;
+
+    weights.aiPlayer = aiPlayer;
+    weights.cellCount = topology.nodeCount();
+    weights.goalMask[NONE] = 0;
+    weights.goalMask[PLAYER1] = topology.goalMask[PLAYER1];
+    weights.goalMask[PLAYER2] = topology.goalMask[PLAYER2];
+    weights.killedWeight = 150;
+    weights.winScore = 10000;
+
+    // Same terms as evaluate(): a piece on the target row is worth 500 plus
+    // the 100 per-piece bonus, anything else 20 per row of progress.
+    for (int cell = 0; cell < weights.cellCount; cell++) {
+        int r = topology.nodePosition(cell).row;
+        weights.aiCell[cell] = (int16_t)((r == aiTargetRow) ? 600 : (maxDist - abs(r - aiTargetRow)) * 20);
+        weights.oppCell[cell] = (int16_t)((r == oppTargetRow) ? 600 : (maxDist - abs(r - oppTargetRow)) * 20);
     }
+}
+
+void AIPlayer::evaluateBatch(const PositionBatch& batch, int* scores) const {
+    BatchEvalWeights weights;
+    initBatchWeights(batch.getTopology(), weights);
+    evaluatePositionBatch(weights, batch, scores);
+}
+
+template <Player Us, typename Layout>
+int AIPlayer::evaluateOn(const Layout& layout, const GameBoard& board) const {
+    constexpr Player Them = opponentOf(Us);
+
+    Player winner = board.getWinner();
+    if (winner == Us) return 10000;
+    if (winner != NONE) return -10000;
 
     int score = 0;
-    Player opponent = (aiPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
 
-    int aiTargetRow = (aiPlayer == PLAYER1) ? 4 : 0;
-    int oppTargetRow = (opponent == PLAYER1) ? 4 : 0;
-
-    int aiOnTarget = 0, oppOnTarget = 0;
-    int aiProgress = 0, oppProgress = 0;
-
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            int cell = board.getCell(Position(r, c));
-
-            if (cell == aiPlayer) {
-                if (r == aiTargetRow) {
-                    aiOnTarget++;
-                    score += 500;
-                }
-                else {
-                    int dist = abs(r - aiTargetRow);
-                    aiProgress += (4 - dist);
-                    score += (4 - dist) * 20;
-                }
-            }
-            else if (cell == opponent) {
-                if (r == oppTargetRow) {
-                    oppOnTarget++;
-                    score -= 500;
-                }
-                else {
-                    int dist = abs(r - oppTargetRow);
-                    oppProgress += (4 - dist);
-                    score -= (4 - dist) * 20;
-                }
-            }
+    // Constants on the standard board
+    const int ourTargetRow = layout.goalRow(Us);
+    const int theirTargetRow = layout.goalRow(Them);
+    const int maxDist = layout.rows() - 1;
+
+    NodeMask ourPieces = board.getPieces(Us);
+    NodeMask theirPieces = board.getPieces(Them);
+
+    int ourOnTarget = 0, theirOnTarget = 0;
+
+    for (int r = 0; r < layout.rows(); r++) {
+        int ourCount = countNodes(ourPieces & layout.rowMask(r));
+        int theirCount = countNodes(theirPieces & layout.rowMask(r));
+
+        if (r == ourTargetRow) {
+            ourOnTarget += ourCount;
+            score += ourCount * 500;
+        }
+        else {
+            score += ourCount * (maxDist - abs(r - ourTargetRow)) * 20;
+        }
+
+        if (r == theirTargetRow) {
+            theirOnTarget += theirCount;
+            score -= theirCount * 500;
+        }
+        else {
+            score -= theirCount * (maxDist - abs(r - theirTargetRow)) * 20;
         }
     }
 
-    score += aiOnTarget * 100;
-    score -= oppOnTarget * 100;
+    score += ourOnTarget * 100;
+    score -= theirOnTarget * 100;
 
-    int aiKilled = board.getKilledUnits(aiPlayer);
-    int oppKilled = board.getKilledUnits(opponent);
-    score -= aiKilled * 150;
-    score += oppKilled * 150;
+    score -= board.getKilledUnits(Us) * 150;
+    score += board.getKilledUnits(Them) * 150;
 
     return score;
 }
 
-int AIPlayer::minimax(GameBoard& board, int depth, int alpha, int beta, bool maximizing) {
+template <Player Us>
+int AIPlayer::evaluateFor(const GameBoard& board) const {
+    if (useNetwork) {
+        Player winner = board.getWinner();
+        if (winner == Us) return 10000;
+        if (winner != NONE) return -10000;
+
+        int score = std::clamp(network->evaluate(board.getAccumulator(), board.getCurrentPlayer()),
+            -MAX_NETWORK_SCORE, MAX_NETWORK_SCORE);
+        return (board.getCurrentPlayer() == Us) ? score : -score;
+    }
+    if (board.getTopology().isStandard()) {
+        return evaluateOn<Us>(StandardLayout(), board);
+    }
+    return evaluateOn<Us>(TopologyLayout{ &board.getTopology() }, board);
+}
+
+int AIPlayer::evaluate(const GameBoard& board) const {
+    return (aiPlayer == PLAYER1) ? evaluateFor<PLAYER1>(board) : evaluateFor<PLAYER2>(board);
+}
+
+template <Player Us, NodeType Type>
+int AIPlayer::negamax(GameBoard& board, int depth, int alpha, int beta) {
+    constexpr Player Them = opponentOf(Us);
+
+    // Every root move gets the full window, so its score is exact
+    if constexpr (Type == NODE_ROOT) {
+        rootBestMove = (*rootMoves)[0];
+        int bestScore = INT_MIN;
+
+        for (const auto& move : *rootMoves) {
+            MoveUndo undo;
+            board.makeMoveAs<Us>(move, undo);
+            board.switchPlayer();
+
+            searchPath.push(board.getHash());
+            int score = -negamax<Them, NODE_PV>(board, depth - 1, -beta, -alpha);
+            searchPath.pop();
+
+            board.switchPlayer();
+            board.unmakeMoveAs<Us>(move, undo);
+
+            if (aborted) break;
+
+            if (score > bestScore) {
+                bestScore = score;
+                rootBestMove = move;
+            }
+        }
+        return bestScore;
+    }
+
+    nodes++;
+
+    if (aborted || ((nodes & 1023) == 0 && shouldStop())) {
+        aborted = true;
+        return 0;
+    }
+
+    if (searchPath.isRepetition()) {
+        return DRAW_SCORE;
+    }
+    if (drawRules.moveLimit > 0 && searchPath.plies() >= drawRules.moveLimit) {
+        return DRAW_SCORE;
+    }
+
+    if (proofTable && proofBeatsMoveLimit(searchPath.plies()) && proofTable->probe(board.getHash()) == PROOF_WIN) {
+        return (proofTable->getAttacker() == Us) ? 10000 : -10000;
+    }
+
+    if (tablebases) {
+        TablebaseProbe probe = tablebases->probe(board);
+        if (probe.outcome != TB_UNKNOWN) {
+            if (probe.outcome != TB_DRAW && drawRules.moveLimit > 0 && searchPath.plies() + probe.plies >= drawRules.moveLimit) {
+                return DRAW_SCORE;
+            }
+            return (probe.outcome == TB_WIN) ? 10000 - probe.plies :
+                (probe.outcome == TB_LOSS) ? probe.plies - 10000 : DRAW_SCORE;
+        }
+    }
+
+    // Units that can no longer meet just race for their goal rows. Not at
+    // the leaves, which are most of the nodes: the evaluation covers them
+    RaceResult race;
+    if (depth > 0 && raceSolver->probe(board, race)) {
+        if (drawRules.moveLimit > 0 && searchPath.plies() + race.plies >= drawRules.moveLimit) {
+            return DRAW_SCORE;
+        }
+        return (race.winner == Us) ? 10000 - race.plies : race.plies - 10000;
+    }
+
     if (depth == 0 || board.isGameOver()) {
-        return evaluate(board);
+        return evaluateFor<Us>(board);
     }
 
-    std::vector<Move> moves = board.getLegalMoves();
+    // Each depth has its own buffer; depth strictly decreases along a line
+    std::vector<Move>& moves = moveLists[depth];
+    board.getLegalMoves(moves);
 
     if (moves.empty()) {
-        return evaluate(board);
+        return evaluateFor<Us>(board);
     }
 
-    if (maximizing) {
-        int maxEval = INT_MIN;
-        for (const auto& move : moves) {
-            GameBoard newBoard = board;
-            newBoard.makeMove(move);
-            newBoard.switchPlayer();
+    int bestScore = -SCORE_INFINITE;
+    for (size_t i = 0; i < moves.size(); i++) {
+        const Move& move = moves[i];
+        MoveUndo undo;
+        board.makeMoveAs<Us>(move, undo);
+        board.switchPlayer();
 
-            int eval = minimax(newBoard, depth - 1, alpha, beta, false);
-            maxEval = std::max(maxEval, eval);
-            alpha = std::max(alpha, eval);
+        searchPath.push(board.getHash());
+        int score = (Type == NODE_PV && i == 0) ? -negamax<Them, NODE_PV>(board, depth - 1, -beta, -alpha) :
+            -negamax<Them, NODE_NON_PV>(board, depth - 1, -beta, -alpha);
+        searchPath.pop();
 
-            if (beta <= alpha) break;
-        }
-        return maxEval;
+        board.switchPlayer();
+        board.unmakeMoveAs<Us>(move, undo);
+        bestScore = std::max(bestScore, score);
+        alpha = std::max(alpha, score);
+
+        if (alpha >= beta) break;
+    }
+    return bestScore;
+}
+
+void AIPlayer::startSearch(GameBoard& board, const PositionHistory* history) {
+    nodes = 1;
+    aborted = false;
+    searchStart = std::chrono::steady_clock::now();
+
+    if (!raceSolver || &raceSolver->getTopology() != &board.getTopology()) {
+        raceSolver.reset(new RaceSolver(board.getTopology()));
+    }
+
+    useNetwork = network && network->matches(board.getTopology());
+    if (useNetwork && board.getNetwork() != network) {
+        board.setNetwork(network);
+    }
+
+    if (history && !history->empty() && history->top() == board.getHash()) {
+        searchPath = *history;
     }
     else {
-        int minEval = INT_MAX;
-        for (const auto& move : moves) {
-            GameBoard newBoard = board;
-            newBoard.makeMove(move);
-            newBoard.switchPlayer();
+        searchPath.clear();
+        searchPath.push(board.getHash());
+    }
+}
 
-            int eval = minimax(newBoard, depth - 1, alpha, beta, true);
-            minEval = std::min(minEval, eval);
-            beta = std::min(beta, eval);
+int AIPlayer::searchRoot(GameBoard& board, const std::vector<Move>& moves, int depth, Move& bestMove) {
+    TRACE_SCOPE_ARG("search.iteration", "depth", depth);
+    rootMoves = &moves;
 
-            if (beta <= alpha) break;
+    int score = (board.getCurrentPlayer() == PLAYER1) ?
+        negamax<PLAYER1, NODE_ROOT>(board, depth, -SCORE_INFINITE, SCORE_INFINITE) :
+        negamax<PLAYER2, NODE_ROOT>(board, depth, -SCORE_INFINITE, SCORE_INFINITE);
+
+    rootMoves = nullptr;
+    bestMove = rootBestMove;
+    return score;
+}
+
+// A proven win is kept by any move into another proven win. The proof
+// only bounds how long the win takes, so the evaluation picks among those
+// moves to keep making progress.
+bool AIPlayer::findProvenMove(GameBoard& board, const std::vector<Move>& moves, Move& move) {
+    if (!proofTable || proofTable->getAttacker() != aiPlayer) return false;
+    if (!proofBeatsMoveLimit(searchPath.plies() + 1)) return false;
+    if (proofTable->probe(board.getHash()) != PROOF_WIN) return false;
+
+    bool found = false;
+    int bestScore = INT_MIN;
+    for (const auto& candidate : moves) {
+        MoveUndo undo;
+        board.makeMove(candidate, undo);
+        board.switchPlayer();
+
+        // Proven positions can reach each other; the game must not go round in circles
+        bool proven = board.getWinner() == aiPlayer ||
+            (proofTable->probe(board.getHash()) == PROOF_WIN && searchPath.count(board.getHash()) == 0);
+        int score = proven ? evaluate(board) : INT_MIN;
+
+        board.switchPlayer();
+        board.unmakeMove(candidate, undo);
+
+        if (proven && (!found || score > bestScore)) {
+            found = true;
+            bestScore = score;
+            move = candidate;
         }
-        return minEval;
     }
+    return found;
+}
+
+// Proofs ignore the move limit; they only bound how long the win takes.
+// Past that bound a proven win may still be drawn by the limit.
+bool AIPlayer::proofBeatsMoveLimit(int plies) const {
+    return drawRules.moveLimit <= 0 || plies + proofTable->getMaxPlies() < drawRules.moveLimit;
+}
+
+bool AIPlayer::shouldStop() {
+    if (stopFlag && stopFlag->load(std::memory_order_relaxed)) return true;
+    if (limits.nodes > 0 && nodes >= limits.nodes) return true;
+    if (limits.moveTimeMs > 0 && elapsedMs() >= limits.moveTimeMs) return true;
+    return false;
 }
 
-Move AIPlayer::getBestMove(GameBoard& board) {
+int64_t AIPlayer::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - searchStart).count();
+}
+
+Move AIPlayer::getBestMove(GameBoard& board, const PositionHistory* history) {
+    TRACE_SCOPE("search");
+    nodes = 1;
+
+    std::vector<Move> moves = board.getLegalMoves();
+
+    if (moves.empty()) {
+        return Move::pass();
+    }
+
+    startSearch(board, history);
+
+    Move bestMove;
+    if (findProvenMove(board, moves, bestMove)) return bestMove;
+    searchRoot(board, moves, maxDepth, bestMove);
+
+    return bestMove;
+}
+
+Move AIPlayer::search(GameBoard& board, const SearchLimits& searchLimits, const PositionHistory* history,
+    const std::atomic<bool>* stop, const SearchInfoCallback& onInfo) {
+    TRACE_SCOPE("search");
+    nodes = 1;
+
     std::vector<Move> moves = board.getLegalMoves();
 
     if (moves.empty()) {
-        return Move();
+        return Move::pass();
     }
 
+    limits = searchLimits;
+    stopFlag = stop;
+    startSearch(board, history);
+
     Move bestMove = moves[0];
-    int bestScore = INT_MIN;
+    if (findProvenMove(board, moves, bestMove)) {
+        if (onInfo) {
+            SearchInfo info;
+            info.depth = 0;
+            info.score = 10000;
+            info.nodes = nodes;
+            info.timeMs = elapsedMs();
+            info.bestMove = bestMove;
+            onInfo(info);
+        }
+        limits = SearchLimits();
+        stopFlag = nullptr;
+        return bestMove;
+    }
 
-    for (const auto& move : moves) {
-        GameBoard newBoard = board;
-        newBoard.makeMove(move);
-        newBoard.switchPlayer();
+    int depthLimit = (limits.depth > 0) ? std::min(limits.depth, MAX_SEARCH_DEPTH) : MAX_SEARCH_DEPTH;
 
-        int score = minimax(newBoard, maxDepth - 1, INT_MIN, INT_MAX, false);
+    for (int depth = 1; depth <= depthLimit; depth++) {
+        Move iterationBest;
+        int score = searchRoot(board, moves, depth, iterationBest);
 
-        if (score > bestScore) {
-            bestScore = score;
-            bestMove = move;
+        // An interrupted iteration has not looked at every root move
+        if (aborted) break;
+
+        bestMove = iterationBest;
+
+        if (onInfo) {
+            SearchInfo info;
+            info.depth = depth;
+            info.score = score;
+            info.nodes = nodes;
+            info.timeMs = elapsedMs();
+            info.bestMove = bestMove;
+            onInfo(info);
         }
+
+        // A won or lost position needs no deeper look
+        if (score >= 10000 || score <= -10000) break;
     }
 
+    limits = SearchLimits();
+    stopFlag = nullptr;
+
     return bestMove;
 }
+
+bool AIPlayer::searchMove(GameBoard& board, const Move& move, int depth, int& score,
+    const PositionHistory* history, const std::atomic<bool>* stop) {
+    TRACE_SCOPE_ARG("search.move", "depth", depth);
+    nodes = 1;
+
+    limits = SearchLimits();
+    stopFlag = stop;
+    startSearch(board, history);
+
+    // A root of one move searches it with the full window
+    std::vector<Move> moves(1, move);
+    Move unused;
+    score = searchRoot(board, moves, std::max(1, depth), unused);
+
+    stopFlag = nullptr;
+    return !aborted;
+}
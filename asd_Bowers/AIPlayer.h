@@ -1,15 +1,118 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include "GameBoard.h"
+#include "Nnue.h"
+#include "PositionBatch.h"
+#include "PositionHistory.h"
+#include "ProofTable.h"
+#include "RaceSolver.h"
+#include "Tablebase.h"
+
+const int MAX_SEARCH_DEPTH = 64;
+
+// Limits for AIPlayer::search; 0 means unlimited.
+struct SearchLimits {
+    int depth;
+    int64_t moveTimeMs;
+    uint64_t nodes;
+
+    SearchLimits() : depth(0), moveTimeMs(0), nodes(0) {}
+};
+
+// Reported after every completed iteration of AIPlayer::search
+struct SearchInfo {
+    int depth;
+    int score;
+    uint64_t nodes;
+    int64_t timeMs;
+    Move bestMove;
+};
+
+typedef std::function<void(const SearchInfo&)> SearchInfoCallback;
+
+// Node kinds of the search tree. The root searches every move with the
+// full window; the first child of a PV node is a PV node, the rest are not.
+enum NodeType { NODE_ROOT, NODE_PV, NODE_NON_PV };
 
 class AIPlayer {
 private:
     Player aiPlayer;
     int maxDepth;
+    uint64_t nodes;
+    DrawRules drawRules;
+    PositionHistory searchPath;
+    const ProofTable* proofTable;
+    const TablebaseSet* tablebases;
+    const NnueNetwork* network;
+    bool useNetwork;                            // network matches the board of the current search
+    std::unique_ptr<RaceSolver> raceSolver;     // for the board of the current search
+    std::vector<Move> moveLists[MAX_SEARCH_DEPTH + 1];
+    const std::vector<Move>* rootMoves;         // searched by the NODE_ROOT node
+    Move rootBestMove;
+
+    SearchLimits limits;
+    const std::atomic<bool>* stopFlag;
+    std::chrono::steady_clock::time_point searchStart;
+    bool aborted;
 
+    // Scores for Us; evaluate() scores for aiPlayer
+    template <Player Us, typename Layout> int evaluateOn(const Layout& layout, const GameBoard& board) const;
+    template <Player Us> int evaluateFor(const GameBoard& board) const;
     int evaluate(const GameBoard& board) const;
-    int minimax(GameBoard& board, int depth, int alpha, int beta, bool maximizing);
+    void initBatchWeights(const BoardTopology& topology, BatchEvalWeights& weights) const;
+
+    // Scores for Us, the side to move
+    template <Player Us, NodeType Type> int negamax(GameBoard& board, int depth, int alpha, int beta);
+    void startSearch(GameBoard& board, const PositionHistory* history);
+    int searchRoot(GameBoard& board, const std::vector<Move>& moves, int depth, Move& bestMove);
+    bool findProvenMove(GameBoard& board, const std::vector<Move>& moves, Move& move);
+    bool proofBeatsMoveLimit(int plies) const;
+    bool shouldStop();
+    int64_t elapsedMs() const;
 
 public:
     AIPlayer(Player player, int depth = 3);
-    Move getBestMove(GameBoard& board);
+    void setDrawRules(const DrawRules& rules) { drawRules = rules; }
+    void setDepth(int depth) { maxDepth = depth; }
+    int getDepth() const { return maxDepth; }
+
+    // Solved positions of a ProofSolver run, or nullptr. Proven wins score as
+    // won inside the search, and when this player is the proven winner at
+    // the root the proof is followed without searching. Must outlive use.
+    void setProofTable(const ProofTable* table) { proofTable = table; }
+
+    // Endgame tablebases, or nullptr. Positions they cover score exactly,
+    // a win in n plies as 10000 - n. Must outlive use.
+    void setTablebases(const TablebaseSet* tables) { tablebases = tables; }
+
+    // Evaluation network replacing the handcrafted evaluation, or nullptr.
+    // Used only on boards it was trained for; it is attached to the board
+    // being searched (GameBoard::setNetwork) and stays attached. The batch
+    // evaluator keeps the handcrafted terms. Must outlive use.
+    void setNetwork(const NnueNetwork* net) { network = net; }
+
+    // Positions visited by the last getBestMove, root included
+    uint64_t getNodeCount() const { return nodes; }
+
+    // history holds the game so far (ending with board); positions repeated
+    // from it or within the search line score as draws. A side without legal
+    // moves gets Move::pass().
+    Move getBestMove(GameBoard& board, const PositionHistory* history = nullptr);
+
+    // Iterative deepening until a limit is hit or *stop becomes true. The
+    // best move of the last completed iteration is returned.
+    Move search(GameBoard& board, const SearchLimits& searchLimits, const PositionHistory* history = nullptr,
+        const std::atomic<bool>* stop = nullptr, const SearchInfoCallback& onInfo = SearchInfoCallback());
+
+    // Exact score of one move of the side to move at depth (plies, the move
+    // included), for the side to move. False if *stop ended it first.
+    bool searchMove(GameBoard& board, const Move& move, int depth, int& score,
+        const PositionHistory* history = nullptr, const std::atomic<bool>* stop = nullptr);
+
+    // Scores every position in the batch from this player's point of view,
+    // identical to evaluate() per position. scores must hold batch.size() ints.
+    void evaluateBatch(const PositionBatch& batch, int* scores) const;
 };
@@ -0,0 +1,139 @@
+#include "Analysis.h"
+#include <algorithm>
+#include <climits>
+#include "Trace.h"
+
+AnalysisEngine::AnalysisEngine(int threadCount) : proofTable(nullptr), tablebases(nullptr), network(nullptr),
+quitting(false), version(0), nextJobId(1) {
+    result = AnalysisResult();
+
+    if (threadCount <= 0) threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&AnalysisEngine::threadLoop, this);
+    }
+}
+
+AnalysisEngine::~AnalysisEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quitting = true;
+        if (job) job->stop = true;
+    }
+    jobReady.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void AnalysisEngine::start(const GameBoard& board, const PositionHistory& history) {
+    std::shared_ptr<Job> next = std::make_shared<Job>(board);
+    next->history = history;
+    next->drawRules = drawRules;
+    next->proofTable = proofTable;
+    next->tablebases = tablebases;
+    next->network = network;
+    board.getLegalMoves(next->moves);
+    next->started = Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job) job->stop = true;
+
+        next->id = nextJobId++;
+        job = next->moves.empty() ? nullptr : next;
+
+        result = AnalysisResult();
+        for (const Move& move : next->moves) {
+            AnalysisLine line;
+            line.move = move;
+            line.score = 0;
+            line.depth = 0;
+            result.lines.push_back(line);
+        }
+        version++;
+    }
+    jobReady.notify_all();
+}
+
+void AnalysisEngine::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!job) return;
+
+    job->stop = true;
+    job = nullptr;
+    result = AnalysisResult();
+    version++;
+}
+
+bool AnalysisEngine::isRunning() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return job != nullptr;
+}
+
+bool AnalysisEngine::snapshot(uint64_t& known, AnalysisResult& copy) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (known == version) return false;
+
+    known = version;
+    copy = result;
+    return true;
+}
+
+void AnalysisEngine::threadLoop() {
+    TRACE_THREAD_NAME("analysis");
+    AIPlayer ai(PLAYER1);
+    uint64_t exhausted = 0;     // job this thread ran out of work on
+
+    while (true) {
+        std::shared_ptr<Job> current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [&] { return quitting || (job && job->id != exhausted); });
+            if (quitting) return;
+            current = job;
+        }
+
+        runJob(current, ai);
+        exhausted = current->id;
+    }
+}
+
+void AnalysisEngine::runJob(const std::shared_ptr<Job>& current, AIPlayer& ai) {
+    ai.setDrawRules(current->drawRules);
+    ai.setProofTable(current->proofTable);
+    ai.setTablebases(current->tablebases);
+    ai.setNetwork(current->network);
+
+    GameBoard board = current->board;
+    int count = (int)current->moves.size();
+
+    while (!current->stop.load(std::memory_order_relaxed)) {
+        int task = current->nextTask.fetch_add(1);
+        int depth = task / count + 1;
+        int index = task % count;
+        if (depth > MAX_SEARCH_DEPTH) return;
+
+        int score;
+        bool finished = ai.searchMove(board, current->moves[index], depth, score, &current->history, &current->stop);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job != current) return;
+
+        result.nodes += ai.getNodeCount();
+        if (!finished) return;
+
+        // A slow move of the previous depth can finish after a faster one of this depth
+        AnalysisLine& line = result.lines[index];
+        if (depth > line.depth) {
+            line.score = score;
+            line.depth = depth;
+        }
+
+        int reached = INT_MAX;
+        for (const AnalysisLine& other : result.lines) reached = std::min(reached, other.depth);
+        result.depth = reached;
+        result.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - current->started).count();
+        version++;
+    }
+}
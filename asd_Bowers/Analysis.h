@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AIPlayer.h"
+
+// Score of one legal move, for the side to move
+struct AnalysisLine {
+    Move move;
+    int score;
+    int depth;                  // 0 until the first search of the move finished
+};
+
+struct AnalysisResult {
+    std::vector<AnalysisLine> lines;    // in legal move order
+    int depth;                  // every line is searched at least this deep
+    uint64_t nodes;
+    int64_t timeMs;
+};
+
+// Keeps analysing one position on a pool of threads until told otherwise.
+//
+// Every legal move is a root of its own, searched with the full window, so
+// each gets an exact score rather than a bound. The work is the sequence of
+// (depth, move) pairs in depth-major order; idle threads take the next
+// pair, so all moves finish depth n around the same time before depth n + 1.
+// Scores are published as each search finishes.
+//
+// start() only swaps the job and raises the stop flag of the old one; it
+// never waits for the threads, so the caller (the GUI thread) is not held up.
+class AnalysisEngine {
+public:
+    // threads = 0 uses one thread per core
+    explicit AnalysisEngine(int threads = 0);
+    ~AnalysisEngine();
+
+    AnalysisEngine(const AnalysisEngine&) = delete;
+    AnalysisEngine& operator=(const AnalysisEngine&) = delete;
+
+    // Search settings for the next start(); they must outlive use
+    void setDrawRules(const DrawRules& rules) { drawRules = rules; }
+    void setProofTable(const ProofTable* table) { proofTable = table; }
+    void setTablebases(const TablebaseSet* tables) { tablebases = tables; }
+    void setNetwork(const NnueNetwork* net) { network = net; }
+
+    // Analyses board from now on; history ends with board
+    void start(const GameBoard& board, const PositionHistory& history);
+    void stop();
+    bool isRunning() const;
+
+    // Copies the current scores if they changed since version, updating it
+    bool snapshot(uint64_t& version, AnalysisResult& result) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job {
+        uint64_t id;
+        GameBoard board;
+        PositionHistory history;
+        DrawRules drawRules;
+        const ProofTable* proofTable;
+        const TablebaseSet* tablebases;
+        const NnueNetwork* network;
+        std::vector<Move> moves;
+        std::atomic<bool> stop;
+        std::atomic<int> nextTask;      // depth-major index into (depth, move) pairs
+        Clock::time_point started;
+
+        explicit Job(const GameBoard& board) : id(0), board(board), proofTable(nullptr), tablebases(nullptr),
+            network(nullptr), stop(false), nextTask(0) {}
+    };
+
+    std::vector<std::thread> threads;
+    DrawRules drawRules;
+    const ProofTable* proofTable;
+    const TablebaseSet* tablebases;
+    const NnueNetwork* network;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobReady;
+    std::shared_ptr<Job> job;           // nullptr when stopped
+    bool quitting;
+
+    AnalysisResult result;              // of job
+    uint64_t version;
+    uint64_t nextJobId;
+
+    void threadLoop();
+    void runJob(const std::shared_ptr<Job>& current, AIPlayer& ai);
+};
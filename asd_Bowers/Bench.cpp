@@ -0,0 +1,63 @@
+#include "Bench.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "AIPlayer.h"
+#include "Notation.h"
+
+namespace {
+    const int DEFAULT_BENCH_DEPTH = 6;
+
+    const char* BENCH_POSITIONS[] = {
+        "11111/...../...../...../22222 1 0 0",
+        "..111/1..../.1.../...../..222 2 0 2",
+        ".111./.1.../...../....2/222.2 2 1 0",
+        "1..11/...1./...../.1.../2..2. 2 0 3",
+        ".1..1/..1../.1.../2...2/...2. 2 1 2",
+        "..111/...../.2.../...../..222 1 2 1",
+        "1..../.1.../...1./..1.2/2.... 2 1 3",
+        "....1/1..1./..2../...../2...2 2 2 2",
+        "1...1/...1./...../...../.22.2 1 2 2",
+        "...../..1../...../...../...2. 1 4 4",
+    };
+}
+
+int runBench(int depth) {
+    if (depth <= 0) depth = DEFAULT_BENCH_DEPTH;
+
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    int index = 0;
+    for (const char* text : BENCH_POSITIONS) {
+        index++;
+
+        GameBoard board;
+        std::string error;
+        if (!boardFromString(text, board, error)) {
+            fprintf(stderr, "bench position %d: %s\n", index, error.c_str());
+            return 1;
+        }
+
+        AIPlayer ai(board.getCurrentPlayer(), depth);
+        Move best = ai.getBestMove(board);
+        totalNodes += ai.getNodeCount();
+
+        printf("Position %2d: %-40s bestmove %-6s nodes %llu\n", index, text,
+            moveToString(best).c_str(), (unsigned long long)ai.getNodeCount());
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    unsigned long long nps = (seconds > 0.0) ? (unsigned long long)(totalNodes / seconds) : 0;
+
+    printf("===========================\n");
+    printf("Depth           : %d\n", depth);
+    printf("Total time (ms) : %.0f\n", seconds * 1000.0);
+    printf("Nodes searched  : %llu\n", (unsigned long long)totalNodes);
+    printf("Nodes/second    : %llu\n", nps);
+    printf("Signature       : %llu\n", (unsigned long long)totalNodes);
+    fflush(stdout);
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Searches a fixed suite of positions to a fixed depth and prints nodes, time
+// and nodes per second. The final node count is the bench signature: it only
+// changes when search behavior changes. depth <= 0 uses the default depth.
+int runBench(int depth);
@@ -0,0 +1,230 @@
+#include "BoardRenderer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Fractions of the cell size
+    const float NODE_RADIUS = 0.25f;
+    const float UNIT_RADIUS = 0.18f;
+    const float SELECT_RADIUS = 0.22f;
+    const float TARGET_INNER = 0.20f;
+    const float TARGET_OUTER = 0.30f;
+    const float HIT_RADIUS = 0.30f;
+    const float LINE_WIDTH = 0.012f;
+
+    const int MAX_SEGMENTS = 64;
+
+    const SDL_Color EDGE_COLOR = { 100, 80, 60, 255 };
+    const SDL_Color NODE_COLOR = { 200, 200, 200, 255 };
+    const SDL_Color START_COLOR[3] = { { 0, 0, 0, 0 }, { 100, 150, 255, 255 }, { 255, 100, 100, 255 } };
+    const SDL_Color UNIT_COLOR[3] = { { 0, 0, 0, 0 }, { 50, 100, 255, 255 }, { 255, 50, 50, 255 } };
+    const SDL_Color OUTLINE_COLOR = { 0, 0, 0, 255 };
+    const SDL_Color MARK_COLOR = { 255, 255, 0, 255 };
+
+    SDL_Vertex vertex(float x, float y, SDL_Color color) {
+        SDL_Vertex v;
+        v.position.x = x;
+        v.position.y = y;
+        v.color = color;
+        v.tex_coord.x = 0.0f;
+        v.tex_coord.y = 0.0f;
+        return v;
+    }
+}
+
+void GeometryBatch::append(const GeometryBatch& mesh, float dx, float dy) {
+    int base = (int)vertices.size();
+    for (const SDL_Vertex& v : mesh.vertices) {
+        SDL_Vertex moved = v;
+        moved.position.x += dx;
+        moved.position.y += dy;
+        vertices.push_back(moved);
+    }
+    for (int index : mesh.indices) indices.push_back(base + index);
+}
+
+void GeometryBatch::addRect(const SDL_FRect& rect, SDL_Color color) {
+    int base = (int)vertices.size();
+    vertices.push_back(vertex(rect.x, rect.y, color));
+    vertices.push_back(vertex(rect.x + rect.w, rect.y, color));
+    vertices.push_back(vertex(rect.x + rect.w, rect.y + rect.h, color));
+    vertices.push_back(vertex(rect.x, rect.y + rect.h, color));
+
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int i : quad) indices.push_back(base + i);
+}
+
+void GeometryBatch::addLine(SDL_FPoint from, SDL_FPoint to, float width, SDL_Color color) {
+    float dx = to.x - from.x, dy = to.y - from.y;
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length <= 0.0f) return;
+
+    // Half the width across the line
+    float nx = -dy / length * width * 0.5f, ny = dx / length * width * 0.5f;
+
+    int base = (int)vertices.size();
+    vertices.push_back(vertex(from.x + nx, from.y + ny, color));
+    vertices.push_back(vertex(to.x + nx, to.y + ny, color));
+    vertices.push_back(vertex(to.x - nx, to.y - ny, color));
+    vertices.push_back(vertex(from.x - nx, from.y - ny, color));
+
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int i : quad) indices.push_back(base + i);
+}
+
+void GeometryBatch::addDisc(SDL_FPoint center, float radius, const std::vector<SDL_FPoint>& circle, SDL_Color color) {
+    int base = (int)vertices.size();
+    int segments = (int)circle.size();
+
+    vertices.push_back(vertex(center.x, center.y, color));
+    for (const SDL_FPoint& p : circle) {
+        vertices.push_back(vertex(center.x + p.x * radius, center.y + p.y * radius, color));
+    }
+    for (int i = 0; i < segments; i++) {
+        indices.push_back(base);
+        indices.push_back(base + 1 + i);
+        indices.push_back(base + 1 + (i + 1) % segments);
+    }
+}
+
+void GeometryBatch::addRing(SDL_FPoint center, float inner, float outer, const std::vector<SDL_FPoint>& circle,
+    SDL_Color color) {
+    int base = (int)vertices.size();
+    int segments = (int)circle.size();
+
+    for (const SDL_FPoint& p : circle) {
+        vertices.push_back(vertex(center.x + p.x * inner, center.y + p.y * inner, color));
+        vertices.push_back(vertex(center.x + p.x * outer, center.y + p.y * outer, color));
+    }
+    for (int i = 0; i < segments; i++) {
+        int a = base + 2 * i, b = base + 2 * ((i + 1) % segments);
+        const int quad[6] = { a, a + 1, b + 1, a, b + 1, b };
+        for (int index : quad) indices.push_back(index);
+    }
+}
+
+void GeometryBatch::draw(SDL_Renderer* renderer) const {
+    if (empty()) return;
+    SDL_RenderGeometry(renderer, nullptr, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+}
+
+BoardRenderer::BoardRenderer(const BoardTopology& topology) : topology(topology), emptyWidth(-1.0f),
+emptyHeight(-1.0f), circles(MAX_SEGMENTS / 4 + 1) {}
+
+float BoardRenderer::cellSize(const SDL_FRect& area) const {
+    return std::min(area.w, area.h) / (float)std::max(topology.rows, topology.cols);
+}
+
+SDL_FPoint BoardRenderer::nodeCenter(const SDL_FRect& area, int node) const {
+    float cell = cellSize(area);
+    Position pos = topology.nodePosition(node);
+
+    // Grid centred in the area
+    SDL_FPoint center;
+    center.x = area.x + (area.w - cell * topology.cols) * 0.5f + (pos.col + 0.5f) * cell;
+    center.y = area.y + (area.h - cell * topology.rows) * 0.5f + (pos.row + 0.5f) * cell;
+    return center;
+}
+
+int BoardRenderer::nodeAt(const SDL_FRect& area, float x, float y) const {
+    float reach = cellSize(area) * HIT_RADIUS;
+    for (int node = 0; node < topology.nodeCount(); node++) {
+        SDL_FPoint center = nodeCenter(area, node);
+        float dx = x - center.x, dy = y - center.y;
+        if (dx * dx + dy * dy < reach * reach) return node;
+    }
+    return -1;
+}
+
+// Edges about 8 px long: the outline then strays from the true circle by
+// under a pixel
+const std::vector<SDL_FPoint>& BoardRenderer::circle(float radius) {
+    int segments = std::clamp((int)(radius * 0.8f) / 4 * 4, 8, MAX_SEGMENTS);
+    std::vector<SDL_FPoint>& points = circles[segments / 4];
+    if (points.empty()) {
+        for (int i = 0; i < segments; i++) {
+            double angle = 2.0 * 3.14159265358979 * i / segments;
+            points.push_back(SDL_FPoint{ (float)std::cos(angle), (float)std::sin(angle) });
+        }
+    }
+    return points;
+}
+
+void BoardRenderer::buildEmptyBoard(float width, float height) {
+    emptyBoard.clear();
+    emptyWidth = width;
+    emptyHeight = height;
+
+    SDL_FRect area = { 0.0f, 0.0f, width, height };
+    float cell = cellSize(area);
+    float line = std::max(1.0f, cell * LINE_WIDTH);
+
+    // Every link once, even where it is listed from both ends
+    for (int node = 0; node < topology.nodeCount(); node++) {
+        for (NodeMask m = topology.adjacencyMask[node]; m; m &= m - 1) {
+            int other = lowestNode(m);
+            if (other < node && (topology.adjacencyMask[other] & nodeBit(node))) continue;
+            emptyBoard.addLine(nodeCenter(area, node), nodeCenter(area, other), line, EDGE_COLOR);
+        }
+    }
+
+    const std::vector<SDL_FPoint>& nodeCircle = circle(cell * NODE_RADIUS);
+    for (int node = 0; node < topology.nodeCount(); node++) {
+        int row = topology.nodePosition(node).row;
+        SDL_Color color = NODE_COLOR;
+        if (row == topology.startRow[PLAYER1]) color = START_COLOR[PLAYER1];
+        if (row == topology.startRow[PLAYER2]) color = START_COLOR[PLAYER2];
+        emptyBoard.addDisc(nodeCenter(area, node), cell * NODE_RADIUS, nodeCircle, color);
+    }
+}
+
+void BoardRenderer::addRect(const SDL_FRect& rect, SDL_Color color, Layer layer) {
+    layers[layer].addRect(rect, color);
+}
+
+void BoardRenderer::addBoard(const SDL_FRect& area, const GameBoard& board, const BoardMarks& marks) {
+    addEmptyBoard(area);
+    addUnits(area, board, marks);
+}
+
+void BoardRenderer::addEmptyBoard(const SDL_FRect& area) {
+    if (area.w != emptyWidth || area.h != emptyHeight) {
+        buildEmptyBoard(area.w, area.h);
+    }
+    layers[LAYER_BOARD].append(emptyBoard, area.x, area.y);
+}
+
+void BoardRenderer::addUnits(const SDL_FRect& area, const GameBoard& board, const BoardMarks& marks) {
+    float cell = cellSize(area);
+    float line = std::max(1.0f, cell * LINE_WIDTH);
+
+    const std::vector<SDL_FPoint>& targetCircle = circle(cell * TARGET_OUTER);
+    for (NodeMask m = marks.targets; m; m &= m - 1) {
+        layers[LAYER_MARKS].addRing(nodeCenter(area, lowestNode(m)), cell * TARGET_INNER, cell * TARGET_OUTER,
+            targetCircle, MARK_COLOR);
+    }
+    if (marks.selected >= 0) {
+        layers[LAYER_MARKS].addRing(nodeCenter(area, marks.selected), cell * UNIT_RADIUS, cell * SELECT_RADIUS,
+            circle(cell * SELECT_RADIUS), MARK_COLOR);
+    }
+
+    const std::vector<SDL_FPoint>& unitCircle = circle(cell * UNIT_RADIUS);
+    for (int p = PLAYER1; p <= PLAYER2; p++) {
+        for (NodeMask m = board.getPieces((Player)p); m; m &= m - 1) {
+            SDL_FPoint center = nodeCenter(area, lowestNode(m));
+            layers[LAYER_UNITS].addDisc(center, cell * UNIT_RADIUS, unitCircle, UNIT_COLOR[p]);
+            layers[LAYER_UNITS].addRing(center, cell * UNIT_RADIUS - line, cell * UNIT_RADIUS, unitCircle, OUTLINE_COLOR);
+        }
+    }
+}
+
+void BoardRenderer::flush(SDL_Renderer* renderer) {
+    for (GeometryBatch& layer : layers) {
+        layer.draw(renderer);
+        layer.clear();
+    }
+}
+
+void BoardRenderer::clear() {
+    for (GeometryBatch& layer : layers) layer.clear();
+}
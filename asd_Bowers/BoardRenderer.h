@@ -0,0 +1,74 @@
+#pragma once
+#include <SDL.h>
+#include <vector>
+#include "GameBoard.h"
+
+// Triangles for one SDL_RenderGeometry call
+struct GeometryBatch {
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    void clear() { vertices.clear(); indices.clear(); }
+    bool empty() const { return indices.empty(); }
+
+    // Appends mesh moved by (dx, dy)
+    void append(const GeometryBatch& mesh, float dx, float dy);
+    void addRect(const SDL_FRect& rect, SDL_Color color);
+    void addLine(SDL_FPoint from, SDL_FPoint to, float width, SDL_Color color);
+    // circle holds segments unit vectors
+    void addDisc(SDL_FPoint center, float radius, const std::vector<SDL_FPoint>& circle, SDL_Color color);
+    void addRing(SDL_FPoint center, float inner, float outer, const std::vector<SDL_FPoint>& circle, SDL_Color color);
+
+    void draw(SDL_Renderer* renderer) const;
+};
+
+// What to mark on a board besides its units
+struct BoardMarks {
+    NodeMask targets;           // highlighted destinations
+    int selected;               // node of the selected unit, -1 if none
+
+    BoardMarks() : targets(0), selected(-1) {}
+};
+
+// Draws boards of one topology into any rectangle: the node grid is fitted
+// square into it and every size is derived from the cell size, so the same
+// code serves a full window and a thumbnail.
+//
+// Shapes are triangle meshes collected per layer; flush() submits each
+// layer with one SDL_RenderGeometry call however many boards were added.
+// The empty board (edges and nodes) is meshed once per area size and
+// copied for every board of that size.
+class BoardRenderer {
+public:
+    enum Layer { LAYER_BACKGROUND, LAYER_BOARD, LAYER_MARKS, LAYER_UNITS, LAYER_COUNT };
+
+    explicit BoardRenderer(const BoardTopology& topology);
+
+    const BoardTopology& getTopology() const { return topology; }
+
+    float cellSize(const SDL_FRect& area) const;
+    SDL_FPoint nodeCenter(const SDL_FRect& area, int node) const;
+    // Node drawn under the point, -1 if none
+    int nodeAt(const SDL_FRect& area, float x, float y) const;
+
+    void addRect(const SDL_FRect& rect, SDL_Color color, Layer layer = LAYER_BACKGROUND);
+    void addBoard(const SDL_FRect& area, const GameBoard& board, const BoardMarks& marks = BoardMarks());
+    // The two halves of addBoard, for callers that keep the empty board drawn
+    void addEmptyBoard(const SDL_FRect& area);
+    void addUnits(const SDL_FRect& area, const GameBoard& board, const BoardMarks& marks = BoardMarks());
+
+    // Draws the layers bottom up and empties them
+    void flush(SDL_Renderer* renderer);
+    void clear();
+
+private:
+    const BoardTopology& topology;
+    GeometryBatch layers[LAYER_COUNT];
+
+    GeometryBatch emptyBoard;                   // at the origin, for emptyWidth x emptyHeight
+    float emptyWidth, emptyHeight;
+    std::vector<std::vector<SDL_FPoint>> circles;   // unit circles by segment count / 4
+
+    const std::vector<SDL_FPoint>& circle(float radius);
+    void buildEmptyBoard(float width, float height);
+};
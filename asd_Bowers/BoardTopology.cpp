@@ -0,0 +1,186 @@
+#include "BoardTopology.h"
+#include <fstream>
+#include <sstream>
+
+BoardTopology::BoardTopology() : rows(0), cols(0) {
+    for (int p = 0; p < 3; p++) {
+        startRow[p] = goalRow[p] = -1;
+        startMask[p] = goalMask[p] = 0;
+    }
+    for (int n = 0; n < MAX_BOARD_NODES; n++) {
+        adjacencyMask[n] = 0;
+        reverseAdjacencyMask[n] = 0;
+    }
+}
+
+const BoardTopology& BoardTopology::standard() {
+    static const BoardTopology topology = [] {
+        BoardTopology t;
+        t.name = "standard";
+        t.rows = StandardBoard::ROWS;
+        t.cols = StandardBoard::COLS;
+        t.startRow[PLAYER1] = 0;
+        t.startRow[PLAYER2] = StandardBoard::ROWS - 1;
+        for (int n = 0; n < StandardBoard::NODES; n++) {
+            t.adjacencyMask[n] = StandardBoard::ADJACENCY[n];
+        }
+        t.buildTables();
+        return t;
+    }();
+    return topology;
+}
+
+void BoardTopology::buildTables() {
+    goalRow[NONE] = startRow[NONE] = -1;
+    goalRow[PLAYER1] = startRow[PLAYER2];
+    goalRow[PLAYER2] = startRow[PLAYER1];
+
+    rowMask.assign(rows, 0);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            rowMask[r] |= nodeBit(r * cols + c);
+        }
+    }
+
+    for (int p = PLAYER1; p <= PLAYER2; p++) {
+        startMask[p] = rowMask[startRow[p]];
+        goalMask[p] = rowMask[goalRow[p]];
+    }
+
+    // Neighbor lists in ascending node order; move generation and shooting
+    // both walk them in this order.
+    adjacency.assign(rows, std::vector<std::vector<Position>>(cols));
+    for (int n = 0; n < MAX_BOARD_NODES; n++) {
+        reverseAdjacencyMask[n] = 0;
+    }
+    for (int n = 0; n < nodeCount(); n++) {
+        Position from = nodePosition(n);
+        for (NodeMask m = adjacencyMask[n]; m; m &= m - 1) {
+            adjacency[from.row][from.col].push_back(nodePosition(lowestNode(m)));
+            reverseAdjacencyMask[lowestNode(m)] |= nodeBit(n);
+        }
+    }
+}
+
+bool BoardTopology::loadFromFile(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::stringstream text;
+    text << in.rdbuf();
+    return loadFromString(text.str(), error);
+}
+
+// Description format, one directive per line, '#' starts a comment:
+//   name <text>
+//   size <rows> <cols>
+//   start <player> <row>
+//   node <row> <col> : <row> <col>, <row> <col>, ...
+bool BoardTopology::loadFromString(const std::string& text, std::string& error) {
+    BoardTopology t;
+    bool haveSize = false;
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNo = 0;
+
+    while (std::getline(lines, line)) {
+        lineNo++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        for (char& ch : line) {
+            if (ch == ':' || ch == ',') ch = ' ';
+        }
+
+        std::istringstream in(line);
+        std::string key;
+        if (!(in >> key)) continue;
+
+        std::string where = "line " + std::to_string(lineNo) + ": ";
+
+        if (key == "name") {
+            std::getline(in >> std::ws, t.name);
+        }
+        else if (key == "size") {
+            if (!(in >> t.rows >> t.cols) || t.rows < 2 || t.cols < 1 || t.rows * t.cols > MAX_BOARD_NODES) {
+                error = where + "size must be at least 2x1 and at most " + std::to_string(MAX_BOARD_NODES) + " nodes";
+                return false;
+            }
+            haveSize = true;
+        }
+        else if (key == "start") {
+            int player, row;
+            if (!haveSize || !(in >> player >> row) || (player != PLAYER1 && player != PLAYER2) ||
+                row < 0 || row >= t.rows) {
+                error = where + "expected 'start <1|2> <row>' after size";
+                return false;
+            }
+            t.startRow[player] = row;
+        }
+        else if (key == "node") {
+            Position from;
+            if (!haveSize || !(in >> from.row >> from.col) || !t.isValidPosition(from)) {
+                error = where + "expected 'node <row> <col>' inside the board";
+                return false;
+            }
+
+            std::vector<int> coords;
+            int value;
+            while (in >> value) coords.push_back(value);
+            if (!in.eof() || coords.size() % 2 != 0) {
+                error = where + "malformed neighbor list";
+                return false;
+            }
+
+            for (size_t i = 0; i < coords.size(); i += 2) {
+                Position to(coords[i], coords[i + 1]);
+                if (!t.isValidPosition(to) || to == from) {
+                    error = where + "invalid neighbor";
+                    return false;
+                }
+                t.adjacencyMask[t.nodeIndex(from)] |= nodeBit(t.nodeIndex(to));
+            }
+        }
+        else {
+            error = where + "unknown directive '" + key + "'";
+            return false;
+        }
+    }
+
+    if (!haveSize) {
+        error = "missing size";
+        return false;
+    }
+    if (t.startRow[PLAYER1] < 0 || t.startRow[PLAYER2] < 0 || t.startRow[PLAYER1] == t.startRow[PLAYER2]) {
+        error = "both players need distinct start rows";
+        return false;
+    }
+
+    t.buildTables();
+    *this = t;
+    return true;
+}
+
+std::string BoardTopology::toString() const {
+    std::ostringstream out;
+    out << "name " << name << "\n";
+    out << "size " << rows << " " << cols << "\n";
+    out << "start 1 " << startRow[PLAYER1] << "\n";
+    out << "start 2 " << startRow[PLAYER2] << "\n";
+
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            out << "node " << r << " " << c << " :";
+            const auto& neighbors = adjacency[r][c];
+            for (size_t i = 0; i < neighbors.size(); i++) {
+                out << (i ? ", " : " ") << neighbors[i].row << " " << neighbors[i].col;
+            }
+            out << "\n";
+        }
+    }
+
+    return out.str();
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameTypes.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef uint64_t NodeMask;
+
+const int MAX_BOARD_NODES = 64;
+
+// Nodes are numbered row-major (row * cols + col), one bit per node in a NodeMask.
+constexpr NodeMask nodeBit(int node) { return NodeMask(1) << node; }
+
+inline int lowestNode(NodeMask mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, (unsigned long)mask)) return (int)index;
+    _BitScanForward(&index, (unsigned long)(mask >> 32));
+    return (int)index + 32;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+inline int countNodes(NodeMask mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(mask);
+#elif defined(_MSC_VER)
+    return (int)(__popcnt((unsigned int)mask) + __popcnt((unsigned int)(mask >> 32)));
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+// Board graph and row layout of a rule variant. Everything the rules need per
+// node is precomputed once when the topology is built or loaded.
+class BoardTopology {
+public:
+    std::string name;
+    int rows, cols;
+    int startRow[3];                // indexed by Player
+    int goalRow[3];                 // opponent's start row
+    NodeMask startMask[3];
+    NodeMask goalMask[3];
+    NodeMask adjacencyMask[MAX_BOARD_NODES];
+    NodeMask reverseAdjacencyMask[MAX_BOARD_NODES];     // nodes that list this one as a neighbor
+    std::vector<NodeMask> rowMask;
+    std::vector<std::vector<std::vector<Position>>> adjacency;
+
+    BoardTopology();
+
+    // The shipped 5x5 board; GameBoard and AIPlayer use compile-time tables
+    // (StandardLayout) whenever they run on this instance.
+    static const BoardTopology& standard();
+
+    bool loadFromFile(const std::string& path, std::string& error);
+    bool loadFromString(const std::string& text, std::string& error);
+    std::string toString() const;
+
+    bool isStandard() const { return this == &standard(); }
+    int nodeCount() const { return rows * cols; }
+    int nodeIndex(const Position& pos) const { return pos.row * cols + pos.col; }
+    Position nodePosition(int node) const { return Position(node / cols, node % cols); }
+    bool isValidPosition(const Position& pos) const {
+        return pos.row >= 0 && pos.row < rows && pos.col >= 0 && pos.col < cols;
+    }
+
+private:
+    void buildTables();
+};
+
+namespace StandardBoard {
+    const int ROWS = 5;
+    const int COLS = 5;
+    const int NODES = ROWS * COLS;
+
+    constexpr NodeMask at(int r, int c) { return nodeBit(r * COLS + c); }
+
+    constexpr NodeMask ROW_MASK[ROWS] = {
+        0x1FULL, 0x1FULL << 5, 0x1FULL << 10, 0x1FULL << 15, 0x1FULL << 20
+    };
+
+    constexpr NodeMask ADJACENCY[NODES] = {
+        // Row 0
+        at(1,0) | at(1,1),
+        at(0,0) | at(1,0) | at(1,1) | at(1,2) | at(2,1),
+        at(0,1) | at(1,1) | at(1,2) | at(1,3) | at(2,2),
+        at(0,2) | at(1,2) | at(1,3) | at(1,4) | at(2,3),
+        at(0,3) | at(1,3) | at(1,4) | at(2,3),
+
+        // Row 1
+        at(0,0) | at(0,1) | at(2,0) | at(2,1) | at(3,0),
+        at(0,1) | at(1,0) | at(2,1) | at(2,2) | at(3,1),
+        at(0,2) | at(1,1) | at(2,2) | at(2,3) | at(3,2),
+        at(0,3) | at(1,2) | at(2,3) | at(2,4) | at(3,3),
+        at(0,4) | at(1,3) | at(2,4) | at(3,3) | at(3,4),
+
+        // Row 2
+        at(1,0) | at(3,0),
+        at(0,1) | at(1,0) | at(1,1) | at(3,1) | at(4,1),
+        at(0,2) | at(1,1) | at(1,2) | at(3,2) | at(4,2),
+        at(0,3) | at(1,3) | at(1,4) | at(3,3) | at(4,3),
+        at(1,4) | at(3,4),
+
+        // Row 3
+        at(1,0) | at(2,0) | at(4,0) | at(4,1),
+        at(1,1) | at(2,1) | at(3,0) | at(4,1) | at(4,2),
+        at(1,2) | at(2,2) | at(3,1) | at(4,2) | at(4,3),
+        at(1,3) | at(2,3) | at(3,2) | at(4,3) | at(4,4),
+        at(1,4) | at(2,4) | at(3,3) | at(4,4),
+
+        // Row 4
+        at(3,0) | at(4,1),
+        at(2,1) | at(3,0) | at(3,1) | at(4,0) | at(4,2),
+        at(2,2) | at(3,2) | at(3,3) | at(4,1) | at(4,3),
+        at(2,3) | at(3,3) | at(3,4) | at(4,2) | at(4,4),
+        at(3,4) | at(4,3)
+    };
+}
+
+// Board layouts for the templated rule code. StandardLayout resolves every
+// query to a constant so the default board pays nothing for variant support;
+// TopologyLayout reads the tables of a loaded BoardTopology.
+struct StandardLayout {
+    constexpr int rows() const { return StandardBoard::ROWS; }
+    constexpr int cols() const { return StandardBoard::COLS; }
+    constexpr int nodeCount() const { return StandardBoard::NODES; }
+    constexpr NodeMask adjacency(int node) const { return StandardBoard::ADJACENCY[node]; }
+    constexpr NodeMask rowMask(int row) const { return StandardBoard::ROW_MASK[row]; }
+    constexpr int startRow(Player player) const { return (player == PLAYER1) ? 0 : StandardBoard::ROWS - 1; }
+    constexpr int goalRow(Player player) const { return (player == PLAYER1) ? StandardBoard::ROWS - 1 : 0; }
+    constexpr NodeMask startMask(Player player) const { return rowMask(startRow(player)); }
+    constexpr NodeMask goalMask(Player player) const { return rowMask(goalRow(player)); }
+};
+
+struct TopologyLayout {
+    const BoardTopology* topology;
+
+    int rows() const { return topology->rows; }
+    int cols() const { return topology->cols; }
+    int nodeCount() const { return topology->nodeCount(); }
+    NodeMask adjacency(int node) const { return topology->adjacencyMask[node]; }
+    NodeMask rowMask(int row) const { return topology->rowMask[row]; }
+    int startRow(Player player) const { return topology->startRow[player]; }
+    int goalRow(Player player) const { return topology->goalRow[player]; }
+    NodeMask startMask(Player player) const { return topology->startMask[player]; }
+    NodeMask goalMask(Player player) const { return topology->goalMask[player]; }
+};
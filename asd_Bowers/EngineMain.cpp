@@ -0,0 +1,322 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Bench.h"
+#include "EngineProtocol.h"
+#include "GameServer.h"
+#include "LoadTest.h"
+#include "Notation.h"
+#include "ProofSolver.h"
+#include "SelfPlay.h"
+#include "StateSpace.h"
+#include "TablebaseGen.h"
+
+static const char* optionValue(int argc, char* argv[], const char* name) {
+    for (int i = 2; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return nullptr;
+}
+
+static int optionInt(int argc, char* argv[], const char* name, int fallback) {
+    const char* value = optionValue(argc, argv, name);
+    return value ? atoi(value) : fallback;
+}
+
+static bool hasFlag(int argc, char* argv[], const char* name) {
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static int runServer(int argc, char* argv[]) {
+    ServerConfig config;
+    config.port = optionInt(argc, argv, "--port", config.port);
+    config.workers = optionInt(argc, argv, "--workers", config.workers);
+    config.queueLimit = optionInt(argc, argv, "--queue", config.queueLimit);
+    config.defaultDepth = optionInt(argc, argv, "--depth", config.defaultDepth);
+    config.defaultTimeMs = optionInt(argc, argv, "--time", (int)config.defaultTimeMs);
+    if (const char* path = optionValue(argc, argv, "--unix")) config.unixPath = path;
+
+    if (!netStartup()) return 1;
+
+    GameServer server(config);
+    std::string error;
+    if (!server.start(error)) {
+        fprintf(stderr, "server: %s\n", error.c_str());
+        netCleanup();
+        return 1;
+    }
+
+    printf("listening on %s\n", config.unixPath.empty() ?
+        ("127.0.0.1:" + std::to_string(config.port)).c_str() : config.unixPath.c_str());
+    fflush(stdout);
+
+    server.run();
+    netCleanup();
+    return 0;
+}
+
+static int runLoadTestCommand(int argc, char* argv[]) {
+    LoadTestConfig config;
+    config.port = optionInt(argc, argv, "--port", config.port);
+    config.clients = optionInt(argc, argv, "--clients", config.clients);
+    config.gamesPerClient = optionInt(argc, argv, "--games", config.gamesPerClient);
+    config.movesPerGame = optionInt(argc, argv, "--moves", config.movesPerGame);
+    config.depth = optionInt(argc, argv, "--depth", config.depth);
+    config.timeMs = optionInt(argc, argv, "--time", config.timeMs);
+    if (const char* path = optionValue(argc, argv, "--unix")) config.unixPath = path;
+
+    return runLoadTest(config);
+}
+
+static int runSolve(int argc, char* argv[]) {
+    SolverConfig config;
+    config.threads = optionInt(argc, argv, "--threads", config.threads);
+    config.hashMb = optionInt(argc, argv, "--hash", (int)config.hashMb);
+    config.checkpointSeconds = optionInt(argc, argv, "--checkpoint", config.checkpointSeconds);
+    config.reportSeconds = optionInt(argc, argv, "--report", config.reportSeconds);
+    config.timeLimitSeconds = optionInt(argc, argv, "--time", 0);
+    config.maxPlies = optionInt(argc, argv, "--plies", config.maxPlies);
+    int side = optionInt(argc, argv, "--attacker", 0);
+    config.attacker = (side == 1) ? PLAYER1 : (side == 2) ? PLAYER2 : NONE;
+    if (const char* dir = optionValue(argc, argv, "--dir")) config.directory = dir;
+
+    static BoardTopology topology;
+    const BoardTopology* rules = &BoardTopology::standard();
+    std::string error;
+
+    // A resumed proof brings its own board description
+    std::string boardFile;
+    if (const char* path = optionValue(argc, argv, "--board")) boardFile = path;
+    else if (hasFlag(argc, argv, "--resume") && !config.directory.empty()) {
+        std::string saved = proofPath(config.directory, PROOF_BOARD_FILE);
+        if (FILE* file = fopen(saved.c_str(), "r")) {
+            fclose(file);
+            boardFile = saved;
+        }
+    }
+    if (!boardFile.empty()) {
+        if (!topology.loadFromFile(boardFile, error)) {
+            fprintf(stderr, "%s: %s\n", boardFile.c_str(), error.c_str());
+            return 1;
+        }
+        rules = &topology;
+    }
+
+    ProofSolver solver(config);
+    if (hasFlag(argc, argv, "--resume")) {
+        if (config.directory.empty() || !solver.resume(*rules, error)) {
+            fprintf(stderr, "solve: %s\n", config.directory.empty() ? "--resume needs --dir" : error.c_str());
+            return 1;
+        }
+    }
+    else {
+        GameBoard root(*rules);
+        const char* position = optionValue(argc, argv, "--position");
+        if (position && !boardFromString(position, root, error)) {
+            fprintf(stderr, "solve: %s\n", error.c_str());
+            return 1;
+        }
+        if (!solver.start(root, error)) {
+            fprintf(stderr, "solve: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    printf("solving %s for player %d\n", boardToString(solver.getRoot()).c_str(), (int)solver.getAttacker());
+    fflush(stdout);
+
+    ProofResult result = solver.run([](const SolverProgress& progress) {
+        uint64_t nps = (progress.timeMs > 0) ? progress.nodes * 1000 / (uint64_t)progress.timeMs : 0;
+        printf("info time %lld nodes %llu nps %llu pn %u dn %u table %llu/%llu spilled %llu\n",
+            (long long)progress.timeMs, (unsigned long long)progress.nodes, (unsigned long long)nps,
+            progress.rootPn, progress.rootDn, (unsigned long long)progress.tableUsed,
+            (unsigned long long)progress.tableCapacity, (unsigned long long)progress.spilled);
+        fflush(stdout);
+    });
+
+    if (!solver.getLastError().empty()) {
+        fprintf(stderr, "solve: %s\n", solver.getLastError().c_str());
+    }
+    printf("result %s\n", proofResultName(result));
+    return solver.getLastError().empty() ? 0 : 1;
+}
+
+static int runTablebaseGen(int argc, char* argv[]) {
+    TablebaseGenConfig config;
+    config.units = optionInt(argc, argv, "--units", config.units);
+    config.threads = optionInt(argc, argv, "--threads", config.threads);
+    config.directory = "tablebases";
+    if (const char* dir = optionValue(argc, argv, "--dir")) config.directory = dir;
+    config.rebuild = hasFlag(argc, argv, "--rebuild");
+
+    static BoardTopology topology;
+    const BoardTopology* rules = &BoardTopology::standard();
+    std::string error;
+    if (const char* path = optionValue(argc, argv, "--board")) {
+        if (!topology.loadFromFile(path, error)) {
+            fprintf(stderr, "%s: %s\n", path, error.c_str());
+            return 1;
+        }
+        rules = &topology;
+    }
+
+    TablebaseGenerator generator(*rules, config);
+    bool ok = generator.run([](const TablebaseClassStats& stats) {
+        if (stats.existing) {
+            printf("%dv%d positions %llu bytes %llu (kept)\n", stats.units1, stats.units2,
+                (unsigned long long)stats.positions, (unsigned long long)stats.fileBytes);
+        }
+        else {
+            printf("%dv%d positions %llu win %llu loss %llu draw %llu longest %d bytes %llu time %lld\n",
+                stats.units1, stats.units2, (unsigned long long)stats.positions, (unsigned long long)stats.wins,
+                (unsigned long long)stats.losses, (unsigned long long)stats.draws, stats.longestPlies,
+                (unsigned long long)stats.fileBytes, (long long)stats.timeMs);
+        }
+        fflush(stdout);
+    }, error);
+
+    if (!ok) {
+        fprintf(stderr, "tbgen: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runEnumerate(int argc, char* argv[]) {
+    EnumeratorConfig config;
+    config.depth = optionInt(argc, argv, "--depth", config.depth);
+    config.threads = optionInt(argc, argv, "--threads", config.threads);
+    config.memoryMb = optionInt(argc, argv, "--memory", (int)config.memoryMb);
+    if (const char* dir = optionValue(argc, argv, "--dir")) config.directory = dir;
+
+    static BoardTopology topology;
+    const BoardTopology* rules = &BoardTopology::standard();
+    std::string error;
+    if (const char* path = optionValue(argc, argv, "--board")) {
+        if (!topology.loadFromFile(path, error)) {
+            fprintf(stderr, "%s: %s\n", path, error.c_str());
+            return 1;
+        }
+        rules = &topology;
+    }
+
+    StateEnumerator enumerator(*rules, config);
+    bool ok = enumerator.run([](const PlyStats& stats) {
+        uint64_t rate = (stats.timeMs > 0) ? stats.generated * 1000 / (uint64_t)stats.timeMs : 0;
+        printf("ply %d unique %llu total %llu finished %llu generated %llu time %lld pps %llu peak %lluMB runs %zu\n",
+            stats.ply, (unsigned long long)stats.unique, (unsigned long long)stats.total,
+            (unsigned long long)stats.finished, (unsigned long long)stats.generated, (long long)stats.timeMs,
+            (unsigned long long)rate, (unsigned long long)(stats.peakBytes >> 20), stats.runs);
+        fflush(stdout);
+    }, error);
+
+    if (!ok) {
+        fprintf(stderr, "enumerate: %s\n", error.c_str());
+        return 1;
+    }
+
+    // Material classes, units of player 1 down, player 2 across
+    int maxUnits = enumerator.getMaxUnits();
+    const std::vector<uint64_t>& counts = enumerator.getMaterialCounts();
+    printf("material");
+    for (int units2 = 0; units2 <= maxUnits; units2++) printf(" %12d", units2);
+    printf("\n");
+    for (int units1 = 0; units1 <= maxUnits; units1++) {
+        printf("%8d", units1);
+        for (int units2 = 0; units2 <= maxUnits; units2++) {
+            printf(" %12llu", (unsigned long long)counts[units1 * (maxUnits + 1) + units2]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+static int runSelfPlay(int argc, char* argv[]) {
+    SelfPlayConfig config;
+    config.games = optionInt(argc, argv, "--games", config.games);
+    config.depth = optionInt(argc, argv, "--depth", config.depth);
+    config.randomPlies = optionInt(argc, argv, "--random", config.randomPlies);
+    config.threads = optionInt(argc, argv, "--threads", config.threads);
+    config.seed = (uint64_t)optionInt(argc, argv, "--seed", (int)config.seed);
+    config.drawRules.moveLimit = optionInt(argc, argv, "--moves", config.drawRules.moveLimit);
+    if (const char* path = optionValue(argc, argv, "--out")) config.path = path;
+
+    static BoardTopology topology;
+    const BoardTopology* rules = &BoardTopology::standard();
+    std::string error;
+    if (const char* path = optionValue(argc, argv, "--board")) {
+        if (!topology.loadFromFile(path, error)) {
+            fprintf(stderr, "%s: %s\n", path, error.c_str());
+            return 1;
+        }
+        rules = &topology;
+    }
+
+    static NnueNetwork network;
+    SelfPlay selfPlay(*rules, config);
+    if (const char* path = optionValue(argc, argv, "--network")) {
+        if (!network.load(path, error) || !network.matches(*rules)) {
+            fprintf(stderr, "%s: %s\n", path, error.empty() ? "trained for another board" : error.c_str());
+            return 1;
+        }
+        selfPlay.setNetwork(&network);
+    }
+
+    bool ok = selfPlay.run([](const SelfPlayGameStats& stats) {
+        printf("game %d plies %d winner %d positions %d\n", stats.game, stats.plies, (int)stats.winner, stats.positions);
+        fflush(stdout);
+    }, error);
+
+    if (!ok) {
+        fprintf(stderr, "selfplay: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// Headless engine:
+//   asd_BowersEngine                 EngineProtocol on stdin/stdout
+//   asd_BowersEngine bench [depth]   run the benchmark and exit
+//   asd_BowersEngine server [--port N | --unix PATH] [--workers N] [--queue N] [--depth N] [--time MS]
+//   asd_BowersEngine loadtest [--port N | --unix PATH] [--clients N] [--games N] [--moves N] [--depth N] [--time MS]
+//   asd_BowersEngine solve [--position "<board>"] [--board FILE] [--attacker 1|2] [--plies N] [--threads N] [--hash MB]
+//                          [--dir PATH [--resume] [--checkpoint SEC]] [--time SEC] [--report SEC]
+//   asd_BowersEngine enumerate [--depth N] [--threads N] [--memory MB] [--dir PATH] [--board FILE]
+//   asd_BowersEngine tbgen [--units N] [--dir PATH] [--board FILE] [--threads N] [--rebuild]
+//   asd_BowersEngine selfplay [--games N] [--depth N] [--random N] [--moves N] [--threads N] [--seed N]
+//                             [--out FILE] [--board FILE] [--network FILE]
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return runBench(argc > 2 ? atoi(argv[2]) : 0);
+    }
+    if (argc > 1 && strcmp(argv[1], "server") == 0) {
+        return runServer(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "loadtest") == 0) {
+        return runLoadTestCommand(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "solve") == 0) {
+        return runSolve(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "enumerate") == 0) {
+        return runEnumerate(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "tbgen") == 0) {
+        return runTablebaseGen(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "selfplay") == 0) {
+        return runSelfPlay(argc, argv);
+    }
+
+    std::ios::sync_with_stdio(false);
+
+    EngineProtocol protocol(std::cin, std::cout);
+    protocol.run();
+
+    return 0;
+}
@@ -0,0 +1,333 @@
+#include "EngineProtocol.h"
+#include <cstdlib>
+#include <sstream>
+#include "Bench.h"
+#include "Notation.h"
+#include "Trace.h"
+
+EngineProtocol::EngineProtocol(std::istream& input, std::ostream& output)
+    : in(input), out(output), topology(BoardTopology::standard()), board(), stopRequested(false),
+    infiniteSearch(false) {
+    history.push(board.getHash());
+}
+
+EngineProtocol::~EngineProtocol() {
+    requestStop();
+    waitForSearch();
+}
+
+void EngineProtocol::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    out << line << std::endl;
+}
+
+void EngineProtocol::requestStop() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopRequested = true;
+    }
+    stopSignal.notify_all();
+}
+
+// An infinite search only ends when stopped, so a command that has to wait
+// for the search stops it rather than blocking the command loop for good
+void EngineProtocol::waitForSearch() {
+    if (searchThread.joinable()) {
+        if (infiniteSearch) requestStop();
+        searchThread.join();
+    }
+}
+
+void EngineProtocol::run() {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!execute(line)) break;
+    }
+
+    requestStop();
+    waitForSearch();
+}
+
+bool EngineProtocol::execute(const std::string& line) {
+    std::istringstream args(line);
+    std::string command;
+    if (!(args >> command)) return true;
+
+    if (command == "uci") {
+        send("id name Nomad Archers");
+        send("id author asd_Bowers");
+        send("option name Board type string default <standard>");
+        send("option name DrawMoveLimit type spin default " + std::to_string(drawRules.moveLimit) + " min 0 max 100000");
+        send("option name RepetitionLimit type spin default " + std::to_string(drawRules.repetitionLimit) + " min 0 max 100");
+        send("option name ProofTable type string default <empty>");
+        send("option name Tablebases type string default <empty>");
+        send("option name Network type string default <empty>");
+        send("uciok");
+    }
+    else if (command == "isready") {
+        send("readyok");
+    }
+    else if (command == "setoption") {
+        waitForSearch();
+        handleSetOption(args);
+    }
+    else if (command == "ucinewgame") {
+        waitForSearch();
+        board = GameBoard(board.getTopology());
+        history.clear();
+        history.push(board.getHash());
+    }
+    else if (command == "position") {
+        waitForSearch();
+        handlePosition(args);
+    }
+    else if (command == "go") {
+        waitForSearch();
+        handleGo(args);
+    }
+    else if (command == "stop") {
+        requestStop();
+        waitForSearch();
+    }
+    else if (command == "d") {
+        waitForSearch();
+        printBoard();
+    }
+    else if (command == "bench") {
+        waitForSearch();
+        int depth = 0;
+        args >> depth;
+        runBench(depth);
+    }
+    else if (command == "trace") {
+        handleTrace(args);
+    }
+    else if (command == "quit") {
+        requestStop();
+        waitForSearch();
+        return false;
+    }
+    else {
+        send("info string unknown command: " + command);
+    }
+
+    return true;
+}
+
+void EngineProtocol::handleSetOption(std::istringstream& args) {
+    std::string token, name, value;
+    args >> token;
+    if (token != "name") {
+        send("info string expected 'setoption name <name> value <value>'");
+        return;
+    }
+
+    while (args >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    std::getline(args >> std::ws, value);
+
+    if (name == "Board") {
+        std::string error;
+        if (value.empty() || value == "<standard>") {
+            board = GameBoard();
+        }
+        else if (topology.loadFromFile(value, error)) {
+            board = GameBoard(topology);
+        }
+        else {
+            send("info string " + error);
+            return;
+        }
+        history.clear();
+        history.push(board.getHash());
+        tablebases = TablebaseSet();    // built for the previous board
+    }
+    else if (name == "DrawMoveLimit") {
+        drawRules.moveLimit = std::atoi(value.c_str());
+    }
+    else if (name == "RepetitionLimit") {
+        drawRules.repetitionLimit = std::atoi(value.c_str());
+    }
+    else if (name == "ProofTable") {
+        std::string error;
+        proofTable = ProofTable();
+        if (!value.empty() && value != "<empty>") {
+            if (!proofTable.load(value, error)) {
+                proofTable = ProofTable();
+                send("info string " + error);
+                return;
+            }
+            send("info string proof table: " + std::to_string(proofTable.size()) + " solved positions for player " +
+                std::to_string((int)proofTable.getAttacker()));
+        }
+    }
+    else if (name == "Tablebases") {
+        std::string error;
+        tablebases = TablebaseSet();
+        if (!value.empty() && value != "<empty>") {
+            if (!tablebases.load(value, board.getTopology(), error)) {
+                tablebases = TablebaseSet();
+                send("info string " + error);
+                return;
+            }
+            send("info string tablebases: " + std::to_string(tablebases.getTableCount()) + " tables");
+        }
+    }
+    else if (name == "Network") {
+        std::string error;
+        network = NnueNetwork();
+        if (!value.empty() && value != "<empty>") {
+            if (!network.load(value, error)) {
+                network = NnueNetwork();
+                send("info string " + error);
+                return;
+            }
+            send(std::string("info string network loaded, ") + simdLevelName(getSimdLevel()) + " inference");
+        }
+    }
+    else {
+        send("info string unknown option: " + name);
+    }
+}
+
+void EngineProtocol::handlePosition(std::istringstream& args) {
+    std::string token;
+    args >> token;
+
+    GameBoard newBoard(board.getTopology());
+    if (token == "board") {
+        std::string cells, side, killed1, killed2, error;
+        args >> cells >> side >> killed1 >> killed2;
+        if (!boardFromString(cells + " " + side + " " + killed1 + " " + killed2, newBoard, error)) {
+            send("info string " + error);
+            return;
+        }
+    }
+    else if (token != "startpos") {
+        send("info string expected 'position startpos' or 'position board ...'");
+        return;
+    }
+
+    PositionHistory newHistory;
+    newHistory.push(newBoard.getHash());
+
+    if (args >> token && token == "moves") {
+        while (args >> token) {
+            Move move;
+            if (!parseMove(newBoard, token, move)) {
+                send("info string illegal move: " + token);
+                return;
+            }
+            newBoard.makeMove(move);
+            newBoard.switchPlayer();
+            newHistory.push(newBoard.getHash());
+        }
+    }
+
+    board = newBoard;
+    history = newHistory;
+}
+
+void EngineProtocol::handleGo(std::istringstream& args) {
+    SearchLimits limits;
+    bool infinite = false;
+    std::string token;
+
+    while (args >> token) {
+        if (token == "depth") args >> limits.depth;
+        else if (token == "movetime") args >> limits.moveTimeMs;
+        else if (token == "nodes") args >> limits.nodes;
+        else if (token == "infinite") {
+            limits = SearchLimits();
+            infinite = true;
+        }
+    }
+
+    stopRequested = false;
+    infiniteSearch = infinite;
+
+    // The search works on its own copies so the next command can't race it
+    searchThread = std::thread([this, limits, infinite, searchBoard = board, searchHistory = history]() mutable {
+        TRACE_THREAD_NAME("search");
+
+        // With infinite the answer waits for stop, even once the search has
+        // nothing left to do
+        auto finish = [this, infinite](const std::string& bestmove) {
+            if (infinite) {
+                std::unique_lock<std::mutex> lock(stopMutex);
+                stopSignal.wait(lock, [this]() { return stopRequested.load(); });
+            }
+            send(bestmove);
+        };
+
+        if (searchBoard.isGameOver() || searchHistory.checkDraw(drawRules) != DRAW_NONE) {
+            send("info string game is over");
+            finish("bestmove (none)");
+            return;
+        }
+
+        AIPlayer ai(searchBoard.getCurrentPlayer());
+        ai.setDrawRules(drawRules);
+        if (proofTable.isLoaded()) ai.setProofTable(&proofTable);
+        if (tablebases.isLoaded()) ai.setTablebases(&tablebases);
+        if (network.isLoaded()) ai.setNetwork(&network);
+
+        Move best = ai.search(searchBoard, limits, &searchHistory, &stopRequested, [this](const SearchInfo& info) {
+            uint64_t nps = (info.timeMs > 0) ? info.nodes * 1000 / (uint64_t)info.timeMs : 0;
+            send("info depth " + std::to_string(info.depth) +
+                " score " + std::to_string(info.score) +
+                " nodes " + std::to_string(info.nodes) +
+                " time " + std::to_string(info.timeMs) +
+                " nps " + std::to_string(nps) +
+                " pv " + moveToString(info.bestMove));
+        });
+
+        finish("bestmove " + moveToString(best));
+    });
+}
+
+void EngineProtocol::handleTrace(std::istringstream& args) {
+    std::string action, path;
+    args >> action >> path;
+
+    if (action == "on" || action == "off") {
+        Trace::setEnabled(action == "on");
+    }
+    else if (action == "clear") {
+        Trace::clear();
+    }
+    else if (action == "dump" && !path.empty()) {
+        send(Trace::dump(path.c_str()) ? "info string trace written to " + path :
+            "info string cannot write trace to " + path);
+        return;
+    }
+    else {
+        send("info string usage: trace on|off|clear|dump <file>");
+        return;
+    }
+
+    send(std::string("info string trace ") + (Trace::isEnabled() ? "on" : "off"));
+}
+
+void EngineProtocol::printBoard() {
+    const BoardTopology& layout = board.getTopology();
+    std::ostringstream text;
+
+    for (int r = layout.rows - 1; r >= 0; r--) {
+        text << (r + 1) << (r + 1 < 10 ? "  " : " ");
+        for (int c = 0; c < layout.cols; c++) {
+            int cell = board.getCell(Position(r, c));
+            text << ((cell == NONE) ? '.' : (char)('0' + cell)) << ' ';
+        }
+        text << "\n";
+    }
+    text << "   ";
+    for (int c = 0; c < layout.cols; c++) {
+        text << (char)('a' + c) << ' ';
+    }
+    text << "\n\nBoard: " << boardToString(board);
+    text << "\nKey: " << std::hex << board.getHash() << std::dec;
+
+    send(text.str());
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AIPlayer.h"
+
+// Line-based engine protocol modelled on UCI. Commands:
+//   uci                         -> id lines, options, "uciok"
+//   isready                     -> "readyok"
+//   setoption name <N> value <V>  Board (description file), DrawMoveLimit,
+//                               RepetitionLimit, ProofTable (solver directory),
+//                               Tablebases (tbgen directory, after Board),
+//                               Network (evaluation weights file)
+//   ucinewgame
+//   position startpos|board <rows> <side> <k1> <k2> [moves <m1> <m2> ...]
+//   go [depth N] [movetime MS] [nodes N] [infinite]
+//                               -> "info ..." per iteration, then "bestmove <m>";
+//                               after infinite only once stopped (by stop, or by
+//                               any command that needs the engine idle)
+//   stop, quit, d (print the position), bench [depth]
+//   trace on|off|clear|dump <file>  Chrome trace of searches (BOWERS_TRACE builds)
+class EngineProtocol {
+private:
+    std::istream& in;
+    std::ostream& out;
+    std::mutex outMutex;
+
+    BoardTopology topology;
+    GameBoard board;
+    PositionHistory history;
+    DrawRules drawRules;
+    ProofTable proofTable;
+    TablebaseSet tablebases;
+    NnueNetwork network;
+
+    std::thread searchThread;
+    std::atomic<bool> stopRequested;
+    std::mutex stopMutex;
+    std::condition_variable stopSignal;     // wakes an infinite search holding its bestmove
+    bool infiniteSearch;                    // of the current search thread; command thread only
+
+    void send(const std::string& line);
+    void requestStop();
+    void waitForSearch();
+
+    void handleSetOption(std::istringstream& args);
+    void handlePosition(std::istringstream& args);
+    void handleGo(std::istringstream& args);
+    void handleTrace(std::istringstream& args);
+    void printBoard();
+
+public:
+    EngineProtocol(std::istream& input, std::ostream& output);
+    ~EngineProtocol();
+
+    // Processes commands until "quit" or end of input
+    void run();
+    // Returns false on "quit"
+    bool execute(const std::string& line);
+};
@@ -1,16 +1,43 @@
 #include "Game.h"
+#include <algorithm>
 #include <cmath>
+#include "Notation.h"
+#include "Trace.h"
+
+namespace {
+    // Won and lost scores as plies to the end where the search knows them
+    std::string scoreText(int score) {
+        if (score >= 10000) return "Win";
+        if (score <= -10000) return "Loss";
+        if (score >= 9500) return "W" + std::to_string(10000 - score);
+        if (score <= -9500) return "L" + std::to_string(10000 + score);
+        return (score > 0 ? "+" : "") + std::to_string(score);
+    }
+
+    SDL_Color scoreColor(int score) {
+        if (score > 0) return SDL_Color{ 0, 140, 0, 255 };
+        if (score < 0) return SDL_Color{ 200, 0, 0, 255 };
+        return SDL_Color{ 0, 0, 0, 255 };
+    }
+}
 
 Game::Game() : window(nullptr), renderer(nullptr), font(nullptr),
-smallFont(nullptr), ai(nullptr), running(false),
-vsAI(true), pieceSelected(false), messageTimer(0) {
+smallFont(nullptr), ai(nullptr), boardRenderer(nullptr), analysis(nullptr), analysedHash(0), analysisVersion(0),
+analysisResult(), spectatorCount(0), spectatorGames(nullptr), spectatorView(nullptr), drawReason(DRAW_NONE), running(false),
+vsAI(true), pieceSelected(false), messageTimer(0), tracePath("bowers_trace.json") {
     selectedPos = Position(-1, -1);
+    restartHistory();
 }
 
 Game::~Game() {
     cleanup();
 }
 
+void Game::setTopology(const BoardTopology& topology) {
+    board = GameBoard(topology);
+    restartHistory();
+}
+
 bool Game::init() {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         return false;
@@ -22,13 +49,17 @@ bool Game::init() {
 
     window = SDL_CreateWindow("Nomad Archers",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+        SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
 
     if (!window) {
         return false;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    if (!renderer) {
+        // Spectator tiles fall back to drawing every frame without render targets
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    }
     if (!renderer) {
         return false;
     }
@@ -40,27 +71,75 @@ bool Game::init() {
         return false;
     }
 
+    boardRenderer = new BoardRenderer(board.getTopology());
+
+    if (spectatorCount > 0) {
+        SpectatorConfig config;
+        config.games = spectatorCount;
+        spectatorGames = new SpectatorGames(board.getTopology(), config);
+        spectatorView = new SpectatorView(*spectatorGames, board.getTopology());
+
+        int width, height;
+        getOutputSize(width, height);
+        spectatorView->setArea(SDL_Rect{ 0, 40, width, height - 40 });
+    }
+
     ai = new AIPlayer(PLAYER2, 3);
+    ai->setDrawRules(drawRules);
+    if (proofTable.isLoaded()) ai->setProofTable(&proofTable);
+    if (tablebases.isLoaded()) ai->setTablebases(&tablebases);
+    if (network.isLoaded()) ai->setNetwork(&network);
     running = true;
 
     return true;
 }
 
 void Game::run() {
+    TRACE_THREAD_NAME("main");
+
     while (running) {
-        handleEvents();
-        update();
-        render();
+        {
+            TRACE_SCOPE("frame");
+            handleEvents();
+            update();
+            render();
+        }
         SDL_Delay(16);
     }
 }
 
 void Game::cleanup() {
+    if (Trace::isEnabled()) {
+        Trace::setEnabled(false);
+        Trace::dump(tracePath.c_str());
+    }
+
     if (ai) {
         delete ai;
         ai = nullptr;
     }
 
+    if (analysis) {
+        delete analysis;
+        analysis = nullptr;
+    }
+
+    // The view holds a texture of the renderer; the games stop their searches
+    if (spectatorView) {
+        delete spectatorView;
+        spectatorView = nullptr;
+    }
+
+    if (spectatorGames) {
+        delete spectatorGames;
+        spectatorGames = nullptr;
+    }
+
+    if (boardRenderer) {
+        delete boardRenderer;
+        boardRenderer = nullptr;
+    }
+
     if (font) {
         TTF_CloseFont(font);
         font = nullptr;
@@ -86,6 +165,7 @@ void Game::cleanup() {
 }
 
 void Game::handleEvents() {
+    TRACE_SCOPE("handleEvents");
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         if (e.type == SDL_QUIT) {
@@ -99,14 +179,32 @@ void Game::handleEvents() {
         else if (e.type == SDL_KEYDOWN) {
             handleKeyPress(e.key.keysym.sym);
         }
+        else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            if (spectatorView) {
+                int width, height;
+                getOutputSize(width, height);
+                spectatorView->setArea(SDL_Rect{ 0, 40, width, height - 40 });
+            }
+        }
+        else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+            if (spectatorView) spectatorView->invalidate();
+        }
     }
 }
 
 void Game::update() {
+    TRACE_SCOPE("update");
     if (messageTimer > 0) {
         messageTimer--;
     }
 
+    if (spectatorGames) {
+        spectatorGames->update();
+        return;
+    }
+
+    updateAnalysis();
+
     if (board.isGameOver()) {
         Player winner = board.getWinner();
         if (winner == PLAYER1) {
@@ -116,6 +214,9 @@ void Game::update() {
             showMessage("Player 2 Wins!", 300);
         }
     }
+    else if (drawReason != DRAW_NONE) {
+        showMessage(std::string("Draw by ") + drawReasonName(drawReason), 300);
+    }
     else if (vsAI && board.getCurrentPlayer() == PLAYER2 && !pieceSelected) {
         SDL_Delay(500);
         aiMove();
@@ -123,171 +224,92 @@ void Game::update() {
 }
 
 void Game::render() {
+    TRACE_SCOPE("render");
     SDL_SetRenderDrawColor(renderer, 240, 230, 210, 255);
     SDL_RenderClear(renderer);
 
-    drawBoard();
-    drawPieces();
-    drawUI();
+    if (spectatorView) {
+        renderSpectator();
+    }
+    else {
+        drawBoard();
+        drawScores();
+        drawUI();
+    }
 
     SDL_RenderPresent(renderer);
 }
 
-Position Game::screenToBoard(int x, int y) const {
-    int boardX = x - BOARD_OFFSET_X;
-    int boardY = y - BOARD_OFFSET_Y;
-
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            int px, py;
-            getBoardPosition(r, c, px, py);
-
-            int dx = boardX - px;
-            int dy = boardY - py;
-            double dist = sqrt((double)(dx * dx + dy * dy));
-
-            if (dist < 30.0) {
-                return Position(r, c);
-            }
-        }
+void Game::getOutputSize(int& width, int& height) const {
+    if (!renderer || SDL_GetRendererOutputSize(renderer, &width, &height) != 0) {
+        width = SCREEN_WIDTH;
+        height = SCREEN_HEIGHT;
     }
+}
+
+// Right of the panel, with the original margins
+SDL_FRect Game::boardArea() const {
+    int width, height;
+    getOutputSize(width, height);
 
-    return Position(-1, -1);
+    SDL_FRect area = { (float)PANEL_WIDTH, 100.0f, (float)(width - PANEL_WIDTH - 50), (float)(height - 200) };
+    return area;
 }
 
-void Game::getBoardPosition(int row, int col, int& x, int& y) const {
-    x = col * CELL_SIZE + CELL_SIZE / 2;
-    y = row * CELL_SIZE + CELL_SIZE / 2;
+Position Game::screenToBoard(int x, int y) const {
+    int node = boardRenderer->nodeAt(boardArea(), (float)x, (float)y);
+    return (node >= 0) ? board.getTopology().nodePosition(node) : Position(-1, -1);
 }
 
 void Game::drawBoard() {
-    SDL_SetRenderDrawColor(renderer, 100, 80, 60, 255);
+    TRACE_SCOPE("drawBoard");
+    const BoardTopology& topology = board.getTopology();
 
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            const auto& neighbors = board.adjacency[r][c];
-
-            int x1, y1;
-            getBoardPosition(r, c, x1, y1);
-
-            for (const auto& neighbor : neighbors) {
-                int x2, y2;
-                getBoardPosition(neighbor.row, neighbor.col, x2, y2);
-
-                SDL_RenderDrawLine(renderer,
-                    BOARD_OFFSET_X + x1, BOARD_OFFSET_Y + y1,
-                    BOARD_OFFSET_X + x2, BOARD_OFFSET_Y + y2);
-            }
-        }
+    BoardMarks marks;
+    for (const auto& pos : highlightedMoves) {
+        marks.targets |= nodeBit(topology.nodeIndex(pos));
+    }
+    if (pieceSelected) {
+        marks.selected = topology.nodeIndex(selectedPos);
     }
 
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            int x, y;
-            getBoardPosition(r, c, x, y);
-
-            SDL_Color color = { 200, 200, 200, 255 };
-            if (r == 0) color = { 100, 150, 255, 255 };
-            if (r == 4) color = { 255, 100, 100, 255 };
-
-            SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    boardRenderer->addBoard(boardArea(), board, marks);
+    boardRenderer->flush(renderer);
+}
 
-            for (int i = 0; i < 25; i++) {
-                int radius = 25 - i;
-                for (int angle = 0; angle < 360; angle += 10) {
-                    double rad1 = angle * 3.14159 / 180.0;
-                    double rad2 = (angle + 10) * 3.14159 / 180.0;
-                    int px1 = x + (int)(radius * cos(rad1));
-                    int py1 = y + (int)(radius * sin(rad1));
-                    int px2 = x + (int)(radius * cos(rad2));
-                    int py2 = y + (int)(radius * sin(rad2));
+// Scores of the selected unit's moves on their destinations
+void Game::drawScores() {
+    if (!analysis || !pieceSelected) return;
 
-                    SDL_RenderDrawLine(renderer,
-                        BOARD_OFFSET_X + px1, BOARD_OFFSET_Y + py1,
-                        BOARD_OFFSET_X + px2, BOARD_OFFSET_Y + py2);
-                }
-            }
-        }
-    }
+    SDL_FRect area = boardArea();
+    const BoardTopology& topology = board.getTopology();
 
     for (const auto& pos : highlightedMoves) {
-        int x, y;
-        getBoardPosition(pos.row, pos.col, x, y);
-
-        SDL_SetRenderDrawColor(renderer, 255, 255, 0, 128);
-        for (int r = 20; r < 30; r++) {
-            for (int angle = 0; angle < 360; angle += 5) {
-                double rad = angle * 3.14159 / 180.0;
-                int px = x + (int)(r * cos(rad));
-                int py = y + (int)(r * sin(rad));
-                SDL_RenderDrawPoint(renderer, BOARD_OFFSET_X + px, BOARD_OFFSET_Y + py);
-            }
+        for (const AnalysisLine& line : analysisResult.lines) {
+            if (line.move.isRevival || line.depth == 0) continue;
+            if (!(line.move.from == selectedPos && line.move.to == pos)) continue;
+
+            SDL_FPoint center = boardRenderer->nodeCenter(area, topology.nodeIndex(pos));
+            drawTextCentered(scoreText(line.score), (int)center.x, (int)center.y, scoreColor(line.score), smallFont);
+            break;
         }
     }
 }
 
-void Game::drawPieces() {
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            Position pos(r, c);
-            int cell = board.getCell(pos);
-
-            if (cell == NONE) continue;
-
-            int x, y;
-            getBoardPosition(r, c, x, y);
+void Game::renderSpectator() {
+    TRACE_SCOPE("renderSpectator");
+    spectatorView->render(renderer);
 
-            SDL_Color color = (cell == PLAYER1) ?
-                SDL_Color{ 50, 100, 255, 255 } : SDL_Color{ 255, 50, 50, 255 };
-
-            bool isSelected = (pieceSelected && selectedPos == pos);
-            if (isSelected) {
-                SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
-                for (int r = 18; r < 22; r++) {
-                    for (int angle = 0; angle < 360; angle += 5) {
-                        double rad = angle * 3.14159 / 180.0;
-                        int px = x + (int)(r * cos(rad));
-                        int py = y + (int)(r * sin(rad));
-                        SDL_RenderDrawPoint(renderer, BOARD_OFFSET_X + px, BOARD_OFFSET_Y + py);
-                    }
-                }
-            }
-
-            SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-            for (int i = 0; i < 18; i++) {
-                int radius = 18 - i;
-                for (int angle = 0; angle < 360; angle += 10) {
-                    double rad1 = angle * 3.14159 / 180.0;
-                    double rad2 = (angle + 10) * 3.14159 / 180.0;
-                    int px1 = x + (int)(radius * cos(rad1));
-                    int py1 = y + (int)(radius * sin(rad1));
-                    int px2 = x + (int)(radius * cos(rad2));
-                    int py2 = y + (int)(radius * sin(rad2));
-
-                    SDL_RenderDrawLine(renderer,
-                        BOARD_OFFSET_X + px1, BOARD_OFFSET_Y + py1,
-                        BOARD_OFFSET_X + px2, BOARD_OFFSET_Y + py2);
-                }
-            }
-
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            for (int angle = 0; angle < 360; angle += 10) {
-                double rad1 = angle * 3.14159 / 180.0;
-                double rad2 = (angle + 10) * 3.14159 / 180.0;
-                int px1 = x + (int)(18 * cos(rad1));
-                int py1 = y + (int)(18 * sin(rad1));
-                int px2 = x + (int)(18 * cos(rad2));
-                int py2 = y + (int)(18 * sin(rad2));
-
-                SDL_RenderDrawLine(renderer,
-                    BOARD_OFFSET_X + px1, BOARD_OFFSET_Y + py1,
-                    BOARD_OFFSET_X + px2, BOARD_OFFSET_Y + py2);
-            }
-        }
-    }
+    SpectatorTotals totals = spectatorGames->getTotals();
+    std::string status = std::to_string(spectatorGames->size()) + " games, " + std::to_string(totals.moves) +
+        " moves, Player 1 won " + std::to_string(totals.wins[PLAYER1]) + ", Player 2 won " +
+        std::to_string(totals.wins[PLAYER2]) + ", drawn " + std::to_string(totals.wins[NONE]) +
+        ", redrawn " + std::to_string(spectatorView->getDirtyTiles());
+    drawText(status, 10, 10, SDL_Color{ 0, 0, 0, 255 }, smallFont);
 }
 
 void Game::drawUI() {
+    TRACE_SCOPE("drawUI");
     SDL_Color white = { 0, 0, 0, 255 };
     SDL_Color p1Color = { 50, 100, 255, 255 };
     SDL_Color p2Color = { 255, 50, 50, 255 };
@@ -303,27 +325,64 @@ void Game::drawUI() {
     drawText("Mouse: Select/Move", 20, 150, white, smallFont);
     drawText("R: Reset Game", 20, 180, white, smallFont);
     drawText("A: Toggle AI", 20, 210, white, smallFont);
-    drawText("ESC: Quit", 20, 240, white, smallFont);
+    drawText("E: Toggle Analysis", 20, 240, white, smallFont);
+    drawText("ESC: Quit", 20, 270, white, smallFont);
 
     std::string aiText = vsAI ? "Mode: vs AI" : "Mode: vs Human";
-    drawText(aiText, 20, 280, white, smallFont);
+    drawText(aiText, 20, 310, white, smallFont);
 
     int p1Killed = board.getKilledUnits(PLAYER1);
     int p2Killed = board.getKilledUnits(PLAYER2);
 
-    drawText("Player 1 Lost: " + std::to_string(p1Killed), 20, 320, p1Color, smallFont);
-    drawText("Player 2 Lost: " + std::to_string(p2Killed), 20, 350, p2Color, smallFont);
+    drawText("Player 1 Lost: " + std::to_string(p1Killed), 20, 350, p1Color, smallFont);
+    drawText("Player 2 Lost: " + std::to_string(p2Killed), 20, 380, p2Color, smallFont);
+
+    if (analysis) {
+        drawAnalysis(420);
+    }
+
+    int width, height;
+    getOutputSize(width, height);
 
     if (messageTimer > 0 && !message.empty()) {
         SDL_Color msgColor = { 255, 200, 0, 255 };
-        drawTextCentered(message, SCREEN_WIDTH / 2, 30, msgColor, font);
+        drawTextCentered(message, width / 2, 30, msgColor, font);
+    }
+
+    if (drawReason != DRAW_NONE && !board.isGameOver()) {
+        SDL_Color drawColor = { 0, 0, 0, 255 };
+        drawTextCentered("Draw!", width / 2, height - 50, drawColor, font);
     }
 
     if (board.isGameOver()) {
         Player winner = board.getWinner();
         std::string winText = "Player " + std::to_string((int)winner) + " Wins!";
         SDL_Color winColor = (winner == PLAYER1) ? p1Color : p2Color;
-        drawTextCentered(winText, SCREEN_WIDTH / 2, SCREEN_HEIGHT - 50, winColor, font);
+        drawTextCentered(winText, width / 2, height - 50, winColor, font);
+    }
+}
+
+// Best moves first, with the depth every move has been searched to
+void Game::drawAnalysis(int y) {
+    SDL_Color black = { 0, 0, 0, 255 };
+    const int MAX_LINES = 8;
+
+    std::string header = "Analysis: depth " + std::to_string(analysisResult.depth) + ", " +
+        std::to_string(analysisResult.nodes / 1000) + "k nodes";
+    drawText(header, 20, y, black, smallFont);
+
+    std::vector<const AnalysisLine*> lines;
+    for (const AnalysisLine& line : analysisResult.lines) {
+        if (line.depth > 0) lines.push_back(&line);
+    }
+    std::stable_sort(lines.begin(), lines.end(), [](const AnalysisLine* a, const AnalysisLine* b) {
+        return a->score > b->score;
+    });
+
+    for (int i = 0; i < (int)lines.size() && i < MAX_LINES; i++) {
+        std::string text = moveToString(lines[i]->move) + "  " + scoreText(lines[i]->score) +
+            "  (" + std::to_string(lines[i]->depth) + ")";
+        drawText(text, 30, y + 30 + i * 24, scoreColor(lines[i]->score), smallFont);
     }
 }
 
@@ -366,7 +425,7 @@ void Game::drawTextCentered(const std::string& text, int x, int y, SDL_Color col
 }
 
 void Game::handleMouseClick(int x, int y) {
-    if (board.isGameOver()) return;
+    if (spectatorGames || isFinished()) return;
     if (vsAI && board.getCurrentPlayer() == PLAYER2) return;
 
     Position clickedPos = screenToBoard(x, y);
@@ -393,6 +452,7 @@ void Game::handleKeyPress(SDL_Keycode key) {
 
     case SDLK_r:
         board.reset();
+        restartHistory();
         pieceSelected = false;
         highlightedMoves.clear();
         showMessage("Game Reset", 60);
@@ -403,6 +463,14 @@ void Game::handleKeyPress(SDL_Keycode key) {
         showMessage(vsAI ? "AI Enabled" : "AI Disabled", 60);
         break;
 
+    case SDLK_t:
+        toggleTrace();
+        break;
+
+    case SDLK_e:
+        toggleAnalysis();
+        break;
+
     default:
         // Ignore other keys
         break;
@@ -420,26 +488,20 @@ void Game::selectPiece(const Position& pos) {
     pieceSelected = true;
     highlightedMoves.clear();
 
-    std::vector<Move> allMoves = board.getLegalMoves();
-    for (const auto& move : allMoves) {
-        if (move.from == pos && !move.isRevival) {
-            highlightedMoves.push_back(move.to);
-        }
+    for (NodeMask targets = board.getMoveTargets(pos); targets; targets &= targets - 1) {
+        highlightedMoves.push_back(board.getTopology().nodePosition(lowestNode(targets)));
     }
 }
 
 void Game::movePiece(const Position& to) {
-    std::vector<Move> allMoves = board.getLegalMoves();
+    if (board.canMove(selectedPos, to)) {
+        board.makeMove(Move(selectedPos, to));
+        board.switchPlayer();
+        recordPosition();
 
-    for (const auto& move : allMoves) {
-        if (move.from == selectedPos && move.to == to && !move.isRevival) {
-            board.makeMove(move);
-            board.switchPlayer();
-
-            pieceSelected = false;
-            highlightedMoves.clear();
-            return;
-        }
+        pieceSelected = false;
+        highlightedMoves.clear();
+        return;
     }
 
     if (board.getCell(to) == board.getCurrentPlayer()) {
@@ -452,16 +514,82 @@ void Game::movePiece(const Position& to) {
 }
 
 void Game::aiMove() {
-    if (board.isGameOver()) return;
+    TRACE_SCOPE("aiMove");
+    if (isFinished()) return;
 
-    Move bestMove = ai->getBestMove(board);
+    Move bestMove = ai->getBestMove(board, &history);
     board.makeMove(bestMove);
     board.switchPlayer();
+    recordPosition();
 
     showMessage("AI moved", 60);
 }
 
+void Game::recordPosition() {
+    history.push(board.getHash());
+    drawReason = history.checkDraw(drawRules);
+}
+
+void Game::restartHistory() {
+    history.clear();
+    history.push(board.getHash());
+    drawReason = DRAW_NONE;
+}
+
+bool Game::isFinished() const {
+    return board.isGameOver() || drawReason != DRAW_NONE;
+}
+
+void Game::toggleAnalysis() {
+    if (analysis) {
+        delete analysis;
+        analysis = nullptr;
+        showMessage("Analysis Off", 60);
+        return;
+    }
+
+    analysis = new AnalysisEngine();
+    analysis->setDrawRules(drawRules);
+    if (proofTable.isLoaded()) analysis->setProofTable(&proofTable);
+    if (tablebases.isLoaded()) analysis->setTablebases(&tablebases);
+    if (network.isLoaded()) analysis->setNetwork(&network);
+
+    // Forces a start on the next update
+    analysedHash = ~board.getHash();
+    analysisVersion = 0;
+    analysisResult = AnalysisResult();
+    showMessage("Analysis On", 60);
+}
+
+// Follows the board; the engine restarts without waiting for its threads
+void Game::updateAnalysis() {
+    if (!analysis) return;
+
+    if (board.getHash() != analysedHash) {
+        analysedHash = board.getHash();
+        if (isFinished()) {
+            analysis->stop();
+        }
+        else {
+            analysis->start(board, history);
+        }
+    }
+    analysis->snapshot(analysisVersion, analysisResult);
+}
+
 void Game::showMessage(const std::string& msg, int duration) {
     message = msg;
     messageTimer = duration;
-}
\ No newline at end of file
+}
+
+void Game::toggleTrace() {
+    if (!Trace::isEnabled()) {
+        Trace::clear();
+        Trace::setEnabled(true);
+        showMessage(Trace::isEnabled() ? "Tracing..." : "Tracing not built in", 60);
+        return;
+    }
+
+    Trace::setEnabled(false);
+    showMessage(Trace::dump(tracePath.c_str()) ? "Trace saved to " + tracePath : "Trace not saved", 120);
+}
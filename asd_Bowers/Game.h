@@ -4,14 +4,15 @@
 #include <string>
 #include "GameBoard.h"
 #include "AIPlayer.h"
+#include "Analysis.h"
+#include "BoardRenderer.h"
+#include "Spectator.h"
 
-// Screen constants
+// Initial window size; the window can be resized
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 700
-#define BOARD_OFFSET_X 250
-#define BOARD_OFFSET_Y 100
-#define CELL_SIZE 100
-#define NODE_RADIUS 25
+// Left of the board: title, status and controls
+#define PANEL_WIDTH 250
 
 class Game {
 private:
@@ -22,6 +23,22 @@ private:
 
     GameBoard board;
     AIPlayer* ai;
+    BoardRenderer* boardRenderer;
+
+    // Analysis mode: scores of every legal move, searched in the background
+    AnalysisEngine* analysis;
+    uint64_t analysedHash;          // position the engine was started on
+    uint64_t analysisVersion;
+    AnalysisResult analysisResult;
+
+    // Spectator mode: AI-vs-AI games in a grid instead of the board above
+    int spectatorCount;
+    SpectatorGames* spectatorGames;
+    SpectatorView* spectatorView;
+
+    PositionHistory history;
+    DrawRules drawRules;
+    DrawReason drawReason;
 
     bool running;
     bool vsAI;
@@ -32,6 +49,11 @@ private:
     std::string message;
     int messageTimer;
 
+    std::string tracePath;
+    ProofTable proofTable;
+    TablebaseSet tablebases;
+    NnueNetwork network;
+
     void handleEvents();
     void update();
     void render();
@@ -39,25 +61,49 @@ private:
     void handleMouseClick(int x, int y);
     void handleKeyPress(SDL_Keycode key);
 
+    void getOutputSize(int& width, int& height) const;
+    SDL_FRect boardArea() const;
     Position screenToBoard(int x, int y) const;
-    void getBoardPosition(int row, int col, int& x, int& y) const;
 
     void drawBoard();
-    void drawPieces();
+    void drawScores();
     void drawUI();
+    void drawAnalysis(int y);
+    void renderSpectator();
     void drawText(const std::string& text, int x, int y, SDL_Color color, TTF_Font* useFont);
     void drawTextCentered(const std::string& text, int x, int y, SDL_Color color, TTF_Font* useFont);
 
     void selectPiece(const Position& pos);
     void movePiece(const Position& to);
     void aiMove();
+    void recordPosition();
+    void restartHistory();
+    bool isFinished() const;
+
+    void toggleAnalysis();
+    void updateAnalysis();
 
     void showMessage(const std::string& msg, int duration = 120);
+    void toggleTrace();
 
 public:
     Game();
     ~Game();
 
+    // Must be called before init(); the topology has to outlive the game.
+    void setTopology(const BoardTopology& topology);
+    // T toggles recording; stopping writes a Chrome trace here
+    void setTracePath(const std::string& path) { tracePath = path; }
+    // Solved positions from the engine's solve mode; call before init()
+    bool loadProofTable(const std::string& directory, std::string& error) { return proofTable.load(directory, error); }
+    // For the current board, so after setTopology
+    bool loadTablebases(const std::string& directory, std::string& error) {
+        return tablebases.load(directory, board.getTopology(), error);
+    }
+    // Watch this many AI-vs-AI games instead of playing; call before init()
+    void setSpectator(int games) { spectatorCount = games; }
+    // Evaluation weights for the AI; call before init()
+    bool loadNetwork(const std::string& path, std::string& error) { return network.load(path, error); }
     bool init();
     void run();
     void cleanup();
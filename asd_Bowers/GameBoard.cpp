@@ -1,117 +1,255 @@
 #include "GameBoard.h"
 #include <algorithm>
 
-GameBoard::GameBoard() : currentPlayer(PLAYER1) {
-    board.resize(5, std::vector<int>(5, NONE));
+namespace {
+    const int MAX_KILLED = MAX_BOARD_NODES + 1;
+
+    struct ZobristKeys {
+        uint64_t piece[3][MAX_BOARD_NODES];
+        uint64_t killed[3][MAX_KILLED];
+        uint64_t history[MAX_BOARD_NODES][MAX_BOARD_NODES];
+        uint64_t historyRepeated[MAX_BOARD_NODES];
+        uint64_t sideToMove;
+
+        ZobristKeys() {
+            // splitmix64 with a fixed seed so keys are identical across runs
+            uint64_t state = 0x9E3779B97F4A7C15ULL;
+            auto next = [&state]() {
+                uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                return z ^ (z >> 31);
+            };
+
+            for (int p = 0; p < 3; p++) {
+                for (int n = 0; n < MAX_BOARD_NODES; n++) piece[p][n] = next();
+                for (int k = 0; k < MAX_KILLED; k++) killed[p][k] = next();
+            }
+            for (int to = 0; to < MAX_BOARD_NODES; to++) {
+                for (int from = 0; from < MAX_BOARD_NODES; from++) history[to][from] = next();
+                historyRepeated[to] = next();
+            }
+            sideToMove = next();
+        }
+    };
 
-    for (int i = 0; i < 5; i++) {
-        board[0][i] = PLAYER1;
-        board[4][i] = PLAYER2;
+    const ZobristKeys& zobrist() {
+        static const ZobristKeys keys;
+        return keys;
     }
 
-    killedUnits[PLAYER1] = 0;
-    killedUnits[PLAYER2] = 0;
+    // Only "seen twice or more" matters to the three-move rule, so higher
+    // counts hash the same.
+    uint64_t historyKey(int to, int from, int count) {
+        uint64_t key = zobrist().history[to][from];
+        if (count >= 2) key ^= zobrist().historyRepeated[to];
+        return key;
+    }
+}
 
-    initializeAdjacency();
+GameBoard::GameBoard() : GameBoard(BoardTopology::standard()) {}
+
+GameBoard::GameBoard(const BoardTopology& topology) : topology(&topology), currentPlayer(PLAYER1), network(nullptr) {
+    placeStartingUnits();
+    clearRecords();
+    rebuildTargets();
+
+    hashKey = computeHash();
 }
 
-GameBoard::GameBoard(const GameBoard& other) {
-    board = other.board;
-    moveHistory = other.moveHistory;
-    killedUnits = other.killedUnits;
-    killerPositions = other.killerPositions;
-    currentPlayer = other.currentPlayer;
-    adjacency = other.adjacency;
+void GameBoard::placeStartingUnits() {
+    pieces[NONE] = 0;
+    pieces[PLAYER1] = topology->startMask[PLAYER1];
+    pieces[PLAYER2] = topology->startMask[PLAYER2];
 }
 
-void GameBoard::initializeAdjacency() {
-    adjacency.resize(5);
-    for (int i = 0; i < 5; i++) {
-        adjacency[i].resize(5);
+void GameBoard::clearRecords() {
+    for (int n = 0; n < MAX_BOARD_NODES; n++) {
+        historyFrom[n] = -1;
+        historyCount[n] = 0;
     }
+    for (int p = 0; p < 3; p++) {
+        killedUnits[p] = 0;
+        for (int n = 0; n < MAX_BOARD_NODES; n++) killerCount[p][n] = 0;
+    }
+}
 
-    // Row 0
-    adjacency[0][0] = { {1,0}, {1,1} };
-    adjacency[0][1] = { {0,0}, {1,0}, {1,1}, {1,2}, {2,1} };
-    adjacency[0][2] = { {0,1}, {1,1}, {1,2}, {1,3}, {2,2} };
-    adjacency[0][3] = { {0,2}, {1,2}, {1,3}, {1,4}, {2,3} };
-    adjacency[0][4] = { {0,3}, {1,3}, {1,4}, {2,3} };
+void GameBoard::reset() {
+    placeStartingUnits();
+    clearRecords();
+    currentPlayer = PLAYER1;
+    rebuildTargets();
+    refreshAccumulator();
 
-    // Row 1
-    adjacency[1][0] = { {0,0}, {0,1}, {2,0}, {2,1}, {3,0} };
-    adjacency[1][1] = { {0,1}, {1,0}, {2,1}, {2,2}, {3,1} };
-    adjacency[1][2] = { {0,2}, {1,1}, {2,2}, {2,3}, {3,2} };
-    adjacency[1][3] = { {0,3}, {1,2}, {2,3}, {2,4}, {3,3} };
-    adjacency[1][4] = { {0,4}, {1,3}, {2,4}, {3,3}, {3,4} };
+    hashKey = computeHash();
+}
 
-    // Row 2
-    adjacency[2][0] = { {1,0}, {3,0} };
-    adjacency[2][1] = { {0,1}, {1,0}, {1,1}, {3,1}, {4,1} };
-    adjacency[2][2] = { {0,2}, {1,1}, {1,2}, {3,2}, {4,2} };
-    adjacency[2][3] = { {0,3}, {1,3}, {1,4}, {3,3}, {4,3} };
-    adjacency[2][4] = { {1,4}, {3,4} };
+void GameBoard::setup(NodeMask player1, NodeMask player2, Player toMove, int killed1, int killed2) {
+    NodeMask onBoard = (topology->nodeCount() == MAX_BOARD_NODES) ? ~NodeMask(0) : nodeBit(topology->nodeCount()) - 1;
 
-    // Row 3
-    adjacency[3][0] = { {1,0}, {2,0}, {4,0}, {4,1} };
-    adjacency[3][1] = { {1,1}, {2,1}, {3,0}, {4,1}, {4,2} };
-    adjacency[3][2] = { {1,2}, {2,2}, {3,1}, {4,2}, {4,3} };
-    adjacency[3][3] = { {1,3}, {2,3}, {3,2}, {4,3}, {4,4} };
-    adjacency[3][4] = { {1,4}, {2,4}, {3,3}, {4,4} };
+    pieces[NONE] = 0;
+    pieces[PLAYER1] = player1 & onBoard;
+    pieces[PLAYER2] = player2 & ~player1 & onBoard;
 
-    // Row 4
-    adjacency[4][0] = { {3,0}, {4,1} };
-    adjacency[4][1] = { {2,1}, {3,0}, {3,1}, {4,0}, {4,2} };
-    adjacency[4][2] = { {2,2}, {3,2}, {3,3}, {4,1}, {4,3} };
-    adjacency[4][3] = { {2,3}, {3,3}, {3,4}, {4,2}, {4,4} };
-    adjacency[4][4] = { {3,4}, {4,3} };
+    clearRecords();
+    killedUnits[PLAYER1] = killed1;
+    killedUnits[PLAYER2] = killed2;
+    currentPlayer = toMove;
+    rebuildTargets();
+    refreshAccumulator();
+
+    hashKey = computeHash();
 }
 
-void GameBoard::reset() {
-    board.assign(5, std::vector<int>(5, NONE));
+uint64_t GameBoard::computeHash() const {
+    const ZobristKeys& keys = zobrist();
+    uint64_t key = 0;
 
-    for (int i = 0; i < 5; i++) {
-        board[0][i] = PLAYER1;
-        board[4][i] = PLAYER2;
+    for (int p = PLAYER1; p <= PLAYER2; p++) {
+        for (NodeMask m = pieces[p]; m; m &= m - 1) {
+            key ^= keys.piece[p][lowestNode(m)];
+        }
+        key ^= keys.killed[p][getKilledUnits((Player)p)];
     }
 
-    moveHistory.clear();
-    killedUnits[PLAYER1] = 0;
-    killedUnits[PLAYER2] = 0;
-    killerPositions.clear();
-    currentPlayer = PLAYER1;
+    for (int n = 0; n < topology->nodeCount(); n++) {
+        if (historyFrom[n] >= 0) key ^= historyKey(n, historyFrom[n], historyCount[n]);
+    }
+
+    if (currentPlayer == PLAYER2) key ^= keys.sideToMove;
+
+    return key;
+}
+
+void GameBoard::refreshTargets(int node) {
+    NodeMask occupied = pieces[PLAYER1] | pieces[PLAYER2];
+    if (!(occupied & nodeBit(node))) {
+        moveTargets[node] = 0;
+        return;
+    }
+
+    NodeMask targets = topology->adjacencyMask[node] & ~occupied;
+    if (historyCount[node] >= 2) targets &= ~nodeBit(historyFrom[node]);
+    moveTargets[node] = targets;
+}
+
+void GameBoard::rebuildTargets() {
+    for (int n = 0; n < MAX_BOARD_NODES; n++) {
+        moveTargets[n] = 0;
+    }
+    for (int n = 0; n < topology->nodeCount(); n++) {
+        refreshTargets(n);
+    }
+}
+
+// Occupancy of node changed: its own targets and those of every unit that
+// can step onto it are the only ones affected.
+void GameBoard::togglePiece(Player player, int node) {
+    pieces[player] ^= nodeBit(node);
+    hashKey ^= zobrist().piece[player][node];
+    if (network) network->update(accumulator, NNUE_UNIT, player, node, (pieces[player] & nodeBit(node)) != 0);
+
+    refreshTargets(node);
+    NodeMask occupied = pieces[PLAYER1] | pieces[PLAYER2];
+    for (NodeMask m = topology->reverseAdjacencyMask[node] & occupied; m; m &= m - 1) {
+        refreshTargets(lowestNode(m));
+    }
+}
+
+void GameBoard::setKilledUnits(Player player, int count) {
+    int& killed = killedUnits[player];
+    hashKey ^= zobrist().killed[player][killed] ^ zobrist().killed[player][count];
+    if (network && killed != count) {
+        network->update(accumulator, NNUE_KILLED, player, killed, false);
+        network->update(accumulator, NNUE_KILLED, player, count, true);
+    }
+    killed = count;
+}
+
+// Only whether a node has a kill on record is a network feature
+void GameBoard::setKillerCount(Player player, int node, int count) {
+    uint8_t& kills = killerCount[player][node];
+    if (network && (kills > 0) != (count > 0)) {
+        network->update(accumulator, NNUE_KILLER, player, node, count > 0);
+    }
+    kills = (uint8_t)count;
+}
+
+void GameBoard::setNetwork(const NnueNetwork* net) {
+    network = net;
+    refreshAccumulator();
+}
+
+void GameBoard::refreshAccumulator() {
+    if (!network) return;
+
+    network->clear(accumulator);
+    for (int p = PLAYER1; p <= PLAYER2; p++) {
+        for (NodeMask m = pieces[p]; m; m &= m - 1) {
+            network->update(accumulator, NNUE_UNIT, (Player)p, lowestNode(m), true);
+        }
+        for (NodeMask m = getKillerNodes((Player)p); m; m &= m - 1) {
+            network->update(accumulator, NNUE_KILLER, (Player)p, lowestNode(m), true);
+        }
+        network->update(accumulator, NNUE_KILLED, (Player)p, killedUnits[p], true);
+    }
+}
+
+// from < 0 clears the entry
+void GameBoard::setHistoryEntry(int to, int from, int count) {
+    if (historyFrom[to] >= 0) {
+        hashKey ^= historyKey(to, historyFrom[to], historyCount[to]);
+    }
+
+    historyFrom[to] = (int8_t)from;
+    historyCount[to] = (uint8_t)((from >= 0) ? std::min(count, 255) : 0);
+
+    if (from >= 0) {
+        hashKey ^= historyKey(to, from, historyCount[to]);
+    }
+    refreshTargets(to);
 }
 
 int GameBoard::getCell(const Position& pos) const {
     if (!isValidPosition(pos)) return NONE;
-    return board[pos.row][pos.col];
+
+    NodeMask bit = nodeBit(topology->nodeIndex(pos));
+    if (pieces[PLAYER1] & bit) return PLAYER1;
+    if (pieces[PLAYER2] & bit) return PLAYER2;
+    return NONE;
 }
 
 void GameBoard::setCell(const Position& pos, int value) {
     if (isValidPosition(pos)) {
-        board[pos.row][pos.col] = value;
+        int node = topology->nodeIndex(pos);
+        int current = getCell(pos);
+        if (current == value) return;
+
+        if (current != NONE) togglePiece((Player)current, node);
+        if (value == PLAYER1 || value == PLAYER2) togglePiece((Player)value, node);
     }
 }
 
 void GameBoard::switchPlayer() {
     currentPlayer = (currentPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+    hashKey ^= zobrist().sideToMove;
 }
 
 bool GameBoard::isValidPosition(const Position& pos) const {
-    return pos.row >= 0 && pos.row < 5 && pos.col >= 0 && pos.col < 5;
+    return topology->isValidPosition(pos);
 }
 
 bool GameBoard::isAdjacent(const Position& from, const Position& to) const {
     if (!isValidPosition(from) || !isValidPosition(to)) return false;
 
-    const auto& neighbors = adjacency[from.row][from.col];
-    return std::find(neighbors.begin(), neighbors.end(), to) != neighbors.end();
+    NodeMask neighbors = topology->adjacencyMask[topology->nodeIndex(from)];
+    return (neighbors & nodeBit(topology->nodeIndex(to))) != 0;
 }
 
 bool GameBoard::isOnStartLine(const Position& pos, Player player) const {
     // Player 1 starts at row 0, targets row 4 (opponent's start)
     // Player 2 starts at row 4, targets row 0 (opponent's start)
-    if (player == PLAYER1) return pos.row == 4; // On opponent's start line
-    if (player == PLAYER2) return pos.row == 0; // On opponent's start line
+    if (player == PLAYER1 || player == PLAYER2) return pos.row == topology->goalRow[player];
     return false;
 }
 
@@ -123,188 +261,339 @@ bool GameBoard::canShoot(const Position& from, const Position& to, Player shoote
 }
 
 bool GameBoard::wouldViolateThreeMoveRule(const Position& from, const Position& to) const {
-    auto it = moveHistory.find(from);
-    if (it == moveHistory.end()) return false;
+    if (!isValidPosition(from) || !isValidPosition(to)) return false;
 
-    if (it->second.first == to) {
-        if (it->second.second >= 2) return true;
-    }
+    int node = topology->nodeIndex(from);
+    return historyCount[node] >= 2 && historyFrom[node] == topology->nodeIndex(to);
+}
 
-    return false;
+NodeMask GameBoard::getMoveTargets(const Position& from) const {
+    if (!isValidPosition(from)) return 0;
+    return moveTargets[topology->nodeIndex(from)];
 }
 
 bool GameBoard::canMove(const Position& from, const Position& to) const {
     if (!isValidPosition(from) || !isValidPosition(to)) return false;
     if (getCell(from) != currentPlayer) return false;
-    if (getCell(to) != NONE) return false;
-    if (!isAdjacent(from, to)) return false;
-    if (wouldViolateThreeMoveRule(from, to)) return false;
 
-    return true;
+    return (getMoveTargets(from) & nodeBit(topology->nodeIndex(to))) != 0;
 }
 
-void GameBoard::checkAndRemoveShot(const Position& movedTo) {
+// Returns the node of the unit shot, -1 if none
+int GameBoard::checkAndRemoveShot(const Position& movedTo) {
     Player shooter = (Player)getCell(movedTo);
-    if (shooter == NONE) return;
+    if (shooter == NONE) return -1;
 
     // Rule: Can't shoot while standing on opponent's start line
-    // Player 1 targets row 4 (opponent's start), Player 2 targets row 0
-    int opponentStartRow = (shooter == PLAYER1) ? 4 : 0;
-    if (movedTo.row == opponentStartRow) {
-        return; // Can't shoot from opponent's start line
+    if (movedTo.row == topology->goalRow[shooter]) {
+        return -1; // Can't shoot from opponent's start line
     }
 
-    // Check all adjacent positions for enemy units
-    const auto& neighbors = adjacency[movedTo.row][movedTo.col];
+    // Check all adjacent positions for enemy units, in ascending node order
+    Player enemy = (shooter == PLAYER1) ? PLAYER2 : PLAYER1;
+    int shooterNode = topology->nodeIndex(movedTo);
+    NodeMask targets = topology->adjacencyMask[shooterNode] & pieces[enemy];
+    if (!targets) return -1;
 
-    for (const auto& targetPos : neighbors) {
-        int targetPiece = getCell(targetPos);
+    // Enemy found on "line of fire" (adjacent position = direct line in graph)
+    // Remove the enemy
+    int victim = lowestNode(targets);
+    togglePiece(enemy, victim);
+    setKilledUnits(enemy, getKilledUnits(enemy) + 1);
 
-        // Is there an enemy on this adjacent position?
-        if (targetPiece == NONE || targetPiece == shooter) {
-            continue; // No enemy here
-        }
+    // Record this position as having made a kill (needed for revival rule)
+    setKillerCount(shooter, shooterNode, killerCount[shooter][shooterNode] + 1);
 
-        // Enemy found on "line of fire" (adjacent position = direct line in graph)
-        // Remove the enemy
-        setCell(targetPos, NONE);
-        killedUnits[targetPiece]++;
+    // Only one kill per move
+    return victim;
+}
 
-        // Record this position as having made a kill (needed for revival rule)
-        killerPositions[shooter].push_back(movedTo);
+template <typename Layout>
+void GameBoard::generateMoves(const Layout& layout, std::vector<Move>& moves) const {
+    for (NodeMask own = pieces[currentPlayer]; own; own &= own - 1) {
+        int fromNode = lowestNode(own);
+        Position from(fromNode / layout.cols(), fromNode % layout.cols());
 
-        // Only one kill per move
-        return;
+        for (NodeMask targets = moveTargets[fromNode]; targets; targets &= targets - 1) {
+            int toNode = lowestNode(targets);
+            moves.push_back(Move(from, Position(toNode / layout.cols(), toNode % layout.cols())));
+        }
+    }
+
+    // Revival moves
+    if (killedUnits[currentPlayer] > 0) {
+        NodeMask empty = ~(pieces[PLAYER1] | pieces[PLAYER2]);
+        NodeMask freeStart = layout.startMask(currentPlayer) & empty;
+        if (!freeStart) return;
+
+        Move reviveMove;
+        reviveMove.isRevival = true;
+        int startNode = lowestNode(freeStart);
+        reviveMove.revivePos = Position(startNode / layout.cols(), startNode % layout.cols());
+
+        for (NodeMask m = revivalNodes(currentPlayer, layout.goalMask(currentPlayer)); m; m &= m - 1) {
+            int node = lowestNode(m);
+            reviveMove.from = Position(node / layout.cols(), node % layout.cols());
+            reviveMove.to = reviveMove.from;
+            moves.push_back(reviveMove);
+        }
     }
 }
 
 std::vector<Move> GameBoard::getLegalMoves() const {
     std::vector<Move> moves;
+    getLegalMoves(moves);
+    return moves;
+}
 
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            Position from(r, c);
-            if (getCell(from) != currentPlayer) continue;
+void GameBoard::getLegalMoves(std::vector<Move>& moves) const {
+    moves.clear();
 
-            const auto& neighbors = adjacency[r][c];
-            for (const auto& to : neighbors) {
-                if (canMove(from, to)) {
-                    moves.push_back(Move(from, to));
-                }
-            }
-        }
+    if (topology->isStandard()) {
+        generateMoves(StandardLayout(), moves);
     }
-
-    // Revival moves
-    if (killedUnits.find(currentPlayer) != killedUnits.end() &&
-        killedUnits.at(currentPlayer) > 0) {
-
-        auto revivalPos = getRevivalPositions(currentPlayer);
-        for (const auto& pos : revivalPos) {
-            Move reviveMove;
-            reviveMove.from = pos;
-            reviveMove.to = pos;
-            reviveMove.isRevival = true;
-
-            int startRow = (currentPlayer == PLAYER1) ? 0 : 4;
-            for (int c = 0; c < 5; c++) {
-                Position revPos(startRow, c);
-                if (getCell(revPos) == NONE) {
-                    reviveMove.revivePos = revPos;
-                    moves.push_back(reviveMove);
-                    break;
-                }
-            }
-        }
+    else {
+        generateMoves(TopologyLayout{ topology }, moves);
     }
+}
 
+std::vector<Move> GameBoard::getLegalMovesOrPass() const {
+    std::vector<Move> moves;
+    getLegalMovesOrPass(moves);
     return moves;
 }
 
+void GameBoard::getLegalMovesOrPass(std::vector<Move>& moves) const {
+    getLegalMoves(moves);
+    if (moves.empty()) moves.push_back(Move::pass());
+}
+
 void GameBoard::makeMove(const Move& move) {
-    if (move.isRevival) {
-        setCell(move.revivePos, currentPlayer);
-        killedUnits[currentPlayer]--;
+    MoveUndo undo;
+    makeMove(move, undo);
+}
+
+void GameBoard::makeMove(const Move& move, MoveUndo& undo) {
+    undo.victim = -1;
+    undo.killerUsed = false;
 
-        auto& killers = killerPositions[currentPlayer];
-        auto it = std::find(killers.begin(), killers.end(), move.from);
-        if (it != killers.end()) {
-            killers.erase(it);
+    if (move.isPass) {
+        undo.piece = NONE;
+    }
+    else if (move.isRevival) {
+        undo.piece = NONE;
+        setCell(move.revivePos, currentPlayer);
+        setKilledUnits(currentPlayer, getKilledUnits(currentPlayer) - 1);
+
+        if (isValidPosition(move.from)) {
+            int node = topology->nodeIndex(move.from);
+            int kills = killerCount[currentPlayer][node];
+            if (kills > 0) {
+                setKillerCount(currentPlayer, node, kills - 1);
+                undo.killerUsed = true;
+            }
         }
     }
     else {
-        int piece = getCell(move.from);
+        int fromNode = topology->nodeIndex(move.from);
+        int toNode = topology->nodeIndex(move.to);
+
+        undo.piece = getCell(move.from);
+        undo.entryFrom[0] = historyFrom[fromNode];
+        undo.entryCount[0] = historyCount[fromNode];
+        undo.entryFrom[1] = historyFrom[toNode];
+        undo.entryCount[1] = historyCount[toNode];
+
         setCell(move.from, NONE);
-        setCell(move.to, piece);
+        setCell(move.to, undo.piece);
 
         // Update move history for 3-move rule
-        auto it = moveHistory.find(move.to);
-        if (it != moveHistory.end() && it->second.first == move.from) {
-            moveHistory[move.to].second++;
+        if (historyFrom[toNode] == fromNode) {
+            setHistoryEntry(toNode, fromNode, historyCount[toNode] + 1);
         }
         else {
-            moveHistory[move.to] = { move.from, 1 };
+            setHistoryEntry(toNode, fromNode, 1);
         }
 
-        moveHistory.erase(move.from);
+        setHistoryEntry(fromNode, -1, 0);
 
         // Check if this move results in shooting an enemy
-        checkAndRemoveShot(move.to);
+        undo.victim = checkAndRemoveShot(move.to);
     }
 }
 
-bool GameBoard::isGameOver() const {
-    int p1OnP2Start = 0, p2OnP1Start = 0;
+void GameBoard::unmakeMove(const Move& move, const MoveUndo& undo) {
+    if (move.isPass) return;
+
+    if (move.isRevival) {
+        if (undo.killerUsed) {
+            int node = topology->nodeIndex(move.from);
+            setKillerCount(currentPlayer, node, killerCount[currentPlayer][node] + 1);
+        }
+        setKilledUnits(currentPlayer, getKilledUnits(currentPlayer) + 1);
+        setCell(move.revivePos, NONE);
+        return;
+    }
+
+    int fromNode = topology->nodeIndex(move.from);
+    int toNode = topology->nodeIndex(move.to);
 
-    for (int c = 0; c < 5; c++) {
-        if (board[0][c] == PLAYER2) p2OnP1Start++;
-        if (board[4][c] == PLAYER1) p1OnP2Start++;
+    if (undo.victim >= 0) {
+        Player shooter = (Player)undo.piece;
+        Player enemy = (shooter == PLAYER1) ? PLAYER2 : PLAYER1;
+        setKillerCount(shooter, toNode, killerCount[shooter][toNode] - 1);
+        setKilledUnits(enemy, getKilledUnits(enemy) - 1);
+        togglePiece(enemy, undo.victim);
     }
 
-    return p1OnP2Start == 5 || p2OnP1Start == 5;
+    setCell(move.to, NONE);
+    setCell(move.from, undo.piece);
+
+    setHistoryEntry(toNode, undo.entryFrom[1], undo.entryCount[1]);
+    setHistoryEntry(fromNode, undo.entryFrom[0], undo.entryCount[0]);
 }
 
-Player GameBoard::getWinner() const {
-    int p1OnP2Start = 0, p2OnP1Start = 0;
+template <Player Us>
+void GameBoard::makeMoveAs(const Move& move, MoveUndo& undo) {
+    constexpr Player Them = (Us == PLAYER1) ? PLAYER2 : PLAYER1;
+    undo.victim = -1;
+    undo.killerUsed = false;
+
+    if (move.isRevival) {
+        undo.piece = NONE;
+        togglePiece(Us, topology->nodeIndex(move.revivePos));
+        setKilledUnits(Us, killedUnits[Us] - 1);
+
+        if (isValidPosition(move.from)) {
+            int node = topology->nodeIndex(move.from);
+            int kills = killerCount[Us][node];
+            if (kills > 0) {
+                setKillerCount(Us, node, kills - 1);
+                undo.killerUsed = true;
+            }
+        }
+        return;
+    }
+
+    int fromNode = topology->nodeIndex(move.from);
+    int toNode = topology->nodeIndex(move.to);
 
-    for (int c = 0; c < 5; c++) {
-        if (board[4][c] == PLAYER1) p1OnP2Start++;
-        if (board[0][c] == PLAYER2) p2OnP1Start++;
+    undo.piece = Us;
+    undo.entryFrom[0] = historyFrom[fromNode];
+    undo.entryCount[0] = historyCount[fromNode];
+    undo.entryFrom[1] = historyFrom[toNode];
+    undo.entryCount[1] = historyCount[toNode];
+
+    togglePiece(Us, fromNode);
+    togglePiece(Us, toNode);
+
+    if (historyFrom[toNode] == fromNode) {
+        setHistoryEntry(toNode, fromNode, historyCount[toNode] + 1);
+    }
+    else {
+        setHistoryEntry(toNode, fromNode, 1);
     }
+    setHistoryEntry(fromNode, -1, 0);
 
-    if (p1OnP2Start == 5) return PLAYER1;
-    if (p2OnP1Start == 5) return PLAYER2;
+    // Shot, as in checkAndRemoveShot
+    if (move.to.row == topology->goalRow[Us]) return;
+
+    NodeMask targets = topology->adjacencyMask[toNode] & pieces[Them];
+    if (!targets) return;
+
+    int victim = lowestNode(targets);
+    togglePiece(Them, victim);
+    setKilledUnits(Them, killedUnits[Them] + 1);
+    setKillerCount(Us, toNode, killerCount[Us][toNode] + 1);
+    undo.victim = victim;
+}
+
+template <Player Us>
+void GameBoard::unmakeMoveAs(const Move& move, const MoveUndo& undo) {
+    constexpr Player Them = (Us == PLAYER1) ? PLAYER2 : PLAYER1;
+
+    if (move.isRevival) {
+        if (undo.killerUsed) {
+            int node = topology->nodeIndex(move.from);
+            setKillerCount(Us, node, killerCount[Us][node] + 1);
+        }
+        setKilledUnits(Us, killedUnits[Us] + 1);
+        togglePiece(Us, topology->nodeIndex(move.revivePos));
+        return;
+    }
+
+    int fromNode = topology->nodeIndex(move.from);
+    int toNode = topology->nodeIndex(move.to);
+
+    if (undo.victim >= 0) {
+        setKillerCount(Us, toNode, killerCount[Us][toNode] - 1);
+        setKilledUnits(Them, killedUnits[Them] - 1);
+        togglePiece(Them, undo.victim);
+    }
+
+    togglePiece(Us, toNode);
+    togglePiece(Us, fromNode);
+
+    setHistoryEntry(toNode, undo.entryFrom[1], undo.entryCount[1]);
+    setHistoryEntry(fromNode, undo.entryFrom[0], undo.entryCount[0]);
+}
+
+template void GameBoard::makeMoveAs<PLAYER1>(const Move& move, MoveUndo& undo);
+template void GameBoard::makeMoveAs<PLAYER2>(const Move& move, MoveUndo& undo);
+template void GameBoard::unmakeMoveAs<PLAYER1>(const Move& move, const MoveUndo& undo);
+template void GameBoard::unmakeMoveAs<PLAYER2>(const Move& move, const MoveUndo& undo);
+
+template <typename Layout>
+Player GameBoard::winnerOn(const Layout& layout) const {
+    // A player wins by filling the whole opponent's start line
+    if ((pieces[PLAYER1] & layout.goalMask(PLAYER1)) == layout.goalMask(PLAYER1)) return PLAYER1;
+    if ((pieces[PLAYER2] & layout.goalMask(PLAYER2)) == layout.goalMask(PLAYER2)) return PLAYER2;
     return NONE;
 }
 
+bool GameBoard::isGameOver() const {
+    return getWinner() != NONE;
+}
+
+Player GameBoard::getWinner() const {
+    if (topology->isStandard()) {
+        return winnerOn(StandardLayout());
+    }
+    return winnerOn(TopologyLayout{ topology });
+}
+
 int GameBoard::getKilledUnits(Player player) const {
-    auto it = killedUnits.find(player);
-    return (it != killedUnits.end()) ? it->second : 0;
+    return (player == PLAYER1 || player == PLAYER2) ? killedUnits[player] : 0;
 }
 
-bool GameBoard::canRevive(Player player, const Position& pos) const {
-    if (getCell(pos) != player) return false;
+NodeMask GameBoard::getKillerNodes(Player player) const {
+    NodeMask nodes = 0;
+    for (int n = 0; n < topology->nodeCount(); n++) {
+        if (killerCount[player][n] > 0) nodes |= nodeBit(n);
+    }
+    return nodes;
+}
 
-    auto it = killerPositions.find(player);
-    if (it == killerPositions.end()) return false;
+// Own units on the goal row that have a kill recorded where they stand
+NodeMask GameBoard::revivalNodes(Player player, NodeMask goal) const {
+    NodeMask nodes = 0;
+    for (NodeMask m = pieces[player] & goal; m; m &= m - 1) {
+        int node = lowestNode(m);
+        if (killerCount[player][node] > 0) nodes |= nodeBit(node);
+    }
+    return nodes;
+}
 
-    return std::find(it->second.begin(), it->second.end(), pos) != it->second.end();
+bool GameBoard::canRevive(Player player, const Position& pos) const {
+    if (getCell(pos) != player) return false;
+    return killerCount[player][topology->nodeIndex(pos)] > 0;
 }
 
 std::vector<Position> GameBoard::getRevivalPositions(Player player) const {
     std::vector<Position> positions;
 
-    int targetRow = (player == PLAYER1) ? 4 : 0;
-
-    for (int r = 0; r < 5; r++) {
-        for (int c = 0; c < 5; c++) {
-            Position pos(r, c);
-            if (getCell(pos) == player && pos.row == targetRow) {
-                if (canRevive(player, pos)) {
-                    positions.push_back(pos);
-                }
-            }
-        }
+    for (NodeMask m = revivalNodes(player, topology->goalMask[player]); m; m &= m - 1) {
+        positions.push_back(topology->nodePosition(lowestNode(m)));
     }
 
     return positions;
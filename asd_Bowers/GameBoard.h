@@ -1,31 +1,79 @@
 #pragma once
+#include <cstdint>
 #include <vector>
-#include <map>
 #include "GameTypes.h"
+#include "BoardTopology.h"
+#include "Nnue.h"
+
+// Everything makeMove changed, so unmakeMove can put it back
+struct MoveUndo {
+    int piece;                  // unit that moved, NONE for a revival
+    int8_t entryFrom[2];        // three-move entries at move.from and move.to before the move
+    uint8_t entryCount[2];
+    int victim;                 // node of the unit shot, -1 if none
+    bool killerUsed;            // a revival consumed a kill record at move.from
+};
 
 class GameBoard {
 private:
-    std::vector<std::vector<int>> board;
-    std::map<Position, std::pair<Position, int>> moveHistory;
-    std::map<int, int> killedUnits;
-    std::map<int, std::vector<Position>> killerPositions;
+    const BoardTopology* topology;
+    NodeMask pieces[3];             // occupancy per Player, index 0 unused
+
+    // Empty neighbors each unit may step to, kept current by every change
+    // to occupancy or to the three-move history; 0 on empty nodes.
+    NodeMask moveTargets[MAX_BOARD_NODES];
+
+    // Three-move rule, per destination node: where the last unit to arrive
+    // came from (-1 = none) and how many times in a row it did so
+    int8_t historyFrom[MAX_BOARD_NODES];
+    uint8_t historyCount[MAX_BOARD_NODES];
+
+    uint8_t killerCount[3][MAX_BOARD_NODES];    // kills made from each node, per Player
+    int killedUnits[3];
     Player currentPlayer;
+    uint64_t hashKey;
+
+    // Evaluation network the accumulator is kept current for, or nullptr
+    const NnueNetwork* network;
+    NnueAccumulator accumulator;
 
-    void initializeAdjacency();
+    void placeStartingUnits();
+    void clearRecords();
+    uint64_t computeHash() const;
+    void togglePiece(Player player, int node);
+    void setKilledUnits(Player player, int count);
+    void setKillerCount(Player player, int node, int count);
+    void setHistoryEntry(int to, int from, int count);
+    void refreshTargets(int node);
+    void rebuildTargets();
+    void refreshAccumulator();
     bool isOnStartLine(const Position& pos, Player player) const;
     bool canShoot(const Position& from, const Position& to, Player shooter) const;
-    void checkAndRemoveShot(const Position& movedTo);
+    int checkAndRemoveShot(const Position& movedTo);
+    NodeMask revivalNodes(Player player, NodeMask goal) const;
 
-public:
-    std::vector<std::vector<std::vector<Position>>> adjacency;
+    template <typename Layout> void generateMoves(const Layout& layout, std::vector<Move>& moves) const;
+    template <typename Layout> Player winnerOn(const Layout& layout) const;
 
+public:
     GameBoard();
-    GameBoard(const GameBoard& other);
+    explicit GameBoard(const BoardTopology& topology);
 
     void reset();
+    // Arbitrary position with an empty move history and no kill records
+    void setup(NodeMask player1, NodeMask player2, Player toMove, int killed1, int killed2);
+    const BoardTopology& getTopology() const { return *topology; }
+    NodeMask getPieces(Player player) const { return pieces[player]; }
     int getCell(const Position& pos) const;
     void setCell(const Position& pos, int value);
     Player getCurrentPlayer() const { return currentPlayer; }
+
+    // Zobrist key of the rule state: units, side to move, killed counts and
+    // three-move history. Kept up to date incrementally. Kills on record are
+    // left out: one is only recorded on the shooter's node, shots from the
+    // goal row are illegal, so no revival is reachable and they never change
+    // how a position plays.
+    uint64_t getHash() const { return hashKey; }
     void switchPlayer();
 
     bool isValidPosition(const Position& pos) const;
@@ -33,13 +81,43 @@ public:
     bool canMove(const Position& from, const Position& to) const;
     bool wouldViolateThreeMoveRule(const Position& from, const Position& to) const;
 
+    // Nodes the unit on from can step to (three-move rule applied), O(1)
+    NodeMask getMoveTargets(const Position& from) const;
+
     std::vector<Move> getLegalMoves() const;
+    void getLegalMoves(std::vector<Move>& moves) const;
+    // The legal moves, or Move::pass() alone for a side that has none
+    std::vector<Move> getLegalMovesOrPass() const;
+    void getLegalMovesOrPass(std::vector<Move>& moves) const;
+    // A pass leaves the board as it is; the caller switches the player as
+    // after any move
     void makeMove(const Move& move);
+    // Same as makeMove, recording what unmakeMove needs to restore the board
+    void makeMove(const Move& move, MoveUndo& undo);
+    void unmakeMove(const Move& move, const MoveUndo& undo);
+    // The same for a legal move of Us, the side to move, with the mover and
+    // the victim's side known at compile time (search hot path; no pass)
+    template <Player Us> void makeMoveAs(const Move& move, MoveUndo& undo);
+    template <Player Us> void unmakeMoveAs(const Move& move, const MoveUndo& undo);
 
     bool isGameOver() const;
     Player getWinner() const;
 
+    // Three-move entry of a node (from -1 = none), for saving positions
+    // outside the board and putting them back with setup + setHistory
+    int getHistoryFrom(int node) const { return historyFrom[node]; }
+    int getHistoryCount(int node) const { return historyCount[node]; }
+    void setHistory(int node, int from, int count) { setHistoryEntry(node, from, count); }
+
+    // Attaches a network (nullptr detaches); from then on every change to
+    // the board updates its first layer incrementally. Must outlive use.
+    void setNetwork(const NnueNetwork* net);
+    const NnueNetwork* getNetwork() const { return network; }
+    const NnueAccumulator& getAccumulator() const { return accumulator; }
+
     int getKilledUnits(Player player) const;
+    // Nodes player has made a kill from
+    NodeMask getKillerNodes(Player player) const;
     bool canRevive(Player player, const Position& pos) const;
     std::vector<Position> getRevivalPositions(Player player) const;
 };
@@ -0,0 +1,623 @@
+#include "GameServer.h"
+#include <algorithm>
+#include "Notation.h"
+
+#if defined(_WIN32)
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const size_t LATENCY_WINDOW = 100000;
+    const size_t MAX_LINE = 4096;
+    const int MAX_EVENTS = 256;
+}
+
+// Readiness notification over the listener, the clients and (on Linux) an
+// eventfd the search threads use to wake the loop when results are ready.
+class GameServer::Poller {
+public:
+    struct Event {
+        SocketHandle socket;
+        bool readable;
+        bool writable;
+        bool hangup;
+    };
+
+#if defined(_WIN32)
+    Poller() {}
+    ~Poller() {}
+
+    bool ok() const { return true; }
+    void wake() {}
+
+    void add(SocketHandle socket) {
+        index[socket] = fds.size();
+        WSAPOLLFD fd = {};
+        fd.fd = socket;
+        fd.events = POLLRDNORM;
+        fds.push_back(fd);
+    }
+
+    void setWriteInterest(SocketHandle socket, bool enabled) {
+        auto it = index.find(socket);
+        if (it == index.end()) return;
+        fds[it->second].events = enabled ? (POLLRDNORM | POLLWRNORM) : POLLRDNORM;
+    }
+
+    void remove(SocketHandle socket) {
+        auto it = index.find(socket);
+        if (it == index.end()) return;
+        size_t i = it->second;
+        index.erase(it);
+        if (i != fds.size() - 1) {
+            fds[i] = fds.back();
+            index[fds[i].fd] = i;
+        }
+        fds.pop_back();
+    }
+
+    // WSAPoll can't wait on a cross-thread event, so poll with a short
+    // timeout while searches are outstanding.
+    void wait(std::vector<Event>& events, bool resultsPending) {
+        events.clear();
+        int n = WSAPoll(fds.data(), (ULONG)fds.size(), resultsPending ? 1 : 50);
+        for (size_t i = 0; n > 0 && i < fds.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            Event e;
+            e.socket = fds[i].fd;
+            e.readable = (fds[i].revents & POLLRDNORM) != 0;
+            e.writable = (fds[i].revents & POLLWRNORM) != 0;
+            e.hangup = (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+            events.push_back(e);
+        }
+    }
+
+private:
+    std::vector<WSAPOLLFD> fds;
+    std::unordered_map<SocketHandle, size_t> index;
+#else
+    Poller() : epollFd(epoll_create1(0)), wakeFd(eventfd(0, EFD_NONBLOCK)) {
+        if (ok()) {
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = wakeFd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+        }
+    }
+
+    ~Poller() {
+        if (wakeFd >= 0) close(wakeFd);
+        if (epollFd >= 0) close(epollFd);
+    }
+
+    bool ok() const { return epollFd >= 0 && wakeFd >= 0; }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+
+    void add(SocketHandle socket) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = socket;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &ev);
+    }
+
+    void setWriteInterest(SocketHandle socket, bool enabled) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | (enabled ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.fd = socket;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, socket, &ev);
+    }
+
+    void remove(SocketHandle socket) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr);
+    }
+
+    void wait(std::vector<Event>& events, bool resultsPending) {
+        (void)resultsPending;
+        events.clear();
+
+        epoll_event ready[MAX_EVENTS];
+        int n = epoll_wait(epollFd, ready, MAX_EVENTS, 100);
+        for (int i = 0; i < n; i++) {
+            if (ready[i].data.fd == wakeFd) {
+                uint64_t count;
+                ssize_t got = read(wakeFd, &count, sizeof(count));
+                (void)got;
+                continue;
+            }
+            Event e;
+            e.socket = ready[i].data.fd;
+            e.readable = (ready[i].events & EPOLLIN) != 0;
+            e.writable = (ready[i].events & EPOLLOUT) != 0;
+            e.hangup = (ready[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+            events.push_back(e);
+        }
+    }
+
+private:
+    int epollFd;
+    int wakeFd;
+#endif
+};
+
+GameServer::GameServer(const ServerConfig& serverConfig)
+    : config(serverConfig), listener(INVALID_SOCKET_HANDLE), running(false), nextSessionId(1),
+    pendingJobs(0), latencyNext(0), aiMoves(0), totalQueueUs(0), totalSearchUs(0) {
+}
+
+GameServer::~GameServer() {
+    // Stops the searches before the poller they wake goes away
+    searchService.reset();
+
+    for (auto& entry : connections) {
+        closeSocket(entry.first);
+    }
+    if (listener != INVALID_SOCKET_HANDLE) {
+        closeSocket(listener);
+    }
+}
+
+bool GameServer::start(std::string& error) {
+    poller.reset(new Poller());
+    if (!poller->ok()) {
+        error = "cannot create poller";
+        return false;
+    }
+
+#if !defined(_WIN32)
+    if (!config.unixPath.empty()) {
+        listener = listenUnix(config.unixPath, error);
+    }
+    else
+#endif
+    {
+        listener = listenTcp(config.port, error);
+    }
+    if (listener == INVALID_SOCKET_HANDLE) return false;
+
+    poller->add(listener);
+
+    searchService.reset(new SearchService(config.workers, (size_t)config.queueLimit));
+
+    running = true;
+    return true;
+}
+
+void GameServer::stop() {
+    running = false;
+    if (poller) poller->wake();
+}
+
+void GameServer::run() {
+    std::vector<Poller::Event> events;
+
+    while (running) {
+        poller->wait(events, pendingJobs > 0);
+
+        for (const auto& e : events) {
+            if (e.socket == listener) {
+                acceptClients();
+                continue;
+            }
+
+            if (e.readable || e.hangup) {
+                readClient(e.socket);
+            }
+            if (e.writable) {
+                auto it = connections.find(e.socket);
+                if (it != connections.end()) flushClient(it->second);
+            }
+        }
+
+        drainResults();
+    }
+}
+
+void GameServer::wakeLoop() {
+    poller->wake();
+}
+
+void GameServer::drainResults() {
+    std::vector<AiResult> ready;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        ready.swap(results);
+    }
+
+    for (const auto& result : ready) {
+        pendingJobs--;
+
+        // The session may have been closed while its search ran
+        auto it = sessions.find(result.sessionId);
+        if (it == sessions.end() || result.outcome.status == SEARCH_CANCELLED) continue;
+
+        Session& session = it->second;
+        session.aiThinking = false;
+
+        // Only a legal move (or the pass) of this position is played
+        Move move;
+        if (!parseMove(session.board, moveToString(result.outcome.bestMove), move)) {
+            auto conn = connections.find(session.owner);
+            if (conn != connections.end()) {
+                send(conn->second, "error bad ai move " + std::to_string(session.id));
+            }
+            continue;
+        }
+
+        applyMove(session, move);
+        recordLatency(session.requestTime);
+        aiMoves++;
+        totalQueueUs += result.outcome.queueUs;
+        totalSearchUs += result.outcome.searchUs;
+        sendAiMove(session, moveToString(move));
+    }
+
+    // Finished jobs made room in the queue
+    if (!ready.empty()) retryAiMoves();
+}
+
+void GameServer::acceptClients() {
+    for (;;) {
+        SocketHandle client = acceptClient(listener);
+        if (client == INVALID_SOCKET_HANDLE) break;
+
+        Connection& connection = connections[client];
+        connection.socket = client;
+        connection.writeInterest = false;
+        poller->add(client);
+    }
+}
+
+void GameServer::readClient(SocketHandle socket) {
+    auto it = connections.find(socket);
+    if (it == connections.end()) return;
+    Connection& connection = it->second;
+
+    // Lines that arrived before the client closed its side are still served
+    char buffer[4096];
+    bool closed = false;
+    for (;;) {
+        int n = recvSome(socket, buffer, sizeof(buffer));
+        if (n > 0) {
+            connection.input.append(buffer, n);
+            continue;
+        }
+        closed = !(n < 0 && lastErrorWouldBlock());
+        break;
+    }
+
+    size_t start = 0;
+    for (;;) {
+        size_t end = connection.input.find('\n', start);
+        if (end == std::string::npos) break;
+
+        std::string line = connection.input.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+
+        if (line == "quit") {
+            flushClient(connection);
+            closeClient(socket);
+            return;
+        }
+        handleLine(connection, line);
+    }
+    connection.input.erase(0, start);
+
+    if (closed) {
+        flushClient(connection);
+        closeClient(socket);
+    }
+    else if (connection.input.size() > MAX_LINE) {
+        closeClient(socket);
+    }
+}
+
+void GameServer::flushClient(Connection& connection) {
+    while (!connection.output.empty()) {
+        int n = sendSome(connection.socket, connection.output.data(), (int)connection.output.size());
+        if (n <= 0) break;
+        connection.output.erase(0, n);
+    }
+
+    bool wantWrite = !connection.output.empty();
+    if (wantWrite != connection.writeInterest) {
+        connection.writeInterest = wantWrite;
+        poller->setWriteInterest(connection.socket, wantWrite);
+    }
+}
+
+void GameServer::closeClient(SocketHandle socket) {
+    auto it = connections.find(socket);
+    if (it == connections.end()) return;
+
+    for (int id : it->second.sessions) {
+        closeSession(id);
+    }
+
+    poller->remove(socket);
+    closeSocket(socket);
+    connections.erase(it);
+}
+
+void GameServer::send(Connection& connection, const std::string& line) {
+    connection.output += line;
+    connection.output += '\n';
+    flushClient(connection);
+}
+
+void GameServer::handleLine(Connection& connection, const std::string& line) {
+    std::istringstream args(line);
+    std::string command;
+    if (!(args >> command)) return;
+
+    if (command == "new") {
+        handleNew(connection, args);
+    }
+    else if (command == "move") {
+        handleMove(connection, args);
+    }
+    else if (command == "state") {
+        Session* session = findSession(connection, args);
+        if (!session) return;
+        send(connection, "state " + std::to_string(session->id) + " " + boardToString(session->board) +
+            " " + statusOf(*session));
+    }
+    else if (command == "moves") {
+        Session* session = findSession(connection, args);
+        if (!session) return;
+        std::string reply = "moves " + std::to_string(session->id);
+        if (!isFinished(*session)) {
+            for (const auto& move : session->board.getLegalMovesOrPass()) {
+                reply += " " + moveToString(move);
+            }
+        }
+        send(connection, reply);
+    }
+    else if (command == "close") {
+        Session* session = findSession(connection, args);
+        if (!session) return;
+        int id = session->id;
+        closeSession(id);
+        connection.sessions.erase(std::remove(connection.sessions.begin(), connection.sessions.end(), id),
+            connection.sessions.end());
+        send(connection, "closed " + std::to_string(id));
+    }
+    else if (command == "stats") {
+        handleStats(connection);
+    }
+    else {
+        send(connection, "error unknown command " + command);
+    }
+}
+
+void GameServer::handleNew(Connection& connection, std::istringstream& args) {
+    Session session;
+    session.id = nextSessionId++;
+    session.owner = connection.socket;
+    session.aiSide = PLAYER2;
+    session.depth = config.defaultDepth;
+    session.timeMs = config.defaultTimeMs;
+    session.priority = 0;
+    session.aiThinking = false;
+    session.jobId = 0;
+    session.drawReason = DRAW_NONE;
+    session.history.push(session.board.getHash());
+
+    std::string token;
+    while (args >> token) {
+        if (token == "ai") {
+            args >> token;
+            session.aiSide = (token == "1") ? PLAYER1 : (token == "2") ? PLAYER2 : NONE;
+        }
+        else if (token == "depth") {
+            args >> session.depth;
+            session.depth = std::max(1, std::min(session.depth, MAX_SEARCH_DEPTH));
+        }
+        else if (token == "time") {
+            args >> session.timeMs;
+            session.timeMs = std::max<int64_t>(0, session.timeMs);
+        }
+        else if (token == "priority") {
+            args >> session.priority;
+        }
+    }
+
+    int id = session.id;
+    Session& stored = sessions[id] = std::move(session);
+    connection.sessions.push_back(id);
+    send(connection, "game " + std::to_string(id));
+
+    if (stored.aiSide == stored.board.getCurrentPlayer()) {
+        stored.requestTime = Clock::now();
+        requestAiMove(stored);
+    }
+}
+
+void GameServer::handleMove(Connection& connection, std::istringstream& args) {
+    Clock::time_point received = Clock::now();
+
+    Session* session = findSession(connection, args);
+    if (!session) return;
+
+    std::string text;
+    args >> text;
+
+    if (isFinished(*session)) {
+        send(connection, "error game over");
+        return;
+    }
+    if (session->aiThinking || session->board.getCurrentPlayer() == session->aiSide) {
+        send(connection, "error not your turn");
+        return;
+    }
+
+    Move move;
+    if (!parseMove(session->board, text, move)) {
+        send(connection, "error illegal move " + text);
+        return;
+    }
+    applyMove(*session, move);
+    send(connection, "moved " + std::to_string(session->id) + " " + text + " " + statusOf(*session));
+
+    if (!isFinished(*session) && session->board.getCurrentPlayer() == session->aiSide) {
+        session->requestTime = received;
+        requestAiMove(*session);
+    }
+}
+
+void GameServer::handleStats(Connection& connection) {
+    std::vector<uint32_t> samples(latencySamples);
+    auto percentile = [&samples](double p) -> uint32_t {
+        if (samples.empty()) return 0;
+        size_t k = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+        return samples[k];
+    };
+
+    SearchServiceStats service = searchService->getStats();
+    int64_t turns = std::max<int64_t>(1, (int64_t)aiMoves);
+
+    send(connection, "stats sessions " + std::to_string(sessions.size()) +
+        " connections " + std::to_string(connections.size()) +
+        " workers " + std::to_string(searchService->getWorkerCount()) +
+        " queued " + std::to_string(service.queued) +
+        " running " + std::to_string(service.running) +
+        " aimoves " + std::to_string(aiMoves) +
+        " preempted " + std::to_string(service.preempted) +
+        " rejected " + std::to_string(service.rejected) +
+        " deadline_cut " + std::to_string(service.deadlineCut) +
+        " queue_avg_us " + std::to_string(totalQueueUs / turns) +
+        " search_avg_us " + std::to_string(totalSearchUs / turns) +
+        " p50_us " + std::to_string(percentile(0.50)) +
+        " p99_us " + std::to_string(percentile(0.99)) +
+        " p999_us " + std::to_string(percentile(0.999)) +
+        " max_us " + std::to_string(percentile(1.0)));
+}
+
+GameServer::Session* GameServer::findSession(Connection& connection, std::istringstream& args) {
+    int id = 0;
+    args >> id;
+
+    auto it = sessions.find(id);
+    if (it == sessions.end() || it->second.owner != connection.socket) {
+        send(connection, "error no game " + std::to_string(id));
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void GameServer::requestAiMove(Session& session) {
+    // Nothing to search: the AI passes at once
+    if (session.board.getLegalMoves().empty()) {
+        applyMove(session, Move::pass());
+        sendAiMove(session, moveToString(Move::pass()));
+        return;
+    }
+
+    SearchRequest request;
+    request.board = session.board;
+    request.history = session.history;
+    request.drawRules = config.drawRules;
+    request.limits.depth = session.depth;
+    request.deadlineMs = session.timeMs;
+    request.priority = session.priority;
+    request.owner = (uint64_t)session.owner;
+
+    int sessionId = session.id;
+    uint64_t jobId = searchService->submit(std::move(request), [this, sessionId](const SearchOutcome& outcome) {
+        if (outcome.status == SEARCH_REJECTED) return;
+        {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            AiResult result;
+            result.sessionId = sessionId;
+            result.outcome = outcome;
+            results.push_back(result);
+        }
+        wakeLoop();
+    });
+
+    // A full queue: the turn stays the AI's and is asked again later
+    session.aiThinking = true;
+    session.jobId = jobId;
+    if (jobId == 0) {
+        waitingAi.push_back(session.id);
+        return;
+    }
+    pendingJobs++;
+}
+
+void GameServer::retryAiMoves() {
+    std::vector<int> waiting;
+    waiting.swap(waitingAi);
+
+    for (size_t i = 0; i < waiting.size(); i++) {
+        auto it = sessions.find(waiting[i]);
+        if (it == sessions.end()) continue;
+
+        Session& session = it->second;
+        session.aiThinking = false;
+        requestAiMove(session);
+
+        // Still full: the rest keep their places for the next finished job
+        if (session.aiThinking && session.jobId == 0) {
+            waitingAi.insert(waitingAi.end(), waiting.begin() + i + 1, waiting.end());
+            break;
+        }
+    }
+}
+
+void GameServer::closeSession(int id) {
+    auto it = sessions.find(id);
+    if (it == sessions.end()) return;
+
+    if (it->second.aiThinking && it->second.jobId != 0) {
+        searchService->cancel(it->second.jobId);
+    }
+    sessions.erase(it);
+}
+
+void GameServer::applyMove(Session& session, const Move& move) {
+    session.board.makeMove(move);
+    session.board.switchPlayer();
+    session.history.push(session.board.getHash());
+    session.drawReason = session.history.checkDraw(config.drawRules);
+}
+
+void GameServer::sendAiMove(Session& session, const std::string& text) {
+    auto conn = connections.find(session.owner);
+    if (conn != connections.end()) {
+        send(conn->second, "aimove " + std::to_string(session.id) + " " + text + " " + statusOf(session));
+    }
+}
+
+std::string GameServer::statusOf(const Session& session) const {
+    Player winner = session.board.getWinner();
+    if (winner == PLAYER1) return "win1";
+    if (winner == PLAYER2) return "win2";
+    if (session.drawReason != DRAW_NONE) return "draw";
+    return "playing";
+}
+
+bool GameServer::isFinished(const Session& session) const {
+    return session.board.isGameOver() || session.drawReason != DRAW_NONE;
+}
+
+void GameServer::recordLatency(Clock::time_point since) {
+    uint32_t micros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+
+    if (latencySamples.size() < LATENCY_WINDOW) {
+        latencySamples.push_back(micros);
+    }
+    else {
+        latencySamples[latencyNext] = micros;
+        latencyNext = (latencyNext + 1) % LATENCY_WINDOW;
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AIPlayer.h"
+#include "Net.h"
+#include "SearchService.h"
+
+struct ServerConfig {
+    int port;                   // TCP port on 127.0.0.1
+    std::string unixPath;       // Unix socket path instead of TCP (Linux only)
+    int workers;                // search threads, 0 = one per core
+    int queueLimit;             // AI requests waiting beyond this wait in the server
+    int defaultDepth;
+    int64_t defaultTimeMs;      // per AI turn, counted from the request; 0 = depth only
+    DrawRules drawRules;
+
+    ServerConfig() : port(7070), workers(0), queueLimit(4096), defaultDepth(4), defaultTimeMs(0) {}
+};
+
+// Headless server hosting many concurrent games over a line protocol.
+// One event-loop thread owns every socket and session (epoll on Linux,
+// WSAPoll on Windows); AI turns go to a SearchService, with each
+// connection as one fairness owner.
+//
+//   new [ai 1|2|none] [depth N] [time MS] [priority N]  -> game <id>
+//   move <id> <move>             -> moved <id> <move> <status>
+//                                   later: aimove <id> <move> <status>
+//   state <id>                   -> state <id> <board> <status>
+//   moves <id>                   -> moves <id> <m1> <m2> ...   ((none) if passing)
+//   close <id>, stats, quit
+//
+// status is one of: playing, win1, win2, draw. Errors: error <text>.
+// A side with no legal move passes: the client sends "(none)" as its move
+// (accepted only then), and the AI's pass comes back as aimove <id> (none).
+// An AI turn refused by a full search queue is asked again as searches finish.
+class GameServer {
+public:
+    explicit GameServer(const ServerConfig& config);
+    ~GameServer();
+
+    bool start(std::string& error);
+    void run();
+    // Safe to call from any thread
+    void stop();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Session {
+        int id;
+        SocketHandle owner;
+        GameBoard board;
+        PositionHistory history;
+        Player aiSide;
+        int depth;
+        int64_t timeMs;
+        int priority;
+        bool aiThinking;
+        uint64_t jobId;             // 0 while waiting for room in the queue
+        DrawReason drawReason;
+        Clock::time_point requestTime;
+    };
+
+    struct Connection {
+        SocketHandle socket;
+        std::string input;
+        std::string output;
+        bool writeInterest;
+        std::vector<int> sessions;
+    };
+
+    struct AiResult {
+        int sessionId;
+        SearchOutcome outcome;
+    };
+
+    class Poller;
+
+    ServerConfig config;
+    SocketHandle listener;
+    std::unique_ptr<Poller> poller;
+    std::atomic<bool> running;
+
+    std::unordered_map<SocketHandle, Connection> connections;
+    std::unordered_map<int, Session> sessions;
+    int nextSessionId;
+
+    std::unique_ptr<SearchService> searchService;
+
+    std::mutex resultMutex;
+    std::vector<AiResult> results;
+    int pendingJobs;
+    std::vector<int> waitingAi;     // sessions whose AI turn found the queue full, oldest first
+
+    std::vector<uint32_t> latencySamples;   // microseconds, ring of recent AI turns
+    size_t latencyNext;
+    uint64_t aiMoves;
+    int64_t totalQueueUs;
+    int64_t totalSearchUs;
+
+    void wakeLoop();
+    void drainResults();
+
+    void acceptClients();
+    void readClient(SocketHandle socket);
+    void flushClient(Connection& connection);
+    void closeClient(SocketHandle socket);
+    void send(Connection& connection, const std::string& line);
+
+    void handleLine(Connection& connection, const std::string& line);
+    void handleNew(Connection& connection, std::istringstream& args);
+    void handleMove(Connection& connection, std::istringstream& args);
+    void handleStats(Connection& connection);
+    Session* findSession(Connection& connection, std::istringstream& args);
+
+    void requestAiMove(Session& session);
+    void retryAiMoves();
+    void closeSession(int id);
+    void applyMove(Session& session, const Move& move);
+    void sendAiMove(Session& session, const std::string& text);
+    std::string statusOf(const Session& session) const;
+    bool isFinished(const Session& session) const;
+    void recordLatency(Clock::time_point since);
+};
@@ -7,8 +7,15 @@ struct Move {
     Position from;
     Position to;
     bool isRevival;
+    bool isPass;            // the move of a side without legal moves: only the turn changes
     Position revivePos;
 
-    Move() : isRevival(false) {}
-    Move(Position f, Position t) : from(f), to(t), isRevival(false) {}
+    Move() : isRevival(false), isPass(false) {}
+    Move(Position f, Position t) : from(f), to(t), isRevival(false), isPass(false) {}
+
+    static Move pass() {
+        Move move;
+        move.isPass = true;
+        return move;
+    }
 };
\ No newline at end of file
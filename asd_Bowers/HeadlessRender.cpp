@@ -0,0 +1,250 @@
+#include "HeadlessRender.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "Notation.h"
+#include "PngWriter.h"
+
+namespace {
+    const SDL_Color BACKGROUND_COLOR = { 240, 230, 210, 255 };
+
+    struct InputLine {
+        int number;
+        std::string text;
+    };
+
+    struct RenderSettings {
+        const BoardTopology* topology;
+        std::string directory;
+        bool raw;
+    };
+
+    const char* optionValue(int argc, char* argv[], const char* name) {
+        for (int i = 2; i + 1 < argc; i++) {
+            if (strcmp(argv[i], name) == 0) return argv[i + 1];
+        }
+        return nullptr;
+    }
+
+    int optionInt(int argc, char* argv[], const char* name, int fallback) {
+        const char* value = optionValue(argc, argv, name);
+        return value ? atoi(value) : fallback;
+    }
+
+    bool hasFlag(int argc, char* argv[], const char* name) {
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], name) == 0) return true;
+        }
+        return false;
+    }
+
+    // Names as documented with runRender; ply < 0 for a single frame or a raw file
+    std::string framePath(const RenderSettings& settings, int line, int ply, const char* extension) {
+        char name[64];
+        if (ply < 0) snprintf(name, sizeof(name), "%06d.%s", line, extension);
+        else snprintf(name, sizeof(name), "%06d_%04d.%s", line, ply, extension);
+        return settings.directory + "/" + name;
+    }
+
+    // Renders every frame of one input line; returns the frames written
+    int renderLine(OffscreenRenderer& output, PngEncoder& encoder, const RenderSettings& settings,
+        const InputLine& line, std::string& error) {
+        GameBoard board(*settings.topology);
+        std::vector<BoardMarks> marks(1);
+        std::vector<GameBoard> positions;
+
+        // Board notation always has '/' between rows; moves never do
+        bool isGame = line.text.find('/') == std::string::npos;
+        if (!isGame) {
+            if (!boardFromString(line.text, board, error)) return -1;
+            positions.push_back(board);
+        }
+        else {
+            positions.push_back(board);
+            std::istringstream moves(line.text);
+            std::string token;
+            while (moves >> token) {
+                Move move;
+                if (!parseMove(board, token, move)) {
+                    error = "illegal move " + token;
+                    return -1;
+                }
+                board.makeMove(move);
+                board.switchPlayer();
+                positions.push_back(board);
+
+                // The node the move ended on; none for a pass
+                BoardMarks last;
+                if (!move.isPass) last.targets = nodeBit(settings.topology->nodeIndex(move.isRevival ? move.revivePos : move.to));
+                marks.push_back(last);
+            }
+        }
+
+        FILE* raw = nullptr;
+        if (settings.raw) {
+            raw = fopen(framePath(settings, line.number, -1, "rgba").c_str(), "wb");
+            if (!raw) {
+                error = "cannot create output file";
+                return -1;
+            }
+        }
+
+        int rowBytes = output.getWidth() * 4;
+        bool ok = true;
+        for (size_t ply = 0; ply < positions.size() && ok; ply++) {
+            const uint8_t* pixels = output.render(positions[ply], marks[ply]);
+            if (raw) {
+                for (int y = 0; y < output.getHeight() && ok; y++) {
+                    ok = fwrite(pixels + (size_t)y * output.getPitch(), 1, rowBytes, raw) == (size_t)rowBytes;
+                }
+                if (!ok) error = "write failed";
+            }
+            else {
+                const std::vector<uint8_t>& png = encoder.encode(pixels, output.getWidth(), output.getHeight(),
+                    output.getPitch());
+                ok = writeFileBytes(framePath(settings, line.number, isGame ? (int)ply : -1, "png"), png, error);
+            }
+        }
+
+        if (raw && fclose(raw) != 0 && ok) {
+            error = "write failed";
+            ok = false;
+        }
+        return ok ? (int)positions.size() : -1;
+    }
+}
+
+OffscreenRenderer::OffscreenRenderer(const BoardTopology& topology, int width, int height) : boards(topology),
+width(width), height(height), surface(nullptr), renderer(nullptr) {}
+
+OffscreenRenderer::~OffscreenRenderer() {
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (surface) SDL_FreeSurface(surface);
+}
+
+SDL_FRect OffscreenRenderer::area() const {
+    SDL_FRect rect = { 0.0f, 0.0f, (float)width, (float)height };
+    return rect;
+}
+
+bool OffscreenRenderer::init(std::string& error) {
+    // Byte order R, G, B, A in memory, as PNG and raw video expect
+    surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        error = SDL_GetError();
+        return false;
+    }
+
+    renderer = SDL_CreateSoftwareRenderer(surface);
+    if (!renderer) {
+        error = SDL_GetError();
+        return false;
+    }
+
+    boards.addRect(area(), BACKGROUND_COLOR);
+    boards.addEmptyBoard(area());
+    boards.flush(renderer);
+    SDL_RenderFlush(renderer);
+
+    const uint8_t* pixels = (const uint8_t*)surface->pixels;
+    background.assign(pixels, pixels + (size_t)surface->pitch * height);
+    return true;
+}
+
+const uint8_t* OffscreenRenderer::render(const GameBoard& board, const BoardMarks& marks) {
+    memcpy(surface->pixels, background.data(), background.size());
+
+    boards.addUnits(area(), board, marks);
+    boards.flush(renderer);
+    SDL_RenderFlush(renderer);
+
+    return (const uint8_t*)surface->pixels;
+}
+
+int runRender(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: render <input file> [--out DIR] [--size N] [--raw] [--threads N] [--board FILE]\n");
+        return 1;
+    }
+
+    static BoardTopology topology;
+    RenderSettings settings;
+    settings.topology = &BoardTopology::standard();
+    settings.directory = optionValue(argc, argv, "--out") ? optionValue(argc, argv, "--out") : ".";
+    settings.raw = hasFlag(argc, argv, "--raw");
+    int size = std::max(8, optionInt(argc, argv, "--size", 128));
+    int threadCount = optionInt(argc, argv, "--threads", 0);
+    if (threadCount <= 0) threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+    std::string error;
+    if (const char* path = optionValue(argc, argv, "--board")) {
+        if (!topology.loadFromFile(path, error)) {
+            fprintf(stderr, "%s: %s\n", path, error.c_str());
+            return 1;
+        }
+        settings.topology = &topology;
+    }
+
+    std::ifstream input(argv[2]);
+    if (!input) {
+        fprintf(stderr, "%s: cannot open file\n", argv[2]);
+        return 1;
+    }
+
+    std::vector<InputLine> lines;
+    std::string text;
+    for (int number = 1; std::getline(input, text); number++) {
+        if (!text.empty() && text.back() == '\r') text.pop_back();
+        if (text.empty() || text[0] == '#') continue;
+        lines.push_back(InputLine{ number, text });
+    }
+
+    // Created up front on this thread; each worker then owns one
+    std::vector<std::unique_ptr<OffscreenRenderer>> outputs;
+    for (int i = 0; i < threadCount; i++) {
+        outputs.emplace_back(new OffscreenRenderer(*settings.topology, size, size));
+        if (!outputs.back()->init(error)) {
+            fprintf(stderr, "render: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<uint64_t> frames(0);
+    std::atomic<int> failed(0);
+    std::mutex reportMutex;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    auto work = [&](OffscreenRenderer& output) {
+        PngEncoder encoder;
+        for (size_t i = next++; i < lines.size(); i = next++) {
+            std::string lineError;
+            int written = renderLine(output, encoder, settings, lines[i], lineError);
+            if (written < 0) {
+                failed++;
+                std::lock_guard<std::mutex> lock(reportMutex);
+                fprintf(stderr, "line %d: %s\n", lines[i].number, lineError.c_str());
+                continue;
+            }
+            frames += written;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++) threads.emplace_back(work, std::ref(*outputs[i]));
+    for (std::thread& thread : threads) thread.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu frames from %zu lines in %.2f s (%.0f frames/s, %d threads)\n", (unsigned long long)frames.load(),
+        lines.size(), seconds, seconds > 0 ? frames.load() / seconds : 0.0, threadCount);
+
+    return failed > 0 ? 1 : 0;
+}
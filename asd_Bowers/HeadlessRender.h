@@ -0,0 +1,53 @@
+#pragma once
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include "BoardRenderer.h"
+
+// Draws boards into memory with SDL's software renderer: no window, no
+// video driver and no display are involved, so it runs on servers and in
+// as many threads as there are instances.
+//
+// The empty board is rendered once into a pixel buffer; a frame starts by
+// copying it and only draws the marks and units on top.
+class OffscreenRenderer {
+public:
+    OffscreenRenderer(const BoardTopology& topology, int width, int height);
+    ~OffscreenRenderer();
+
+    OffscreenRenderer(const OffscreenRenderer&) = delete;
+    OffscreenRenderer& operator=(const OffscreenRenderer&) = delete;
+
+    bool init(std::string& error);
+
+    // RGBA pixels, getPitch() bytes a row, valid until the next render
+    const uint8_t* render(const GameBoard& board, const BoardMarks& marks = BoardMarks());
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getPitch() const { return surface ? surface->pitch : 0; }
+
+private:
+    BoardRenderer boards;
+    int width, height;
+    SDL_Surface* surface;
+    SDL_Renderer* renderer;
+    std::vector<uint8_t> background;    // the empty board, pitch as surface
+
+    SDL_FRect area() const;
+};
+
+// Batch command of the GUI executable:
+//   asd_Bowers render <input file> [--out DIR] [--size N] [--raw] [--threads N] [--board FILE]
+//
+// Each input line is a position in board notation ("11111/...../...../...../22222 1 0 0")
+// or a game as moves from the start position ("b1b2 d5d4 ..."); empty lines
+// and lines starting with '#' are skipped. Line n of the file (counting from
+// 1, skipped lines included) gives, with n zero-padded to 6 digits and ply to 4:
+//   <DIR>/<nnnnnn>.png              a position                  (000012.png)
+//   <DIR>/<nnnnnn>_<pppp>.png       every position of a game,   (000012_0000.png,
+//                                   ply 0 first                  000012_0001.png, ...)
+//   <DIR>/<nnnnnn>.rgba             with --raw: all frames of the line back to back,
+//                                   N x N RGBA each, for video encoders
+// so the names sort in input and move order. Wider numbers are written in full.
+int runRender(int argc, char* argv[]);
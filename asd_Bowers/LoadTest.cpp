@@ -0,0 +1,203 @@
+#include "LoadTest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "GameBoard.h"
+#include "Net.h"
+#include "Notation.h"
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    struct ClientGame {
+        GameBoard board;
+        int movesLeft;
+        Clock::time_point sent;
+    };
+
+    class LineSocket {
+    public:
+        explicit LineSocket(SocketHandle s) : socket(s) {}
+
+        bool sendLine(const std::string& line) {
+            std::string data = line + "\n";
+            size_t done = 0;
+            while (done < data.size()) {
+                int n = sendSome(socket, data.data() + done, (int)(data.size() - done));
+                if (n <= 0) return false;
+                done += n;
+            }
+            return true;
+        }
+
+        bool readLine(std::string& line) {
+            for (;;) {
+                size_t end = buffer.find('\n');
+                if (end != std::string::npos) {
+                    line = buffer.substr(0, end);
+                    buffer.erase(0, end + 1);
+                    return true;
+                }
+                char chunk[4096];
+                int n = recvSome(socket, chunk, sizeof(chunk));
+                if (n <= 0) return false;
+                buffer.append(chunk, n);
+            }
+        }
+
+    private:
+        SocketHandle socket;
+        std::string buffer;
+    };
+
+    bool sendRandomMove(LineSocket& link, int id, ClientGame& game, std::mt19937& rng) {
+        std::vector<Move> moves = game.board.getLegalMovesOrPass();
+        Move move = moves[rng() % moves.size()];
+        game.board.makeMove(move);
+        game.board.switchPlayer();
+        game.movesLeft--;
+        game.sent = Clock::now();
+        return link.sendLine("move " + std::to_string(id) + " " + moveToString(move));
+    }
+
+    void runClient(const LoadTestConfig& config, int index, std::vector<uint32_t>& latencies, int& errors) {
+        std::string error;
+        SocketHandle socket;
+#if !defined(_WIN32)
+        if (!config.unixPath.empty()) socket = connectUnix(config.unixPath, error);
+        else
+#endif
+        socket = connectTcp(config.port, error);
+
+        if (socket == INVALID_SOCKET_HANDLE) {
+            fprintf(stderr, "client %d: %s\n", index, error.c_str());
+            errors++;
+            return;
+        }
+
+        LineSocket link(socket);
+        std::mt19937 rng(index * 7919 + 1);
+        std::unordered_map<int, ClientGame> games;
+
+        for (int g = 0; g < config.gamesPerClient; g++) {
+            std::string request = "new ai 2 depth " + std::to_string(config.depth);
+            if (config.timeMs > 0) request += " time " + std::to_string(config.timeMs);
+            link.sendLine(request);
+        }
+
+        int active = 0, created = 0;
+        std::string line;
+        while (link.readLine(line)) {
+            std::istringstream in(line);
+            std::string kind;
+            int id = 0;
+            in >> kind >> id;
+
+            if (kind == "game") {
+                ClientGame& game = games[id];
+                game.movesLeft = config.movesPerGame;
+                active++;
+                created++;
+                if (!sendRandomMove(link, id, game, rng)) active--;
+            }
+            else if (kind == "aimove" || kind == "moved") {
+                auto it = games.find(id);
+                if (it == games.end()) continue;
+                ClientGame& game = it->second;
+
+                std::string text, status;
+                in >> text >> status;
+
+                bool over = (status != "playing");
+                if (kind == "aimove") {
+                    latencies.push_back((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - game.sent).count());
+
+                    Move move;
+                    if (!parseMove(game.board, text, move)) {
+                        errors++;
+                        fprintf(stderr, "client %d: bad AI move %s in %s\n", index, text.c_str(),
+                            boardToString(game.board).c_str());
+                        over = true;
+                    }
+                    else {
+                        game.board.makeMove(move);
+                        game.board.switchPlayer();
+                    }
+
+                    if (over || game.movesLeft <= 0 || !sendRandomMove(link, id, game, rng)) {
+                        link.sendLine("close " + std::to_string(id));
+                        games.erase(it);
+                        active--;
+                    }
+                }
+                else if (over) {
+                    link.sendLine("close " + std::to_string(id));
+                    games.erase(it);
+                    active--;
+                }
+            }
+            else if (kind == "error") {
+                errors++;
+                fprintf(stderr, "client %d: %s\n", index, line.c_str());
+            }
+
+            if (active == 0 && created == config.gamesPerClient) {
+                break;
+            }
+        }
+
+        link.sendLine("quit");
+        closeSocket(socket);
+    }
+}
+
+int runLoadTest(const LoadTestConfig& config) {
+    if (!netStartup()) return 1;
+
+    std::vector<std::vector<uint32_t>> latencies(config.clients);
+    std::vector<int> errors(config.clients, 0);
+    std::vector<std::thread> threads;
+
+    auto start = Clock::now();
+    for (int i = 0; i < config.clients; i++) {
+        threads.emplace_back([&config, &latencies, &errors, i]() { runClient(config, i, latencies[i], errors[i]); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    int totalErrors = 0;
+    for (int i = 0; i < config.clients; i++) {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        totalErrors += errors[i];
+    }
+    std::sort(all.begin(), all.end());
+
+    auto percentile = [&all](double p) -> uint32_t {
+        if (all.empty()) return 0;
+        return all[std::min(all.size() - 1, (size_t)(p * all.size()))];
+    };
+
+    printf("Games           : %d\n", config.clients * config.gamesPerClient);
+    printf("AI turns        : %zu\n", all.size());
+    printf("Errors          : %d\n", totalErrors);
+    printf("Time (s)        : %.2f\n", seconds);
+    printf("Turns/second    : %.0f\n", seconds > 0 ? all.size() / seconds : 0.0);
+    printf("Latency p50 (us): %u\n", percentile(0.50));
+    printf("Latency p99 (us): %u\n", percentile(0.99));
+    printf("Latency p999(us): %u\n", percentile(0.999));
+    printf("Latency max (us): %u\n", percentile(1.0));
+
+    netCleanup();
+    return totalErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+
+struct LoadTestConfig {
+    int port;
+    std::string unixPath;
+    int clients;            // connections, one thread each
+    int gamesPerClient;     // concurrent games per connection
+    int movesPerGame;       // human moves before a game is closed
+    int depth;
+    int timeMs;             // AI deadline per turn, 0 = none
+
+    LoadTestConfig() : port(7070), clients(8), gamesPerClient(16), movesPerGame(20), depth(3), timeMs(0) {}
+};
+
+// Drives a running GameServer from local clients: every game plays random
+// legal moves against the server AI. Prints per-turn latency percentiles
+// (move sent -> AI reply received) and turns per second.
+int runLoadTest(const LoadTestConfig& config);
@@ -0,0 +1,180 @@
+#include "Net.h"
+#include <cstring>
+
+#if defined(_WIN32)
+#if defined(_MSC_VER)
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+bool netStartup() {
+#if defined(_WIN32)
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void netCleanup() {
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+void closeSocket(SocketHandle socket) {
+#if defined(_WIN32)
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool setNonBlocking(SocketHandle socket) {
+#if defined(_WIN32)
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool lastErrorWouldBlock() {
+#if defined(_WIN32)
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static void setNoDelay(SocketHandle socket) {
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+static sockaddr_in loopbackAddress(int port) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+SocketHandle listenTcp(int port, std::string& error) {
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET_HANDLE) {
+        error = "socket failed";
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+    sockaddr_in addr = loopbackAddress(port);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, SOMAXCONN) != 0) {
+        error = "cannot listen on 127.0.0.1:" + std::to_string(port);
+        closeSocket(s);
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    setNonBlocking(s);
+    return s;
+}
+
+SocketHandle connectTcp(int port, std::string& error) {
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET_HANDLE) {
+        error = "socket failed";
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    sockaddr_in addr = loopbackAddress(port);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        error = "cannot connect to 127.0.0.1:" + std::to_string(port);
+        closeSocket(s);
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    setNoDelay(s);
+    return s;
+}
+
+SocketHandle acceptClient(SocketHandle listener) {
+    SocketHandle s = accept(listener, nullptr, nullptr);
+    if (s == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+
+    setNonBlocking(s);
+    setNoDelay(s);
+    return s;
+}
+
+#if !defined(_WIN32)
+static bool unixAddress(const std::string& path, sockaddr_un& addr, std::string& error) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        error = "socket path too long";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+SocketHandle listenUnix(const std::string& path, std::string& error) {
+    sockaddr_un addr;
+    if (!unixAddress(path, addr, error)) return INVALID_SOCKET_HANDLE;
+
+    SocketHandle s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET_HANDLE) {
+        error = "socket failed";
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    unlink(path.c_str());
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, SOMAXCONN) != 0) {
+        error = "cannot listen on " + path;
+        closeSocket(s);
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    setNonBlocking(s);
+    return s;
+}
+
+SocketHandle connectUnix(const std::string& path, std::string& error) {
+    sockaddr_un addr;
+    if (!unixAddress(path, addr, error)) return INVALID_SOCKET_HANDLE;
+
+    SocketHandle s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET_HANDLE || connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        error = "cannot connect to " + path;
+        if (s != INVALID_SOCKET_HANDLE) closeSocket(s);
+        return INVALID_SOCKET_HANDLE;
+    }
+
+    return s;
+}
+#endif
+
+int sendSome(SocketHandle socket, const char* data, int size) {
+#if defined(_WIN32)
+    return send(socket, data, size, 0);
+#else
+    return (int)send(socket, data, (size_t)size, MSG_NOSIGNAL);
+#endif
+}
+
+int recvSome(SocketHandle socket, char* data, int size) {
+    return (int)recv(socket, data, size, 0);
+}
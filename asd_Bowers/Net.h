@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+#else
+typedef int SocketHandle;
+const SocketHandle INVALID_SOCKET_HANDLE = -1;
+#endif
+
+// Thin portability layer over BSD sockets and Winsock for the game server.
+bool netStartup();
+void netCleanup();
+
+void closeSocket(SocketHandle socket);
+bool setNonBlocking(SocketHandle socket);
+bool lastErrorWouldBlock();
+
+// Listening sockets are bound to loopback only
+SocketHandle listenTcp(int port, std::string& error);
+SocketHandle connectTcp(int port, std::string& error);
+// Non-blocking, Nagle disabled; INVALID_SOCKET_HANDLE when nothing is pending
+SocketHandle acceptClient(SocketHandle listener);
+#if !defined(_WIN32)
+SocketHandle listenUnix(const std::string& path, std::string& error);
+SocketHandle connectUnix(const std::string& path, std::string& error);
+#endif
+
+int sendSome(SocketHandle socket, const char* data, int size);
+int recvSome(SocketHandle socket, char* data, int size);
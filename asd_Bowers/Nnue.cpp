@@ -0,0 +1,221 @@
+#include "Nnue.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "Tablebase.h"
+
+#if defined(BOWERS_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+    const char NETWORK_MAGIC[8] = { 'B', 'W', 'N', 'N', '0', '0', '0', '1' };
+    const size_t HEADER_BYTES = 32;
+    const int ACTIVATION_MAX = 127;
+    const int WEIGHT_SHIFT = 6;         // int8 weights: 1.0 = 64
+
+    void clipLayer1(const int32_t* sums, uint8_t* out) {
+        for (int o = 0; o < NNUE_LAYER1; o++) {
+            out[o] = (uint8_t)std::clamp(sums[o] >> WEIGHT_SHIFT, 0, ACTIVATION_MAX);
+        }
+    }
+}
+
+NnueNetwork::NnueNetwork() : loaded(false), topology(0), outputScale(0), simdLevel(getSimdLevel()), outputBias(0) {}
+
+bool NnueNetwork::load(const std::string& path, std::string& error) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char buffer[65536];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        data.insert(data.end(), buffer, buffer + got);
+    }
+    fclose(in);
+
+    if (data.size() < HEADER_BYTES || memcmp(data.data(), NETWORK_MAGIC, 8) != 0) {
+        error = path + " is not a network";
+        return false;
+    }
+
+    uint32_t shape[3];
+    int32_t scale;
+    uint64_t key;
+    memcpy(shape, data.data() + 8, 12);
+    memcpy(&scale, data.data() + 20, 4);
+    memcpy(&key, data.data() + 24, 8);
+    if (shape[0] != NNUE_INPUTS || shape[1] != NNUE_HIDDEN || shape[2] != NNUE_LAYER1) {
+        error = path + " has another network shape";
+        return false;
+    }
+
+    size_t expected = HEADER_BYTES + NNUE_HIDDEN * 2 + (size_t)NNUE_INPUTS * NNUE_HIDDEN * 2 +
+        NNUE_LAYER1 * 4 + (size_t)NNUE_LAYER1 * 2 * NNUE_HIDDEN + 4 + NNUE_LAYER1;
+    if (data.size() != expected) {
+        error = path + " is damaged";
+        return false;
+    }
+
+    hiddenBias.resize(NNUE_HIDDEN);
+    hiddenWeights.resize((size_t)NNUE_INPUTS * NNUE_HIDDEN);
+    layer1Bias.resize(NNUE_LAYER1);
+    layer1Weights.resize((size_t)NNUE_LAYER1 * 2 * NNUE_HIDDEN);
+    outputWeights.resize(NNUE_LAYER1);
+
+    const unsigned char* p = data.data() + HEADER_BYTES;
+    auto take = [&p](void* target, size_t bytes) {
+        memcpy(target, p, bytes);
+        p += bytes;
+    };
+    take(hiddenBias.data(), hiddenBias.size() * 2);
+    take(hiddenWeights.data(), hiddenWeights.size() * 2);
+    take(layer1Bias.data(), layer1Bias.size() * 4);
+    take(layer1Weights.data(), layer1Weights.size());
+    take(&outputBias, 4);
+    take(outputWeights.data(), outputWeights.size());
+
+    topology = key;
+    outputScale = scale;
+    simdLevel = getSimdLevel();
+    loaded = true;
+    return true;
+}
+
+bool NnueNetwork::matches(const BoardTopology& board) const {
+    return loaded && (topology == 0 || topology == topologyKey(board));
+}
+
+int NnueNetwork::featureIndex(Player perspective, NnueFeature kind, Player owner, int index) {
+    bool own = owner == perspective;
+    switch (kind) {
+    case NNUE_UNIT: return (own ? NNUE_OWN_UNITS : NNUE_ENEMY_UNITS) + index;
+    case NNUE_KILLER: return (own ? NNUE_OWN_KILLERS : NNUE_ENEMY_KILLERS) + index;
+    default: return (own ? NNUE_OWN_KILLED : NNUE_ENEMY_KILLED) + std::min(index, NNUE_KILLED_BUCKETS - 1);
+    }
+}
+
+void NnueNetwork::clear(NnueAccumulator& accumulator) const {
+    for (int p = 0; p < 2; p++) {
+        std::copy(hiddenBias.begin(), hiddenBias.end(), accumulator.values[p]);
+    }
+}
+
+#if defined(BOWERS_X86)
+BOWERS_TARGET_AVX2
+static void updateAvx2(int16_t* values, const int16_t* row, bool add) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i v = _mm256_load_si256((const __m256i*)(values + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(row + i));
+        v = add ? _mm256_add_epi16(v, w) : _mm256_sub_epi16(v, w);
+        _mm256_store_si256((__m256i*)(values + i), v);
+    }
+}
+
+// Sums of the eight lanes of four vectors, as one vector
+BOWERS_TARGET_AVX2
+static __m128i sumFourAvx2(__m256i a, __m256i b, __m256i c, __m256i d) {
+    __m256i pairs = _mm256_hadd_epi32(_mm256_hadd_epi32(a, b), _mm256_hadd_epi32(c, d));
+    return _mm_add_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+}
+
+// Inputs are at most 127 and weights at least -128, so the pairwise sums
+// of maddubs never saturate and the result equals the scalar kernel's.
+BOWERS_TARGET_AVX2
+static void layer1Avx2(const NnueAccumulator& accumulator, Player toMove, const int32_t* bias,
+    const int8_t* weights, int32_t* sums) {
+    const __m256i limit = _mm256_set1_epi16(ACTIVATION_MAX);
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    __m256i input[2 * NNUE_HIDDEN / 32];
+    for (int side = 0; side < 2; side++) {
+        int perspective = (side == 0) ? toMove - 1 : 2 - toMove;
+        const int16_t* values = accumulator.values[perspective];
+        for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+            __m256i a = _mm256_min_epi16(_mm256_load_si256((const __m256i*)(values + i)), limit);
+            __m256i b = _mm256_min_epi16(_mm256_load_si256((const __m256i*)(values + i + 16)), limit);
+            // packus clips negatives to 0 but interleaves the 128-bit halves
+            input[(side * NNUE_HIDDEN + i) / 32] = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        }
+    }
+
+    for (int o = 0; o < NNUE_LAYER1; o += 4) {
+        __m256i sum[4];
+        for (int k = 0; k < 4; k++) {
+            const int8_t* row = weights + (size_t)(o + k) * 2 * NNUE_HIDDEN;
+            sum[k] = _mm256_setzero_si256();
+            for (int c = 0; c < 2 * NNUE_HIDDEN / 32; c++) {
+                __m256i products = _mm256_maddubs_epi16(input[c], _mm256_loadu_si256((const __m256i*)(row + c * 32)));
+                sum[k] = _mm256_add_epi32(sum[k], _mm256_madd_epi16(products, ones));
+            }
+        }
+        __m128i total = _mm_add_epi32(sumFourAvx2(sum[0], sum[1], sum[2], sum[3]), _mm_loadu_si128((const __m128i*)(bias + o)));
+        _mm_storeu_si128((__m128i*)(sums + o), total);
+    }
+}
+#endif
+
+static void layer1Scalar(const NnueAccumulator& accumulator, Player toMove, const int32_t* bias,
+    const int8_t* weights, int32_t* sums) {
+    uint8_t input[2 * NNUE_HIDDEN];
+    for (int side = 0; side < 2; side++) {
+        int perspective = (side == 0) ? toMove - 1 : 2 - toMove;
+        for (int i = 0; i < NNUE_HIDDEN; i++) {
+            input[side * NNUE_HIDDEN + i] = (uint8_t)std::clamp((int)accumulator.values[perspective][i], 0, ACTIVATION_MAX);
+        }
+    }
+
+    for (int o = 0; o < NNUE_LAYER1; o++) {
+        const int8_t* row = weights + (size_t)o * 2 * NNUE_HIDDEN;
+        int32_t sum = bias[o];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++) sum += input[i] * row[i];
+        sums[o] = sum;
+    }
+}
+
+void NnueNetwork::update(NnueAccumulator& accumulator, NnueFeature kind, Player owner, int index, bool add) const {
+    for (int p = PLAYER1; p <= PLAYER2; p++) {
+        const int16_t* row = hiddenWeights.data() + (size_t)featureIndex((Player)p, kind, owner, index) * NNUE_HIDDEN;
+        int16_t* values = accumulator.values[p - 1];
+
+#if defined(BOWERS_X86)
+        if (simdLevel == SIMD_AVX2) {
+            updateAvx2(values, row, add);
+            continue;
+        }
+#endif
+        // Plain loops; the compiler vectorizes these for the SSE2 baseline
+        if (add) {
+            for (int i = 0; i < NNUE_HIDDEN; i++) values[i] = (int16_t)(values[i] + row[i]);
+        }
+        else {
+            for (int i = 0; i < NNUE_HIDDEN; i++) values[i] = (int16_t)(values[i] - row[i]);
+        }
+    }
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator& accumulator, Player toMove) const {
+    int32_t sums[NNUE_LAYER1];
+#if defined(BOWERS_X86)
+    if (simdLevel == SIMD_AVX2) {
+        layer1Avx2(accumulator, toMove, layer1Bias.data(), layer1Weights.data(), sums);
+    }
+    else {
+        layer1Scalar(accumulator, toMove, layer1Bias.data(), layer1Weights.data(), sums);
+    }
+#else
+    layer1Scalar(accumulator, toMove, layer1Bias.data(), layer1Weights.data(), sums);
+#endif
+
+    uint8_t hidden[NNUE_LAYER1];
+    clipLayer1(sums, hidden);
+
+    int32_t output = outputBias;
+    for (int o = 0; o < NNUE_LAYER1; o++) output += hidden[o] * outputWeights[o];
+
+    return (int)((int64_t)output * outputScale / (ACTIVATION_MAX << WEIGHT_SHIFT));
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BoardTopology.h"
+#include "GameTypes.h"
+#include "Simd.h"
+
+// Input features, seen from one side (the perspective): its own units,
+// the enemy's, the nodes each side has made a kill from, and each side's
+// killed count (one-hot, counts from NNUE_KILLED_BUCKETS - 1 up share the
+// last bucket).
+const int NNUE_KILLED_BUCKETS = 16;
+const int NNUE_OWN_UNITS = 0;
+const int NNUE_ENEMY_UNITS = NNUE_OWN_UNITS + MAX_BOARD_NODES;
+const int NNUE_OWN_KILLERS = NNUE_ENEMY_UNITS + MAX_BOARD_NODES;
+const int NNUE_ENEMY_KILLERS = NNUE_OWN_KILLERS + MAX_BOARD_NODES;
+const int NNUE_OWN_KILLED = NNUE_ENEMY_KILLERS + MAX_BOARD_NODES;
+const int NNUE_ENEMY_KILLED = NNUE_OWN_KILLED + NNUE_KILLED_BUCKETS;
+const int NNUE_INPUTS = NNUE_ENEMY_KILLED + NNUE_KILLED_BUCKETS;
+
+const int NNUE_HIDDEN = 32;     // accumulator width per perspective
+const int NNUE_LAYER1 = 16;
+
+enum NnueFeature { NNUE_UNIT, NNUE_KILLER, NNUE_KILLED };
+
+// First layer outputs for both perspectives, [Player - 1]
+struct NnueAccumulator {
+    alignas(32) int16_t values[2][NNUE_HIDDEN];
+};
+
+// Small efficiently updatable network: a sparse first layer whose outputs
+// (the accumulator) GameBoard keeps current move by move, then two dense
+// layers over the clipped accumulators, side to move first.
+//
+// Quantized as int16 first layer weights and biases (1.0 = 127), int8
+// layer 1 and output weights (1.0 = 64) with int32 biases. Activations are
+// clipped to [0, 127]. The output is scaled by outputScale / (127 * 64) to
+// evaluation points for the side to move.
+//
+// File, little endian:
+//   "BWNN0001", uint32 inputs, hidden, layer1, int32 outputScale,
+//   uint64 topology key (0 = trained for any board),
+//   int16 hidden biases[hidden], int16 weights[inputs][hidden],
+//   int32 layer1 biases[layer1], int8 weights[layer1][2 * hidden],
+//   int32 output bias, int8 weights[layer1]
+class NnueNetwork {
+public:
+    NnueNetwork();
+
+    bool load(const std::string& path, std::string& error);
+    bool isLoaded() const { return loaded; }
+    // Whether the network was trained for this board
+    bool matches(const BoardTopology& topology) const;
+
+    static int featureIndex(Player perspective, NnueFeature kind, Player owner, int index);
+
+    void clear(NnueAccumulator& accumulator) const;
+    // Adds (or removes) one feature of owner in both perspectives
+    void update(NnueAccumulator& accumulator, NnueFeature kind, Player owner, int index, bool add) const;
+
+    // Evaluation points for the side to move
+    int evaluate(const NnueAccumulator& accumulator, Player toMove) const;
+
+    // For comparing the kernels; load() picks the best one
+    void setSimdLevel(SimdLevel level) { simdLevel = level; }
+
+private:
+    bool loaded;
+    uint64_t topology;
+    int32_t outputScale;
+    SimdLevel simdLevel;
+
+    std::vector<int16_t> hiddenBias;
+    std::vector<int16_t> hiddenWeights;     // [feature * NNUE_HIDDEN + unit]
+    std::vector<int32_t> layer1Bias;
+    std::vector<int8_t> layer1Weights;      // [output * 2 * NNUE_HIDDEN + input]
+    int32_t outputBias;
+    std::vector<int8_t> outputWeights;
+};
@@ -0,0 +1,94 @@
+#include "Notation.h"
+#include <sstream>
+
+std::string positionToString(const Position& pos) {
+    return std::string(1, (char)('a' + pos.col)) + std::to_string(pos.row + 1);
+}
+
+bool parsePosition(const std::string& text, Position& pos) {
+    if (text.size() < 2 || text[0] < 'a' || text[0] > 'z') return false;
+
+    int row = 0;
+    for (size_t i = 1; i < text.size(); i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        row = row * 10 + (text[i] - '0');
+    }
+
+    pos = Position(row - 1, text[0] - 'a');
+    return row >= 1;
+}
+
+std::string moveToString(const Move& move) {
+    if (move.isPass) return PASS_MOVE_TEXT;
+    if (move.isRevival) {
+        return positionToString(move.from) + "*" + positionToString(move.revivePos);
+    }
+    return positionToString(move.from) + positionToString(move.to);
+}
+
+bool parseMove(const GameBoard& board, const std::string& text, Move& move) {
+    for (const auto& legal : board.getLegalMovesOrPass()) {
+        if (moveToString(legal) == text) {
+            move = legal;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string boardToString(const GameBoard& board) {
+    const BoardTopology& topology = board.getTopology();
+    std::string text;
+
+    for (int r = 0; r < topology.rows; r++) {
+        if (r > 0) text += '/';
+        for (int c = 0; c < topology.cols; c++) {
+            int cell = board.getCell(Position(r, c));
+            text += (cell == NONE) ? '.' : (char)('0' + cell);
+        }
+    }
+
+    text += " " + std::to_string((int)board.getCurrentPlayer());
+    text += " " + std::to_string(board.getKilledUnits(PLAYER1));
+    text += " " + std::to_string(board.getKilledUnits(PLAYER2));
+
+    return text;
+}
+
+bool boardFromString(const std::string& text, GameBoard& board, std::string& error) {
+    const BoardTopology& topology = board.getTopology();
+
+    std::istringstream in(text);
+    std::string cells;
+    int side = 0, killed1 = -1, killed2 = -1;
+    if (!(in >> cells >> side >> killed1 >> killed2) || (side != PLAYER1 && side != PLAYER2) ||
+        killed1 < 0 || killed2 < 0 || killed1 > topology.cols || killed2 > topology.cols) {
+        error = "expected '<rows> <side> <killed1> <killed2>'";
+        return false;
+    }
+
+    NodeMask pieces[3] = { 0, 0, 0 };
+    int r = 0, c = 0;
+    for (char ch : cells) {
+        if (ch == '/') {
+            if (c != topology.cols) break;
+            r++;
+            c = 0;
+            continue;
+        }
+        if (r >= topology.rows || c >= topology.cols || (ch != '.' && ch != '1' && ch != '2')) {
+            error = "bad board layout";
+            return false;
+        }
+        if (ch != '.') pieces[ch - '0'] |= nodeBit(r * topology.cols + c);
+        c++;
+    }
+
+    if (r != topology.rows - 1 || c != topology.cols) {
+        error = "expected " + std::to_string(topology.rows) + " rows of " + std::to_string(topology.cols);
+        return false;
+    }
+
+    board.setup(pieces[PLAYER1], pieces[PLAYER2], (Player)side, killed1, killed2);
+    return true;
+}
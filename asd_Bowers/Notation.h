@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include "GameBoard.h"
+
+// Text forms shared by the bench suite and the engine protocol.
+//   node:  column letter + row number from 1, e.g. "a1" is row 0, col 0
+//   move:  "<from><to>" ("a1b2"), revival "<from>*<revivePos>" ("c5*a1")
+//   pass:  "(none)" (Move::pass()), the only move of a side without legal moves:
+//          it hands the turn over, as in "bestmove (none)"
+//   board: rows from row 0, '1'/'2'/'.' per node, joined by '/', then side to
+//          move and killed counts: "11111/...../...../...../22222 1 0 0"
+
+std::string positionToString(const Position& pos);
+bool parsePosition(const std::string& text, Position& pos);
+
+const char* const PASS_MOVE_TEXT = "(none)";
+
+std::string moveToString(const Move& move);
+// Accepts only moves that are legal on board, and PASS_MOVE_TEXT where no
+// move is
+bool parseMove(const GameBoard& board, const std::string& text, Move& move);
+
+std::string boardToString(const GameBoard& board);
+bool boardFromString(const std::string& text, GameBoard& board, std::string& error);
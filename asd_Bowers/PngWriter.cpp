@@ -0,0 +1,302 @@
+#include "PngWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    const int MIN_MATCH = 3;
+    const int MAX_MATCH = 258;
+    const int MAX_DISTANCE = 32768;
+
+    const uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    const uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    const uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+        4097, 6145, 8193, 12289, 16385, 24577
+    };
+    const uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+
+    struct CrcTable {
+        uint32_t entries[256];
+
+        CrcTable() {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+        }
+    };
+
+    uint32_t crc32(const uint8_t* data, size_t size) {
+        static const CrcTable table;
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) c = table.entries[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    // Bytes split into 16 lanes: per lane the sum and the sum of the running
+    // sums at each block start, from which a and b of every byte follow.
+    // Written so the compiler can vectorize the lane loop.
+    uint32_t adler32(const uint8_t* data, size_t size) {
+        uint32_t a = 1, b = 0;
+        while (size > 0) {
+            // Largest run before the lane sums can overflow
+            size_t run = std::min<size_t>(size, 5552);
+            size_t blocks = run / 16;
+
+            uint32_t lanes[16] = {}, prefix[16] = {};
+            for (size_t n = 0; n < blocks; n++) {
+                const uint8_t* block = data + n * 16;
+                for (int k = 0; k < 16; k++) {
+                    prefix[k] += lanes[k];
+                    lanes[k] += block[k];
+                }
+            }
+
+            uint64_t sum = 0, prefixSum = 0, weighted = 0;
+            for (int k = 0; k < 16; k++) {
+                sum += lanes[k];
+                prefixSum += prefix[k];
+                weighted += (uint64_t)(16 - k) * lanes[k];
+            }
+            uint64_t a64 = a + sum;
+            uint64_t b64 = b + (uint64_t)blocks * 16 * a + 16 * prefixSum + weighted;
+            for (size_t i = blocks * 16; i < run; i++) {
+                a64 += data[i];
+                b64 += a64;
+            }
+
+            a = (uint32_t)(a64 % 65521);
+            b = (uint32_t)(b64 % 65521);
+            data += run;
+            size -= run;
+        }
+        return (b << 16) | a;
+    }
+
+    // Fixed Huffman codes (RFC 1951, 3.2.6), bit-reversed for the LSB-first stream
+    struct FixedCodes {
+        uint16_t literal[288];
+        uint8_t literalLength[288];
+        uint16_t distance[30];
+
+        static uint16_t reverse(uint32_t code, int length) {
+            uint32_t reversed = 0;
+            for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+            return (uint16_t)reversed;
+        }
+
+        FixedCodes() {
+            for (int value = 0; value < 288; value++) {
+                uint32_t code;
+                int length;
+                if (value < 144) { code = 0x30 + value; length = 8; }
+                else if (value < 256) { code = 0x190 + value - 144; length = 9; }
+                else if (value < 280) { code = value - 256; length = 7; }
+                else { code = 0xC0 + value - 280; length = 8; }
+                literal[value] = reverse(code, length);
+                literalLength[value] = (uint8_t)length;
+            }
+            for (int code = 0; code < 30; code++) distance[code] = reverse(code, 5);
+        }
+    };
+
+    const FixedCodes& fixedCodes() {
+        static const FixedCodes codes;
+        return codes;
+    }
+
+    int lowestByte(uint64_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return (int)index / 8;
+#else
+        return __builtin_ctzll(mask) / 8;
+#endif
+    }
+
+    void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    // Bits go out least significant first, 32 at a time (little endian host)
+    struct BitWriter {
+        uint8_t* out;
+        uint64_t bits;
+        int count;
+
+        explicit BitWriter(uint8_t* buffer) : out(buffer), bits(0), count(0) {}
+
+        void put(uint32_t value, int length) {
+            bits |= (uint64_t)value << count;
+            count += length;
+            if (count >= 32) {
+                uint32_t word = (uint32_t)bits;
+                memcpy(out, &word, 4);
+                out += 4;
+                bits >>= 32;
+                count -= 32;
+            }
+        }
+
+        // Pads to a byte; returns the end of the output
+        uint8_t* finish() {
+            for (; count > 0; count -= 8) {
+                *out++ = (uint8_t)bits;
+                bits >>= 8;
+            }
+            count = 0;
+            return out;
+        }
+    };
+
+    void putLiteral(BitWriter& writer, int value) {
+        const FixedCodes& codes = fixedCodes();
+        writer.put(codes.literal[value], codes.literalLength[value]);
+    }
+
+    void putMatch(BitWriter& writer, int length, int distance) {
+        int code = 28;
+        while (LENGTH_BASE[code] > length) code--;
+        putLiteral(writer, 257 + code);
+        writer.put(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+        code = 29;
+        while (DISTANCE_BASE[code] > distance) code--;
+        writer.put(fixedCodes().distance[code], 5);
+        writer.put(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+    }
+
+    int matchLength(const uint8_t* data, size_t at, size_t distance, size_t end) {
+        size_t limit = std::min<size_t>(end - at, MAX_MATCH);
+        size_t length = 0;
+
+        // Eight bytes at a time; the first difference is the lowest set byte (little endian)
+        while (length + 8 <= limit) {
+            uint64_t x, y;
+            memcpy(&x, data + at + length, 8);
+            memcpy(&y, data + at + length - distance, 8);
+            if (x != y) return (int)(length + lowestByte(x ^ y));
+            length += 8;
+        }
+        while (length < limit && data[at + length] == data[at + length - distance]) length++;
+        return (int)length;
+    }
+}
+
+// zlib stream of raw: one final fixed-Huffman block
+void PngEncoder::deflate(int rowBytes) {
+    png.push_back(0x78);
+    png.push_back(0x01);
+
+    // Worst case 9 bits a byte, plus the block header and end code
+    const uint8_t* data = raw.data();
+    size_t end = raw.size();
+    size_t start = png.size();
+    png.resize(start + end * 9 / 8 + 16);
+
+    BitWriter writer(png.data() + start);
+    writer.put(1, 1);           // final block
+    writer.put(1, 2);           // fixed Huffman codes
+
+    size_t at = 0;
+    while (at < end) {
+        // The pixel to the left, or the same byte one row up
+        int best = 0, bestDistance = 0;
+        if (at >= 4) {
+            best = matchLength(data, at, 4, end);
+            bestDistance = 4;
+        }
+        if (at >= (size_t)rowBytes && rowBytes <= MAX_DISTANCE && best < MAX_MATCH) {
+            int length = matchLength(data, at, rowBytes, end);
+            if (length > best) {
+                best = length;
+                bestDistance = rowBytes;
+            }
+        }
+
+        if (best >= MIN_MATCH) {
+            putMatch(writer, best, bestDistance);
+            at += best;
+        }
+        else {
+            putLiteral(writer, data[at]);
+            at++;
+        }
+    }
+    putLiteral(writer, 256);
+    png.resize(writer.finish() - png.data());
+
+    putBigEndian(png, adler32(data, end));
+}
+
+void PngEncoder::beginChunk(const char* type) {
+    putBigEndian(png, 0);       // length, filled in by endChunk
+    png.insert(png.end(), type, type + 4);
+}
+
+void PngEncoder::endChunk(size_t start) {
+    uint32_t length = (uint32_t)(png.size() - start - 8);
+    for (int i = 0; i < 4; i++) png[start + i] = (uint8_t)(length >> (24 - 8 * i));
+    putBigEndian(png, crc32(png.data() + start + 4, length + 4));
+}
+
+const std::vector<uint8_t>& PngEncoder::encode(const uint8_t* pixels, int width, int height, int pitch) {
+    int rowBytes = 1 + width * 4;
+    raw.resize((size_t)rowBytes * height);
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = raw.data() + (size_t)y * rowBytes;
+        row[0] = 0;             // filter: none
+        memcpy(row + 1, pixels + (size_t)y * pitch, (size_t)width * 4);
+    }
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    png.assign(SIGNATURE, SIGNATURE + 8);
+
+    size_t start = png.size();
+    beginChunk("IHDR");
+    putBigEndian(png, (uint32_t)width);
+    putBigEndian(png, (uint32_t)height);
+    const uint8_t format[5] = { 8, 6, 0, 0, 0 };    // 8 bits, RGBA, deflate, adaptive filters, no interlace
+    png.insert(png.end(), format, format + 5);
+    endChunk(start);
+
+    start = png.size();
+    beginChunk("IDAT");
+    deflate(rowBytes);
+    endChunk(start);
+
+    start = png.size();
+    beginChunk("IEND");
+    endChunk(start);
+
+    return png;
+}
+
+bool writeFileBytes(const std::string& path, const std::vector<uint8_t>& data, std::string& error) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "cannot create file";
+        return false;
+    }
+
+    bool ok = data.empty() || fwrite(data.data(), 1, data.size(), out) == data.size();
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) error = "write failed";
+    return ok;
+}
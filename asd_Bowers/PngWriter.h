@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal PNG encoder for 8-bit RGBA images, with no library behind it.
+//
+// Rows are stored unfiltered and compressed as one fixed-Huffman deflate
+// block whose only matches are runs of the pixel to the left or the row
+// above. That suits rendered boards (large flat areas) and keeps encoding
+// to a single pass over the pixels.
+class PngEncoder {
+public:
+    // pixels holds height rows of width RGBA pixels, pitch bytes apart. The
+    // returned file image stays valid until the next encode.
+    const std::vector<uint8_t>& encode(const uint8_t* pixels, int width, int height, int pitch);
+
+private:
+    std::vector<uint8_t> raw;       // scanlines with their filter bytes
+    std::vector<uint8_t> png;
+
+    void deflate(int rowBytes);
+    void beginChunk(const char* type);
+    void endChunk(size_t start);
+};
+
+// Writes data to path in one go
+bool writeFileBytes(const std::string& path, const std::vector<uint8_t>& data, std::string& error);
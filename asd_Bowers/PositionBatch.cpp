@@ -0,0 +1,215 @@
+#include "PositionBatch.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(BOWERS_X86)
+#include <immintrin.h>
+#endif
+
+PositionBatch::PositionBatch(const BoardTopology& topology) : topology(&topology),
+cellCount(topology.nodeCount()), count(0), stride(0) {}
+
+PositionBatch::PositionBatch(int capacity) : PositionBatch(BoardTopology::standard(), capacity) {}
+
+PositionBatch::PositionBatch(const BoardTopology& topology, int capacity) : PositionBatch(topology) {
+    reserve(capacity);
+}
+
+void PositionBatch::reserve(int capacity) {
+    int newStride = (capacity + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN;
+    if (newStride <= stride) return;
+
+    std::vector<uint8_t> newCells((size_t)cellCount * newStride, NONE);
+    for (int cell = 0; cell < cellCount && count > 0; cell++) {
+        std::memcpy(newCells.data() + (size_t)cell * newStride,
+            cells.data() + (size_t)cell * stride, count);
+    }
+
+    cells.swap(newCells);
+    killed1.resize(newStride, 0);
+    killed2.resize(newStride, 0);
+    stride = newStride;
+}
+
+void PositionBatch::clear() {
+    std::fill(cells.begin(), cells.end(), (uint8_t)NONE);
+    std::fill(killed1.begin(), killed1.end(), 0);
+    std::fill(killed2.begin(), killed2.end(), 0);
+    count = 0;
+}
+
+int PositionBatch::add(const GameBoard& board) {
+    if (&board.getTopology() != topology) return -1;
+
+    if (count == stride) {
+        reserve(std::max(LANE_ALIGN, stride * 2));
+    }
+
+    NodeMask player1 = board.getPieces(PLAYER1);
+    NodeMask player2 = board.getPieces(PLAYER2);
+    for (int node = 0; node < cellCount; node++) {
+        NodeMask bit = nodeBit(node);
+        cells[(size_t)node * stride + count] = (uint8_t)((player1 & bit) ? PLAYER1 : (player2 & bit) ? PLAYER2 : NONE);
+    }
+
+    killed1[count] = (uint8_t)board.getKilledUnits(PLAYER1);
+    killed2[count] = (uint8_t)board.getKilledUnits(PLAYER2);
+
+    return count++;
+}
+
+static int evaluateLane(const BatchEvalWeights& w, const PositionBatch& batch, int i) {
+    Player opponent = (w.aiPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+
+    bool p1Wins = true, p2Wins = true;
+    for (NodeMask m = w.goalMask[PLAYER1]; m; m &= m - 1) {
+        if (batch.cellLane(lowestNode(m))[i] != PLAYER1) p1Wins = false;
+    }
+    for (NodeMask m = w.goalMask[PLAYER2]; m; m &= m - 1) {
+        if (batch.cellLane(lowestNode(m))[i] != PLAYER2) p2Wins = false;
+    }
+
+    if (p1Wins) return (w.aiPlayer == PLAYER1) ? w.winScore : -w.winScore;
+    if (p2Wins) return (w.aiPlayer == PLAYER2) ? w.winScore : -w.winScore;
+
+    int score = 0;
+    for (int cell = 0; cell < batch.getCellCount(); cell++) {
+        int value = batch.cellLane(cell)[i];
+        if (value == w.aiPlayer) score += w.aiCell[cell];
+        else if (value == opponent) score -= w.oppCell[cell];
+    }
+
+    score -= batch.killedLane(w.aiPlayer)[i] * w.killedWeight;
+    score += batch.killedLane(opponent)[i] * w.killedWeight;
+
+    return score;
+}
+
+static void evaluateScalar(const BatchEvalWeights& w, const PositionBatch& batch, int begin, int* scores) {
+    for (int i = begin; i < batch.size(); i++) {
+        scores[i] = evaluateLane(w, batch, i);
+    }
+}
+
+#if defined(BOWERS_X86)
+// Scores fit comfortably in 16 bits (|score| <= 10000), so both kernels work on
+// int16 lanes: 8 positions per SSE2 register, 16 per AVX2 register.
+
+static int evaluateSse2(const BatchEvalWeights& w, const PositionBatch& batch, int* scores) {
+    Player opponent = (w.aiPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i aiValue = _mm_set1_epi16((short)w.aiPlayer);
+    const __m128i oppValue = _mm_set1_epi16((short)opponent);
+    const __m128i p1Value = _mm_set1_epi16(PLAYER1);
+    const __m128i p2Value = _mm_set1_epi16(PLAYER2);
+    const __m128i killedWeight = _mm_set1_epi16(w.killedWeight);
+    const __m128i p1WinScore = _mm_set1_epi16((short)((w.aiPlayer == PLAYER1) ? w.winScore : -w.winScore));
+    const __m128i p2WinScore = _mm_set1_epi16((short)((w.aiPlayer == PLAYER2) ? w.winScore : -w.winScore));
+    const uint8_t* aiKilled = batch.killedLane(w.aiPlayer);
+    const uint8_t* oppKilled = batch.killedLane(opponent);
+
+    int n = batch.size() & ~7;
+    for (int i = 0; i < n; i += 8) {
+        __m128i score = zero;
+        __m128i p1Wins = _mm_cmpeq_epi16(zero, zero);
+        __m128i p2Wins = p1Wins;
+
+        for (int cell = 0; cell < batch.getCellCount(); cell++) {
+            __m128i bytes = _mm_loadl_epi64((const __m128i*)(batch.cellLane(cell) + i));
+            __m128i value = _mm_unpacklo_epi8(bytes, zero);
+
+            __m128i isAi = _mm_cmpeq_epi16(value, aiValue);
+            __m128i isOpp = _mm_cmpeq_epi16(value, oppValue);
+            score = _mm_add_epi16(score, _mm_and_si128(isAi, _mm_set1_epi16(w.aiCell[cell])));
+            score = _mm_sub_epi16(score, _mm_and_si128(isOpp, _mm_set1_epi16(w.oppCell[cell])));
+
+            NodeMask bit = nodeBit(cell);
+            if (w.goalMask[PLAYER2] & bit) p2Wins = _mm_and_si128(p2Wins, _mm_cmpeq_epi16(value, p2Value));
+            if (w.goalMask[PLAYER1] & bit) p1Wins = _mm_and_si128(p1Wins, _mm_cmpeq_epi16(value, p1Value));
+        }
+
+        __m128i aiK = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(aiKilled + i)), zero);
+        __m128i oppK = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(oppKilled + i)), zero);
+        score = _mm_sub_epi16(score, _mm_mullo_epi16(aiK, killedWeight));
+        score = _mm_add_epi16(score, _mm_mullo_epi16(oppK, killedWeight));
+
+        // Player 1 is checked first, matching GameBoard::getWinner
+        p2Wins = _mm_andnot_si128(p1Wins, p2Wins);
+        __m128i decided = _mm_or_si128(p1Wins, p2Wins);
+        __m128i terminal = _mm_or_si128(_mm_and_si128(p1Wins, p1WinScore), _mm_and_si128(p2Wins, p2WinScore));
+        score = _mm_or_si128(_mm_andnot_si128(decided, score), terminal);
+
+        _mm_storeu_si128((__m128i*)(scores + i), _mm_srai_epi32(_mm_unpacklo_epi16(score, score), 16));
+        _mm_storeu_si128((__m128i*)(scores + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(score, score), 16));
+    }
+
+    return n;
+}
+
+BOWERS_TARGET_AVX2
+static int evaluateAvx2(const BatchEvalWeights& w, const PositionBatch& batch, int* scores) {
+    Player opponent = (w.aiPlayer == PLAYER1) ? PLAYER2 : PLAYER1;
+    const __m256i aiValue = _mm256_set1_epi16((short)w.aiPlayer);
+    const __m256i oppValue = _mm256_set1_epi16((short)opponent);
+    const __m256i p1Value = _mm256_set1_epi16(PLAYER1);
+    const __m256i p2Value = _mm256_set1_epi16(PLAYER2);
+    const __m256i killedWeight = _mm256_set1_epi16(w.killedWeight);
+    const __m256i p1WinScore = _mm256_set1_epi16((short)((w.aiPlayer == PLAYER1) ? w.winScore : -w.winScore));
+    const __m256i p2WinScore = _mm256_set1_epi16((short)((w.aiPlayer == PLAYER2) ? w.winScore : -w.winScore));
+    const uint8_t* aiKilled = batch.killedLane(w.aiPlayer);
+    const uint8_t* oppKilled = batch.killedLane(opponent);
+
+    int n = batch.size() & ~15;
+    for (int i = 0; i < n; i += 16) {
+        __m256i score = _mm256_setzero_si256();
+        __m256i p1Wins = _mm256_cmpeq_epi16(score, score);
+        __m256i p2Wins = p1Wins;
+
+        for (int cell = 0; cell < batch.getCellCount(); cell++) {
+            __m256i value = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(batch.cellLane(cell) + i)));
+
+            __m256i isAi = _mm256_cmpeq_epi16(value, aiValue);
+            __m256i isOpp = _mm256_cmpeq_epi16(value, oppValue);
+            score = _mm256_add_epi16(score, _mm256_and_si256(isAi, _mm256_set1_epi16(w.aiCell[cell])));
+            score = _mm256_sub_epi16(score, _mm256_and_si256(isOpp, _mm256_set1_epi16(w.oppCell[cell])));
+
+            NodeMask bit = nodeBit(cell);
+            if (w.goalMask[PLAYER2] & bit) p2Wins = _mm256_and_si256(p2Wins, _mm256_cmpeq_epi16(value, p2Value));
+            if (w.goalMask[PLAYER1] & bit) p1Wins = _mm256_and_si256(p1Wins, _mm256_cmpeq_epi16(value, p1Value));
+        }
+
+        __m256i aiK = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(aiKilled + i)));
+        __m256i oppK = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(oppKilled + i)));
+        score = _mm256_sub_epi16(score, _mm256_mullo_epi16(aiK, killedWeight));
+        score = _mm256_add_epi16(score, _mm256_mullo_epi16(oppK, killedWeight));
+
+        p2Wins = _mm256_andnot_si256(p1Wins, p2Wins);
+        __m256i decided = _mm256_or_si256(p1Wins, p2Wins);
+        __m256i terminal = _mm256_or_si256(_mm256_and_si256(p1Wins, p1WinScore), _mm256_and_si256(p2Wins, p2WinScore));
+        score = _mm256_or_si256(_mm256_andnot_si256(decided, score), terminal);
+
+        _mm256_storeu_si256((__m256i*)(scores + i), _mm256_cvtepi16_epi32(_mm256_castsi256_si128(score)));
+        _mm256_storeu_si256((__m256i*)(scores + i + 8), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(score, 1)));
+    }
+
+    return n;
+}
+#endif
+
+void evaluatePositionBatch(const BatchEvalWeights& weights, const PositionBatch& batch,
+    int* scores, SimdLevel level) {
+    int done = 0;
+
+#if defined(BOWERS_X86)
+    if (level == SIMD_AVX2) {
+        done = evaluateAvx2(weights, batch, scores);
+    }
+    else if (level == SIMD_SSE2) {
+        done = evaluateSse2(weights, batch, scores);
+    }
+#else
+    (void)level;
+#endif
+
+    evaluateScalar(weights, batch, done, scores);
+}
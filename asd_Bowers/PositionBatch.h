@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GameBoard.h"
+#include "Simd.h"
+
+// Structure-of-arrays block of positions for the batch evaluator.
+// Cell values are stored cell-major, one cell per board node: all positions'
+// node 0, then all node 1, ... so the kernels can load the same node of many
+// positions with one vector load. All positions share the batch's topology.
+class PositionBatch {
+public:
+    static const int LANE_ALIGN = 32;
+
+    explicit PositionBatch(const BoardTopology& topology = BoardTopology::standard());
+    explicit PositionBatch(int capacity);
+    PositionBatch(const BoardTopology& topology, int capacity);
+
+    void reserve(int capacity);
+    void clear();
+    // Index of the position, or -1 if board is on another topology
+    int add(const GameBoard& board);
+
+    int size() const { return count; }
+    int getStride() const { return stride; }
+    int getCellCount() const { return cellCount; }
+    const BoardTopology& getTopology() const { return *topology; }
+
+    const uint8_t* cellLane(int cell) const { return cells.data() + (size_t)cell * stride; }
+    const uint8_t* killedLane(Player player) const {
+        return (player == PLAYER1) ? killed1.data() : killed2.data();
+    }
+
+private:
+    const BoardTopology* topology;
+    int cellCount;
+    int count;
+    int stride;
+    std::vector<uint8_t> cells;
+    std::vector<uint8_t> killed1;
+    std::vector<uint8_t> killed2;
+};
+
+// Evaluation terms flattened into per-cell tables for one topology. Built by
+// AIPlayer so the kernels reproduce AIPlayer::evaluate exactly.
+struct BatchEvalWeights {
+    Player aiPlayer;
+    int cellCount;
+    int16_t aiCell[MAX_BOARD_NODES];
+    int16_t oppCell[MAX_BOARD_NODES];
+    NodeMask goalMask[3];       // a side holding all of its goal nodes has won
+    int16_t killedWeight;
+    int16_t winScore;
+};
+
+// weights must be built for the batch's topology
+void evaluatePositionBatch(const BatchEvalWeights& weights, const PositionBatch& batch,
+    int* scores, SimdLevel level = getSimdLevel());
@@ -0,0 +1,109 @@
+#include "PositionHistory.h"
+
+namespace {
+    const size_t INITIAL_SLOTS = 64;
+}
+
+PositionHistory::PositionHistory() : usedSlots(0) {
+    slotKeys.assign(INITIAL_SLOTS, 0);
+    slotCounts.assign(INITIAL_SLOTS, 0);
+}
+
+void PositionHistory::clear() {
+    keys.clear();
+    slotKeys.assign(INITIAL_SLOTS, 0);
+    slotCounts.assign(INITIAL_SLOTS, 0);
+    usedSlots = 0;
+}
+
+// Key 0 marks an empty slot. A key whose count drops to zero keeps its slot
+// until the next rebuild, so a search revisiting the same line reuses it.
+size_t PositionHistory::findSlot(uint64_t key) const {
+    size_t mask = slotKeys.size() - 1;
+    size_t i = (size_t)(key ^ (key >> 32)) & mask;
+
+    while (slotKeys[i] != key && slotKeys[i] != 0) {
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+// Rebuilds the table without the zero-count slots, doubling it only when the
+// live keys alone would keep it over a quarter full.
+void PositionHistory::grow() {
+    size_t live = 0;
+    for (uint32_t c : slotCounts) {
+        if (c > 0) live++;
+    }
+
+    size_t size = slotKeys.size();
+    while ((live + 1) * 4 > size) size *= 2;
+
+    std::vector<uint64_t> oldKeys;
+    std::vector<uint32_t> oldCounts;
+    oldKeys.swap(slotKeys);
+    oldCounts.swap(slotCounts);
+
+    slotKeys.assign(size, 0);
+    slotCounts.assign(size, 0);
+    usedSlots = 0;
+
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+        if (oldKeys[i] == 0 || oldCounts[i] == 0) continue;
+
+        size_t slot = findSlot(oldKeys[i]);
+        slotKeys[slot] = oldKeys[i];
+        slotCounts[slot] = oldCounts[i];
+        usedSlots++;
+    }
+}
+
+void PositionHistory::push(uint64_t key) {
+    if ((usedSlots + 1) * 2 > slotKeys.size()) {
+        grow();
+    }
+
+    size_t slot = findSlot(key);
+    if (slotKeys[slot] == 0) {
+        slotKeys[slot] = key;
+        usedSlots++;
+    }
+    slotCounts[slot]++;
+
+    keys.push_back(key);
+}
+
+void PositionHistory::pop() {
+    if (keys.empty()) return;
+
+    size_t slot = findSlot(keys.back());
+    slotCounts[slot]--;
+    keys.pop_back();
+}
+
+int PositionHistory::count(uint64_t key) const {
+    size_t slot = findSlot(key);
+    return (slotKeys[slot] == key) ? (int)slotCounts[slot] : 0;
+}
+
+DrawReason PositionHistory::checkDraw(const DrawRules& rules) const {
+    if (keys.empty()) return DRAW_NONE;
+
+    if (rules.repetitionLimit > 0 && count(keys.back()) >= rules.repetitionLimit) {
+        return DRAW_REPETITION;
+    }
+    if (rules.moveLimit > 0 && plies() >= rules.moveLimit) {
+        return DRAW_MOVE_LIMIT;
+    }
+
+    return DRAW_NONE;
+}
+
+const char* drawReasonName(DrawReason reason) {
+    switch (reason) {
+    case DRAW_REPETITION: return "repetition";
+    case DRAW_MOVE_LIMIT: return "move limit";
+    default: return "none";
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum DrawReason { DRAW_NONE = 0, DRAW_REPETITION, DRAW_MOVE_LIMIT };
+
+// Adjudication limits; 0 disables a rule.
+struct DrawRules {
+    int repetitionLimit;    // draw when a position occurs this many times
+    int moveLimit;          // draw after this many plies
+
+    DrawRules() : repetitionLimit(3), moveLimit(300) {}
+    DrawRules(int repetitions, int plies) : repetitionLimit(repetitions), moveLimit(plies) {}
+};
+
+// Stack of position keys (GameBoard::getHash) with an occurrence count per key
+// in an open-addressing table, so push, pop and repetition checks are O(1).
+class PositionHistory {
+private:
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> slotKeys;
+    std::vector<uint32_t> slotCounts;
+    size_t usedSlots;
+
+    size_t findSlot(uint64_t key) const;
+    void grow();
+
+public:
+    PositionHistory();
+
+    void clear();
+    void push(uint64_t key);
+    void pop();
+
+    bool empty() const { return keys.empty(); }
+    uint64_t top() const { return keys.back(); }
+    int plies() const { return keys.empty() ? 0 : (int)keys.size() - 1; }
+
+    // Occurrences of key among the recorded positions
+    int count(uint64_t key) const;
+    bool isRepetition() const { return !keys.empty() && count(keys.back()) > 1; }
+
+    DrawReason checkDraw(const DrawRules& rules) const;
+};
+
+const char* drawReasonName(DrawReason reason);
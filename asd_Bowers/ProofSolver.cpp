@@ -0,0 +1,839 @@
+#include "ProofSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include "Notation.h"
+#include "Trace.h"
+
+namespace {
+    const uint32_t PN_INF = 0x7FFFFFFF;         // solved
+    const uint32_t PN_LIMIT = PN_INF - 1;       // saturated
+    const int TABLE_WAYS = 4;
+    const size_t SPILL_BATCH = 1 << 20;         // pending results per run file
+    const size_t MAX_RUNS = 8;                  // merged into one at the next checkpoint beyond this
+    const int FILTER_PROBES = 4;
+    const int64_t POLL_MS = 50;
+
+    uint32_t addSaturated(uint32_t a, uint32_t b) {
+        if (a == PN_INF || b == PN_INF) return PN_INF;
+        uint64_t sum = (uint64_t)a + b;
+        return sum >= PN_LIMIT ? PN_LIMIT : (uint32_t)sum;
+    }
+
+    uint32_t capThreshold(uint64_t value) {
+        return value >= PN_LIMIT ? PN_LIMIT : (uint32_t)value;
+    }
+
+    // Child threshold of the 1+epsilon trick, epsilon = 1/4
+    uint32_t widenedThreshold(uint32_t second) {
+        uint64_t widened = (uint64_t)second + std::max<uint64_t>(1, second / 4);
+        return capThreshold(widened);
+    }
+
+    uint64_t mixKey(uint64_t key, uint64_t seed) {
+        uint64_t x = key ^ seed;
+        x ^= x >> 31;
+        x *= 0x7FB5D329728EA185ULL;
+        x ^= x >> 27;
+        return x;
+    }
+
+    class SpinLock {
+    public:
+        explicit SpinLock(std::atomic<uint32_t>& flag) : lock(flag) {
+            while (lock.exchange(1, std::memory_order_acquire)) {
+                while (lock.load(std::memory_order_relaxed)) std::this_thread::yield();
+            }
+        }
+        ~SpinLock() { lock.store(0, std::memory_order_release); }
+
+    private:
+        std::atomic<uint32_t>& lock;
+    };
+}
+
+// Solved positions pushed out of the table. A lock-free Bloom filter over
+// every spilled key answers most misses without taking the lock; the rest
+// look in the pending batch and then the run files, newest first.
+class ProofSolver::SpillStore {
+public:
+    SpillStore(const std::string& dir, size_t expectedKeys) : directory(dir), nextRun(0), spilled(0) {
+        size_t words = 1;
+        while (words * 64 < expectedKeys * 16) words *= 2;
+        filter.reset(new std::atomic<uint64_t>[words]());
+        filterMask = words * 64 - 1;
+    }
+
+    bool isEnabled() const { return !directory.empty(); }
+    uint64_t count() const { return spilled.load(std::memory_order_relaxed); }
+
+    void add(uint64_t key, ProofResult result) {
+        if (!isEnabled()) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        mark(key);
+        uint8_t& stored = pending[key];
+        if (stored != PROOF_WIN) stored = (uint8_t)result;
+        spilled.fetch_add(1, std::memory_order_relaxed);
+
+        if (pending.size() >= SPILL_BATCH) {
+            std::string error;
+            if (!flushLocked(error)) {
+                // The results are only lost, never wrong; the next checkpoint reports it
+                failure = error;
+                pending.clear();
+            }
+        }
+    }
+
+    ProofResult find(uint64_t key) const {
+        if (!isMarked(key)) return PROOF_UNKNOWN;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(key);
+        if (it != pending.end()) return (ProofResult)it->second;
+
+        for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+            ProofResult result = (*run)->find(key);
+            if (result != PROOF_UNKNOWN) return result;
+        }
+        return PROOF_UNKNOWN;
+    }
+
+    // Writes the pending batch out and merges the runs if there are too many
+    bool flush(std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!failure.empty()) {
+            error = failure;
+            failure.clear();
+            return false;
+        }
+        if (!pending.empty() && !flushLocked(error)) return false;
+        if (runs.size() > MAX_RUNS && !mergeLocked(error)) return false;
+        return true;
+    }
+
+    bool open(const std::vector<std::string>& runNames, std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& name : runNames) {
+            std::unique_ptr<SolvedRun> run(new SolvedRun());
+            if (!run->open(proofPath(directory, name), error)) return false;
+
+            SolvedRunReader reader;
+            SolvedRecord record;
+            if (!reader.open(run->getPath())) {
+                error = "cannot read run " + run->getPath();
+                return false;
+            }
+            while (reader.next(record)) mark(record.key);
+
+            spilled.fetch_add(run->size(), std::memory_order_relaxed);
+            runs.push_back(std::move(run));
+            names.push_back(name);
+
+            int number = 0;
+            if (sscanf(name.c_str(), "spill-%d.run", &number) == 1) nextRun = std::max(nextRun, number + 1);
+        }
+        return true;
+    }
+
+    std::vector<std::string> runNames() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return names;
+    }
+
+    // Runs merged away stay on disk until a checkpoint no longer lists them
+    void removeObsolete() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& path : obsolete) remove(path.c_str());
+        obsolete.clear();
+    }
+
+private:
+    std::string directory;
+    std::unique_ptr<std::atomic<uint64_t>[]> filter;
+    uint64_t filterMask;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, uint8_t> pending;
+    std::vector<std::unique_ptr<SolvedRun>> runs;
+    std::vector<std::string> names;
+    std::vector<std::string> obsolete;
+    std::string failure;
+    int nextRun;
+    std::atomic<uint64_t> spilled;
+
+    void mark(uint64_t key) {
+        uint64_t h = key, step = (key >> 32) | 1;
+        for (int i = 0; i < FILTER_PROBES; i++, h += step) {
+            filter[(h & filterMask) >> 6].fetch_or(uint64_t(1) << (h & 63), std::memory_order_relaxed);
+        }
+    }
+
+    bool isMarked(uint64_t key) const {
+        uint64_t h = key, step = (key >> 32) | 1;
+        for (int i = 0; i < FILTER_PROBES; i++, h += step) {
+            uint64_t word = filter[(h & filterMask) >> 6].load(std::memory_order_relaxed);
+            if (!(word & (uint64_t(1) << (h & 63)))) return false;
+        }
+        return true;
+    }
+
+    std::string newRunName() {
+        char name[32];
+        snprintf(name, sizeof(name), "spill-%04d.run", nextRun++);
+        return name;
+    }
+
+    bool addRun(const std::string& name, std::string& error) {
+        std::unique_ptr<SolvedRun> run(new SolvedRun());
+        if (!run->open(proofPath(directory, name), error)) return false;
+        runs.push_back(std::move(run));
+        names.push_back(name);
+        return true;
+    }
+
+    bool flushLocked(std::string& error) {
+        std::vector<SolvedRecord> sorted;
+        sorted.reserve(pending.size());
+        for (const auto& entry : pending) {
+            SolvedRecord record;
+            record.key = entry.first;
+            record.result = entry.second;
+            sorted.push_back(record);
+        }
+        std::sort(sorted.begin(), sorted.end(),
+            [](const SolvedRecord& a, const SolvedRecord& b) { return a.key < b.key; });
+
+        std::string name = newRunName();
+        if (!SolvedRun::write(proofPath(directory, name), sorted, error)) return false;
+        if (!addRun(name, error)) return false;
+        pending.clear();
+        return true;
+    }
+
+    // k-way merge of all runs into one; a proof wins over a disproof of the
+    // same key, since only disproofs can depend on the path
+    bool mergeLocked(std::string& error) {
+        std::vector<std::unique_ptr<SolvedRunReader>> readers;
+        typedef std::pair<uint64_t, size_t> Head;   // key, reader
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        std::vector<SolvedRecord> current(runs.size());
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            readers.emplace_back(new SolvedRunReader());
+            if (!readers[i]->open(runs[i]->getPath())) {
+                error = "cannot read run " + runs[i]->getPath();
+                return false;
+            }
+            if (readers[i]->next(current[i])) heads.push(Head(current[i].key, i));
+        }
+
+        std::vector<SolvedRecord> merged;
+        while (!heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+
+            const SolvedRecord& record = current[head.second];
+            if (!merged.empty() && merged.back().key == record.key) {
+                if (record.result == PROOF_WIN) merged.back().result = PROOF_WIN;
+            }
+            else {
+                merged.push_back(record);
+            }
+
+            if (readers[head.second]->next(current[head.second])) {
+                heads.push(Head(current[head.second].key, head.second));
+            }
+        }
+        readers.clear();
+
+        std::string name = newRunName();
+        if (!SolvedRun::write(proofPath(directory, name), merged, error)) return false;
+
+        for (const auto& run : runs) obsolete.push_back(run->getPath());
+        runs.clear();
+        names.clear();
+        return addRun(name, error);
+    }
+};
+
+// Shared transposition table: buckets of four entries behind a spin lock
+// each. The entry with the least work below it makes room for a new one;
+// entries being searched are never replaced, and solved ones are spilled.
+class ProofSolver::Table {
+public:
+    Table(size_t bytes, SpillStore* spillStore) : spill(spillStore), usedEntries(0) {
+        bucketCount = 1;
+        while ((bucketCount * 2) * sizeof(Bucket) <= bytes) bucketCount *= 2;
+        buckets.reset(new Bucket[bucketCount]());
+    }
+
+    uint64_t capacity() const { return (uint64_t)bucketCount * TABLE_WAYS; }
+    uint64_t used() const { return usedEntries.load(std::memory_order_relaxed); }
+
+    // False when the position is in neither the table nor the spilled runs
+    bool lookup(uint64_t key, uint32_t& pn, uint32_t& dn, int& busy) {
+        {
+            Bucket& bucket = bucketFor(key);
+            SpinLock lock(bucket.lock);
+            for (Entry& entry : bucket.entries) {
+                if (entry.used && entry.key == key) {
+                    pn = entry.pn;
+                    dn = entry.dn;
+                    busy = entry.busy;
+                    return true;
+                }
+            }
+        }
+
+        ProofResult result = spill->find(key);
+        if (result == PROOF_UNKNOWN) return false;
+        pn = (result == PROOF_WIN) ? 0 : PN_INF;
+        dn = (result == PROOF_WIN) ? PN_INF : 0;
+        busy = 0;
+
+        // Brought back in, since it is evidently still needed
+        Evicted evicted;
+        {
+            Bucket& bucket = bucketFor(key);
+            SpinLock lock(bucket.lock);
+            Entry* entry = place(bucket, key, evicted);
+            if (entry) {
+                entry->pn = pn;
+                entry->dn = dn;
+            }
+        }
+        spillEvicted(evicted);
+        return true;
+    }
+
+    // Marks a position as being searched; false if no entry could be had
+    bool enter(uint64_t key) {
+        Evicted evicted;
+        bool entered = false;
+        {
+            Bucket& bucket = bucketFor(key);
+            SpinLock lock(bucket.lock);
+            Entry* entry = place(bucket, key, evicted);
+            if (entry) {
+                entry->busy++;
+                entered = true;
+            }
+        }
+        spillEvicted(evicted);
+        return entered;
+    }
+
+    void leave(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work, bool entered) {
+        Evicted evicted;
+        {
+            Bucket& bucket = bucketFor(key);
+            SpinLock lock(bucket.lock);
+            Entry* entry = place(bucket, key, evicted);
+            if (entry) {
+                // A position solved by another thread stays solved, except that a
+                // proof replaces a disproof: only disproofs can depend on the path
+                if ((entry->pn != 0 && entry->dn != 0) || (pn == 0 && entry->pn != 0)) {
+                    entry->pn = pn;
+                    entry->dn = dn;
+                }
+                entry->work = capThreshold((uint64_t)entry->work + work);
+                if (entered && entry->busy > 0) entry->busy--;
+            }
+            else if (pn == 0 || dn == 0) {
+                // Every entry is in use by a search; the result still must not be lost
+                evicted.key = key;
+                evicted.result = (pn == 0) ? PROOF_WIN : PROOF_NO_WIN;
+            }
+        }
+        spillEvicted(evicted);
+    }
+
+    void load(const std::vector<TableRecord>& records) {
+        for (const auto& record : records) {
+            Evicted evicted;
+            {
+                Bucket& bucket = bucketFor(record.key);
+                SpinLock lock(bucket.lock);
+                Entry* entry = place(bucket, record.key, evicted);
+                if (entry) {
+                    entry->pn = record.pn;
+                    entry->dn = record.dn;
+                    entry->work = record.work;
+                }
+            }
+            spillEvicted(evicted);
+        }
+    }
+
+    // Only called while no thread is searching
+    void snapshot(std::vector<TableRecord>& records) const {
+        records.clear();
+        for (size_t b = 0; b < bucketCount; b++) {
+            for (const Entry& entry : buckets[b].entries) {
+                if (!entry.used) continue;
+                TableRecord record;
+                record.key = entry.key;
+                record.pn = entry.pn;
+                record.dn = entry.dn;
+                record.work = entry.work;
+                records.push_back(record);
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t pn;
+        uint32_t dn;
+        uint32_t work;
+        uint16_t busy;              // threads searching below this position
+        uint16_t used;
+    };
+
+    struct Bucket {
+        std::atomic<uint32_t> lock;
+        Entry entries[TABLE_WAYS];
+    };
+
+    struct Evicted {
+        uint64_t key;
+        ProofResult result;
+
+        Evicted() : key(0), result(PROOF_UNKNOWN) {}
+    };
+
+    SpillStore* spill;
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketCount;
+    std::atomic<uint64_t> usedEntries;
+
+    Bucket& bucketFor(uint64_t key) { return buckets[(size_t)(key >> 20) & (bucketCount - 1)]; }
+
+    // Finds key's entry or makes one (pn = dn = 1) in place of the cheapest idle one
+    Entry* place(Bucket& bucket, uint64_t key, Evicted& evicted) {
+        Entry* victim = nullptr;
+        for (Entry& entry : bucket.entries) {
+            if (entry.used && entry.key == key) return &entry;
+            if (!entry.used) {
+                if (!victim || victim->used) victim = &entry;
+            }
+            else if (entry.busy == 0 && (!victim || (victim->used && entry.work < victim->work))) {
+                victim = &entry;
+            }
+        }
+        if (!victim) return nullptr;
+
+        if (!victim->used) {
+            usedEntries.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (victim->pn == 0 || victim->dn == 0) {
+            evicted.key = victim->key;
+            evicted.result = (victim->pn == 0) ? PROOF_WIN : PROOF_NO_WIN;
+        }
+
+        victim->key = key;
+        victim->pn = 1;
+        victim->dn = 1;
+        victim->work = 0;
+        victim->busy = 0;
+        victim->used = 1;
+        return victim;
+    }
+
+    void spillEvicted(const Evicted& evicted) {
+        if (evicted.result != PROOF_UNKNOWN) spill->add(evicted.key, evicted.result);
+    }
+};
+
+struct ProofSolver::Child {
+    uint64_t key;
+    uint32_t pn;
+    uint32_t dn;
+    int busy;
+    bool fixed;                 // terminal or repeated: the value needs no table
+};
+
+struct ProofSolver::Worker {
+    GameBoard board;
+    PositionHistory path;
+    std::vector<std::vector<Move>> moves;       // per ply
+    std::vector<std::vector<Child>> children;
+    uint64_t nodes;             // not yet added to the shared count
+    uint64_t seed;              // tie-break between equally good children
+
+    Worker(const GameBoard& root, int maxPlies) : board(root), moves(maxPlies + 1),
+        children(maxPlies + 1), nodes(0), seed(0) {}
+};
+
+ProofSolver::ProofSolver(const SolverConfig& solverConfig)
+    : config(solverConfig), attacker(NONE), maxPlies(DEFAULT_PROOF_PLIES), goalWidth(0), pausing(false), stopRequested(false),
+      nodes(0), livePn(1), liveDn(1), nodesBefore(0), timeBefore(0), sessionStartMs(0) {}
+
+ProofSolver::~ProofSolver() {}
+
+bool ProofSolver::prepare(std::string& error) {
+    if (!config.directory.empty()) {
+        std::error_code code;
+        std::filesystem::create_directories(config.directory, code);
+        if (code) {
+            error = "cannot create " + config.directory + ": " + code.message();
+            return false;
+        }
+    }
+
+    size_t bytes = std::max<size_t>(config.hashMb, 1) * 1024 * 1024;
+    spill.reset(new SpillStore(config.directory, bytes / 32));
+    table.reset(new Table(bytes, spill.get()));
+
+    goalWidth = countNodes(root.getTopology().goalMask[attacker]);
+    nodes = 0;
+    return true;
+}
+
+bool ProofSolver::start(const GameBoard& rootBoard, std::string& error) {
+    root = rootBoard;
+    attacker = (config.attacker != NONE) ? config.attacker : root.getCurrentPlayer();
+    maxPlies = std::max(1, config.maxPlies);
+    nodesBefore = 0;
+    timeBefore = 0;
+
+    if (!prepare(error)) return false;
+
+    // A crash before the first checkpoint must not resume an older proof
+    if (!config.directory.empty()) {
+        remove(proofPath(config.directory, PROOF_META_FILE).c_str());
+    }
+    return true;
+}
+
+bool ProofSolver::resume(const BoardTopology& topology, std::string& error) {
+    ProofMeta meta;
+    if (!meta.read(config.directory, error)) return false;
+
+    root = GameBoard(topology);
+    if (!boardFromString(meta.position, root, error)) return false;
+    attacker = meta.attacker;
+    maxPlies = std::max(1, meta.maxPlies);
+    nodesBefore = meta.nodes;
+    timeBefore = meta.timeMs;
+
+    if (!prepare(error)) return false;
+    if (!spill->open(meta.runs, error)) return false;
+
+    std::vector<TableRecord> records;
+    if (!readTableFile(proofPath(config.directory, PROOF_TABLE_FILE), records, false, error)) return false;
+    table->load(records);
+    return true;
+}
+
+void ProofSolver::stop() {
+    stopRequested = true;
+    pausing = true;
+}
+
+int64_t ProofSolver::sessionMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() - sessionStartMs;
+}
+
+SolverProgress ProofSolver::getProgress() const {
+    SolverProgress progress = SolverProgress();
+    int busy = 0;
+    if (!table->lookup(root.getHash(), progress.rootPn, progress.rootDn, busy) || busy > 0) {
+        progress.rootPn = livePn.load(std::memory_order_relaxed);
+        progress.rootDn = liveDn.load(std::memory_order_relaxed);
+    }
+    progress.nodes = nodesBefore + nodes.load(std::memory_order_relaxed);
+    progress.timeMs = timeBefore + sessionMs();
+    progress.tableUsed = table->used();
+    progress.tableCapacity = table->capacity();
+    progress.spilled = spill->count();
+    return progress;
+}
+
+ProofResult ProofSolver::rootResult() const {
+    SolverProgress progress = getProgress();
+    if (progress.rootPn == 0) return PROOF_WIN;
+    if (progress.rootDn == 0) return PROOF_NO_WIN;
+    return PROOF_UNKNOWN;
+}
+
+bool ProofSolver::checkpoint(std::string& error) {
+    if (config.directory.empty()) return true;
+    TRACE_SCOPE("solver.checkpoint");
+
+    if (!spill->flush(error)) return false;
+
+    std::vector<TableRecord> records;
+    table->snapshot(records);
+    std::string tablePath = proofPath(config.directory, PROOF_TABLE_FILE);
+    std::string tempPath = tablePath + ".tmp";
+    if (!writeTableFile(tempPath, records, error)) return false;
+    remove(tablePath.c_str());
+    if (rename(tempPath.c_str(), tablePath.c_str()) != 0) {
+        error = "cannot replace " + tablePath;
+        return false;
+    }
+
+    if (!root.getTopology().isStandard()) {
+        FILE* file = fopen(proofPath(config.directory, PROOF_BOARD_FILE).c_str(), "w");
+        std::string text = root.getTopology().toString();
+        if (!file || fwrite(text.data(), 1, text.size(), file) != text.size()) {
+            if (file) fclose(file);
+            error = "cannot write " + proofPath(config.directory, PROOF_BOARD_FILE);
+            return false;
+        }
+        fclose(file);
+    }
+
+    SolverProgress progress = getProgress();
+    ProofMeta meta;
+    meta.attacker = attacker;
+    meta.position = boardToString(root);
+    meta.maxPlies = maxPlies;
+    meta.nodes = progress.nodes;
+    meta.timeMs = progress.timeMs;
+    meta.runs = spill->runNames();
+    if (!meta.write(config.directory, error)) return false;
+
+    spill->removeObsolete();
+    return true;
+}
+
+// The driver sleeps while the workers search. At every checkpoint they all
+// unwind to the root so the table holds no busy entries when it is written.
+ProofResult ProofSolver::run(const SolverProgressCallback& onProgress) {
+    typedef std::chrono::steady_clock Clock;
+    sessionStartMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+    nodes = 0;
+    stopRequested = false;
+    lastError.clear();
+
+    int threadCount = (config.threads > 0) ? config.threads : std::max(1, (int)std::thread::hardware_concurrency());
+    int64_t nextReport = (int64_t)config.reportSeconds * 1000;
+    int64_t nextCheckpoint = (int64_t)config.checkpointSeconds * 1000;
+    int64_t timeLimit = config.timeLimitSeconds * 1000;
+
+    // A root that is already decided never reaches the workers
+    uint32_t rootPn = 1, rootDn = 1;
+    bool finished = terminalValue(PositionHistory(), root, rootPn, rootDn);
+    if (finished) {
+        table->leave(root.getHash(), rootPn, rootDn, 0, false);
+        std::string error;
+        if (!checkpoint(error)) lastError = error;
+    }
+
+    while (!finished) {
+        pausing = false;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++) {
+            threads.emplace_back(&ProofSolver::workerLoop, this, i);
+        }
+
+        bool checkpointDue = false;
+        while (!pausing) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+            int64_t elapsed = sessionMs();
+
+            if (onProgress && config.reportSeconds > 0 && elapsed >= nextReport) {
+                onProgress(getProgress());
+                nextReport = elapsed + (int64_t)config.reportSeconds * 1000;
+            }
+            if (timeLimit > 0 && elapsed >= timeLimit) {
+                finished = true;
+                pausing = true;
+            }
+            if (!config.directory.empty() && config.checkpointSeconds > 0 && elapsed >= nextCheckpoint) {
+                checkpointDue = true;
+                pausing = true;
+            }
+        }
+
+        for (auto& thread : threads) thread.join();
+
+        // Workers pause by themselves once the root is solved or saturated
+        SolverProgress progress = getProgress();
+        if (stopRequested || progress.rootPn == 0 || progress.rootDn == 0 ||
+            progress.rootPn >= PN_LIMIT || progress.rootDn >= PN_LIMIT) {
+            finished = true;
+        }
+
+        if (checkpointDue || finished) {
+            std::string error;
+            if (!checkpoint(error)) {
+                lastError = error;
+                finished = true;
+            }
+            nextCheckpoint = sessionMs() + (int64_t)config.checkpointSeconds * 1000;
+        }
+    }
+
+    if (onProgress) onProgress(getProgress());
+    return rootResult();
+}
+
+void ProofSolver::workerLoop(int index) {
+    TRACE_THREAD_NAME("proof worker");
+
+    Worker worker(root, maxPlies);
+    worker.seed = (uint64_t)index * 0x9E3779B97F4A7C15ULL;
+    worker.path.push(root.getHash());
+
+    while (!pausing.load(std::memory_order_relaxed)) {
+        uint32_t pn = 1, dn = 1;
+        mid(worker, 0, PN_LIMIT, PN_LIMIT, pn, dn);
+        if (pn == 0 || dn == 0 || pn >= PN_LIMIT || dn >= PN_LIMIT) pausing = true;
+    }
+
+    nodes.fetch_add(worker.nodes & 1023, std::memory_order_relaxed);
+}
+
+// pn/dn are from the attacker's side: OR nodes have the attacker to move
+bool ProofSolver::terminalValue(const PositionHistory& path, const GameBoard& board, uint32_t& pn, uint32_t& dn) const {
+    Player winner = board.getWinner();
+    bool won = (winner == attacker);
+
+    // Units are only revived onto the goal row from kills made there, so a
+    // side with fewer units than the row is wide can never fill it again
+    bool lost = (winner != NONE && !won) ||
+        countNodes(board.getPieces(attacker)) < goalWidth ||
+        path.count(board.getHash()) > 0;
+
+    if (!won && !lost) return false;
+    pn = won ? 0 : PN_INF;
+    dn = won ? PN_INF : 0;
+    return true;
+}
+
+void ProofSolver::expand(Worker& worker, int ply) {
+    GameBoard& board = worker.board;
+    std::vector<Move>& moves = worker.moves[ply];
+    std::vector<Child>& children = worker.children[ply];
+    // A side without a legal move passes
+    board.getLegalMovesOrPass(moves);
+    children.resize(moves.size());
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        MoveUndo undo;
+        board.makeMove(moves[i], undo);
+        board.switchPlayer();
+
+        Child& child = children[i];
+        child.key = board.getHash();
+        child.pn = 1;
+        child.dn = 1;
+        child.busy = 0;
+        child.fixed = terminalValue(worker.path, board, child.pn, child.dn);
+
+        board.switchPlayer();
+        board.unmakeMove(moves[i], undo);
+    }
+}
+
+void ProofSolver::mid(Worker& worker, int ply, uint32_t thresholdPn, uint32_t thresholdDn, uint32_t& pnOut, uint32_t& dnOut) {
+    // Lines this long count as not won, like repetitions
+    if (ply >= maxPlies) {
+        pnOut = PN_INF;
+        dnOut = 0;
+        return;
+    }
+
+    if ((++worker.nodes & 1023) == 0) nodes.fetch_add(1024, std::memory_order_relaxed);
+    uint64_t startNodes = worker.nodes;
+
+    GameBoard& board = worker.board;
+    uint64_t key = board.getHash();
+    bool orNode = (board.getCurrentPlayer() == attacker);
+
+    expand(worker, ply);
+    std::vector<Move>& moves = worker.moves[ply];
+    std::vector<Child>& children = worker.children[ply];
+    bool entered = table->enter(key);
+
+    uint32_t pn = 1, dn = 1;
+    for (;;) {
+        // "own" is the number this node minimises: pn at OR nodes, dn at AND nodes
+        uint32_t minOwn = PN_INF, sumOther = 0;
+        size_t best = 0;
+        uint64_t bestScore = UINT64_MAX, bestTie = 0;
+
+        for (size_t i = 0; i < children.size(); i++) {
+            Child& child = children[i];
+            if (!child.fixed) {
+                // Keeps the last known value if the child could not be stored
+                uint32_t childPn, childDn;
+                int busy = 0;
+                if (table->lookup(child.key, childPn, childDn, busy)) {
+                    child.pn = childPn;
+                    child.dn = childDn;
+                    child.busy = busy;
+                }
+            }
+
+            uint32_t own = orNode ? child.pn : child.dn;
+            uint32_t other = orNode ? child.dn : child.pn;
+            minOwn = std::min(minOwn, own);
+            sumOther = addSaturated(sumOther, other);
+
+            // Other threads below a child make it look that much more expensive
+            uint64_t score = (uint64_t)own * (1 + child.busy);
+            uint64_t tie = mixKey(child.key, worker.seed);
+            if (score < bestScore || (score == bestScore && tie < bestTie)) {
+                best = i;
+                bestScore = score;
+                bestTie = tie;
+            }
+        }
+
+        pn = orNode ? minOwn : sumOther;
+        dn = orNode ? sumOther : minOwn;
+        if (ply == 0) {
+            livePn.store(pn, std::memory_order_relaxed);
+            liveDn.store(dn, std::memory_order_relaxed);
+        }
+        if (pn >= thresholdPn || dn >= thresholdDn || pausing.load(std::memory_order_relaxed)) break;
+
+        uint64_t secondScore = UINT64_MAX;
+        for (size_t i = 0; i < children.size(); i++) {
+            if (i == best) continue;
+            uint32_t own = orNode ? children[i].pn : children[i].dn;
+            secondScore = std::min(secondScore, (uint64_t)own * (1 + children[i].busy));
+        }
+
+        Child& child = children[best];
+        uint32_t childOwn = orNode ? child.pn : child.dn;
+        uint32_t childOther = orNode ? child.dn : child.pn;
+        uint32_t ownThreshold = std::min(orNode ? thresholdPn : thresholdDn, widenedThreshold(capThreshold(secondScore)));
+        if (ownThreshold <= childOwn) ownThreshold = capThreshold((uint64_t)childOwn + 1);
+        uint32_t otherThreshold = capThreshold((uint64_t)(orNode ? thresholdDn - dn : thresholdPn - pn) + childOther);
+
+        uint32_t childPn = 1, childDn = 1;
+        MoveUndo undo;
+        board.makeMove(moves[best], undo);
+        board.switchPlayer();
+        worker.path.push(board.getHash());
+
+        mid(worker, ply + 1, orNode ? ownThreshold : otherThreshold, orNode ? otherThreshold : ownThreshold, childPn, childDn);
+
+        worker.path.pop();
+        board.switchPlayer();
+        board.unmakeMove(moves[best], undo);
+
+        // A result that holds only on this path must not be replaced by the table's
+        child.pn = childPn;
+        child.dn = childDn;
+        child.fixed = (childPn == 0 || childDn == 0);
+    }
+
+    table->leave(key, pn, dn, capThreshold(worker.nodes - startNodes), entered);
+    pnOut = pn;
+    dnOut = dn;
+}
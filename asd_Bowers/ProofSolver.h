@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GameBoard.h"
+#include "PositionHistory.h"
+#include "ProofTable.h"
+
+struct SolverConfig {
+    int threads;                // 0 = one per core
+    size_t hashMb;              // in-memory transposition table
+    std::string directory;      // checkpoints and spilled results; empty keeps everything in memory
+    int checkpointSeconds;
+    int reportSeconds;
+    int64_t timeLimitSeconds;   // 0 = until solved or stopped
+    Player attacker;            // side to prove a win for, NONE = side to move at the root
+    int maxPlies;               // longer lines count as not won; a resumed proof keeps its own
+
+    SolverConfig() : threads(0), hashMb(256), checkpointSeconds(300), reportSeconds(10),
+        timeLimitSeconds(0), attacker(NONE), maxPlies(DEFAULT_PROOF_PLIES) {}
+};
+
+struct SolverProgress {
+    uint32_t rootPn;            // proof number of the root, 0 once proven
+    uint32_t rootDn;            // disproof number of the root, 0 once disproven
+    uint64_t nodes;             // expansions, including earlier sessions of a resumed run
+    int64_t timeMs;
+    uint64_t tableUsed;
+    uint64_t tableCapacity;
+    uint64_t spilled;           // solved entries evicted to disk runs (a position may recur)
+};
+
+typedef std::function<void(const SolverProgress&)> SolverProgressCallback;
+
+// Depth-first proof-number search (df-pn, with the 1+epsilon trick) for
+// whether the attacker can force a fill of its goal row. All threads search
+// from the root over one shared table; a child being searched by another
+// thread looks more expensive than it is, which spreads them apart.
+//
+// Solved positions evicted from the table go to sorted runs on disk, and the
+// whole table is checkpointed to the directory now and then, so long proofs
+// survive restarts and their results can be loaded into a ProofTable.
+//
+// Proofs are exact. Positions repeated along the current line, and lines
+// longer than config.maxPlies, count as not won; that keeps the search
+// finite but can make a disproof depend on the path it was reached by (the
+// usual graph-history interaction). The draw move limit is not modelled,
+// but every proven win ends within maxPlies plies, which is saved with the
+// proof so a player can tell whether the limit leaves room for it.
+class ProofSolver {
+public:
+    explicit ProofSolver(const SolverConfig& config);
+    ~ProofSolver();
+
+    // New proof of root; earlier checkpoints in the directory are replaced
+    bool start(const GameBoard& root, std::string& error);
+    // Continues the checkpoint in config.directory, whose root must be on topology
+    bool resume(const BoardTopology& topology, std::string& error);
+
+    // Searches until the root is solved, the time limit passes or stop() is
+    // called, checkpointing on the way if there is a directory
+    ProofResult run(const SolverProgressCallback& onProgress = SolverProgressCallback());
+    void stop();    // from any thread
+
+    Player getAttacker() const { return attacker; }
+    const GameBoard& getRoot() const { return root; }
+    SolverProgress getProgress() const;
+    const std::string& getLastError() const { return lastError; }
+
+private:
+    class Table;
+    class SpillStore;
+    struct Child;
+    struct Worker;
+
+    SolverConfig config;
+    GameBoard root;
+    Player attacker;
+    int maxPlies;
+    int goalWidth;
+
+    std::unique_ptr<SpillStore> spill;
+    std::unique_ptr<Table> table;
+
+    std::atomic<bool> pausing;          // threads unwind for a checkpoint or the end
+    std::atomic<bool> stopRequested;
+    std::atomic<uint64_t> nodes;
+    std::atomic<uint32_t> livePn;       // root numbers while it is being searched
+    std::atomic<uint32_t> liveDn;
+    uint64_t nodesBefore;               // from sessions before a resume
+    int64_t timeBefore;
+    int64_t sessionStartMs;
+    std::string lastError;
+
+    bool prepare(std::string& error);
+    bool checkpoint(std::string& error);
+    ProofResult rootResult() const;
+    int64_t sessionMs() const;
+
+    void workerLoop(int index);
+    void mid(Worker& worker, int ply, uint32_t thresholdPn, uint32_t thresholdDn, uint32_t& pnOut, uint32_t& dnOut);
+    void expand(Worker& worker, int ply);
+    bool terminalValue(const PositionHistory& path, const GameBoard& board, uint32_t& pn, uint32_t& dn) const;
+
+    ProofSolver(const ProofSolver&) = delete;
+    ProofSolver& operator=(const ProofSolver&) = delete;
+};
@@ -0,0 +1,379 @@
+#include "ProofTable.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+const char* const PROOF_META_FILE = "dfpn.meta";
+const char* const PROOF_TABLE_FILE = "dfpn.tt";
+const char* const PROOF_BOARD_FILE = "dfpn.board";
+
+namespace {
+    const char RUN_MAGIC[8] = { 'B', 'W', 'R', 'U', 'N', '0', '0', '1' };
+    const char TABLE_MAGIC[8] = { 'B', 'W', 'T', 'T', '0', '0', '0', '1' };
+    const size_t RUN_HEADER = 16;
+    const size_t RECORD_BYTES = 9;
+    const size_t TABLE_RECORD_BYTES = 20;
+    const size_t BLOCK_RECORDS = 1024;
+    const int FILTER_PROBES = 6;
+
+    bool seekTo(FILE* file, uint64_t offset) {
+#if defined(_WIN32)
+        return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+        return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+
+    void packRecord(const SolvedRecord& record, unsigned char* out) {
+        memcpy(out, &record.key, 8);
+        out[8] = record.result;
+    }
+
+    void unpackRecord(const unsigned char* in, SolvedRecord& record) {
+        memcpy(&record.key, in, 8);
+        record.result = in[8];
+    }
+
+    bool readHeader(FILE* file, const char* magic, uint64_t& count) {
+        char header[8];
+        if (fread(header, 1, 8, file) != 8 || memcmp(header, magic, 8) != 0) return false;
+        return fread(&count, 8, 1, file) == 1;
+    }
+}
+
+const char* proofResultName(ProofResult result) {
+    switch (result) {
+    case PROOF_WIN: return "win";
+    case PROOF_NO_WIN: return "no win";
+    default: return "unknown";
+    }
+}
+
+std::string proofPath(const std::string& directory, const std::string& name) {
+    if (directory.empty()) return name;
+    char last = directory[directory.size() - 1];
+    return (last == '/' || last == '\\') ? directory + name : directory + "/" + name;
+}
+
+void KeyFilter::reset(size_t expectedKeys) {
+    // About 16 bits per key, rounded up to a power of two
+    size_t words = 1;
+    while (words * 64 < expectedKeys * 16) words *= 2;
+    bits.assign(words, 0);
+    mask = words * 64 - 1;
+}
+
+void KeyFilter::add(uint64_t key) {
+    uint64_t h = key, step = (key >> 32) | 1;
+    for (int i = 0; i < FILTER_PROBES; i++, h += step) {
+        bits[(h & mask) >> 6] |= uint64_t(1) << (h & 63);
+    }
+}
+
+bool KeyFilter::mayContain(uint64_t key) const {
+    if (bits.empty()) return false;
+
+    uint64_t h = key, step = (key >> 32) | 1;
+    for (int i = 0; i < FILTER_PROBES; i++, h += step) {
+        if (!(bits[(h & mask) >> 6] & (uint64_t(1) << (h & 63)))) return false;
+    }
+    return true;
+}
+
+SolvedRun::SolvedRun() : file(nullptr), count(0) {}
+
+SolvedRun::~SolvedRun() {
+    if (file) fclose(file);
+}
+
+bool SolvedRun::write(const std::string& path, const std::vector<SolvedRecord>& sorted, std::string& error) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    uint64_t total = sorted.size();
+    bool ok = fwrite(RUN_MAGIC, 1, 8, out) == 8 && fwrite(&total, 8, 1, out) == 1;
+
+    std::vector<unsigned char> buffer(BLOCK_RECORDS * RECORD_BYTES);
+    for (size_t i = 0; ok && i < sorted.size(); i += BLOCK_RECORDS) {
+        size_t n = std::min(BLOCK_RECORDS, sorted.size() - i);
+        for (size_t j = 0; j < n; j++) {
+            packRecord(sorted[i + j], &buffer[j * RECORD_BYTES]);
+        }
+        ok = fwrite(buffer.data(), RECORD_BYTES, n, out) == n;
+    }
+
+    if (fclose(out) != 0) ok = false;
+    if (!ok) error = "short write to " + path;
+    return ok;
+}
+
+bool SolvedRun::open(const std::string& runPath, std::string& error) {
+    path = runPath;
+    file = fopen(path.c_str(), "rb");
+    if (!file || !readHeader(file, RUN_MAGIC, count)) {
+        error = "cannot read run " + path;
+        return false;
+    }
+
+    // One pass to build the filter and the sparse index
+    filter.reset((size_t)count);
+    blockFirst.clear();
+
+    std::vector<unsigned char> buffer(BLOCK_RECORDS * RECORD_BYTES);
+    for (uint64_t i = 0; i < count; i += BLOCK_RECORDS) {
+        size_t n = (size_t)std::min<uint64_t>(BLOCK_RECORDS, count - i);
+        if (fread(buffer.data(), RECORD_BYTES, n, file) != n) {
+            error = "truncated run " + path;
+            return false;
+        }
+
+        for (size_t j = 0; j < n; j++) {
+            SolvedRecord record;
+            unpackRecord(&buffer[j * RECORD_BYTES], record);
+            if (j == 0) blockFirst.push_back(record.key);
+            filter.add(record.key);
+        }
+    }
+
+    return true;
+}
+
+ProofResult SolvedRun::find(uint64_t key) const {
+    if (!filter.mayContain(key)) return PROOF_UNKNOWN;
+
+    auto it = std::upper_bound(blockFirst.begin(), blockFirst.end(), key);
+    if (it == blockFirst.begin()) return PROOF_UNKNOWN;
+    uint64_t block = (uint64_t)(it - blockFirst.begin()) - 1;
+
+    uint64_t first = block * BLOCK_RECORDS;
+    size_t n = (size_t)std::min<uint64_t>(BLOCK_RECORDS, count - first);
+    unsigned char buffer[BLOCK_RECORDS * RECORD_BYTES];
+    {
+        std::lock_guard<std::mutex> lock(readMutex);
+        if (!seekTo(file, RUN_HEADER + first * RECORD_BYTES)) return PROOF_UNKNOWN;
+        if (fread(buffer, RECORD_BYTES, n, file) != n) return PROOF_UNKNOWN;
+    }
+
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        SolvedRecord record;
+        unpackRecord(&buffer[mid * RECORD_BYTES], record);
+        if (record.key == key) return (ProofResult)record.result;
+        if (record.key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return PROOF_UNKNOWN;
+}
+
+SolvedRunReader::SolvedRunReader() : file(nullptr), remaining(0) {}
+
+SolvedRunReader::~SolvedRunReader() {
+    if (file) fclose(file);
+}
+
+bool SolvedRunReader::open(const std::string& path) {
+    file = fopen(path.c_str(), "rb");
+    return file && readHeader(file, RUN_MAGIC, remaining);
+}
+
+bool SolvedRunReader::next(SolvedRecord& record) {
+    if (remaining == 0) return false;
+
+    unsigned char buffer[RECORD_BYTES];
+    if (fread(buffer, RECORD_BYTES, 1, file) != 1) return false;
+    unpackRecord(buffer, record);
+    remaining--;
+    return true;
+}
+
+bool writeTableFile(const std::string& path, const std::vector<TableRecord>& records, std::string& error) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    uint64_t total = records.size();
+    bool ok = fwrite(TABLE_MAGIC, 1, 8, out) == 8 && fwrite(&total, 8, 1, out) == 1;
+
+    unsigned char buffer[TABLE_RECORD_BYTES];
+    for (size_t i = 0; ok && i < records.size(); i++) {
+        memcpy(buffer, &records[i].key, 8);
+        memcpy(buffer + 8, &records[i].pn, 4);
+        memcpy(buffer + 12, &records[i].dn, 4);
+        memcpy(buffer + 16, &records[i].work, 4);
+        ok = fwrite(buffer, sizeof(buffer), 1, out) == 1;
+    }
+
+    if (fclose(out) != 0) ok = false;
+    if (!ok) error = "short write to " + path;
+    return ok;
+}
+
+bool readTableFile(const std::string& path, std::vector<TableRecord>& records, bool solvedOnly, std::string& error) {
+    records.clear();
+
+    FILE* in = fopen(path.c_str(), "rb");
+    uint64_t count = 0;
+    if (!in || !readHeader(in, TABLE_MAGIC, count)) {
+        if (in) fclose(in);
+        error = "cannot read " + path;
+        return false;
+    }
+
+    unsigned char buffer[TABLE_RECORD_BYTES];
+    for (uint64_t i = 0; i < count; i++) {
+        if (fread(buffer, sizeof(buffer), 1, in) != 1) {
+            fclose(in);
+            error = "truncated " + path;
+            return false;
+        }
+
+        TableRecord record;
+        memcpy(&record.key, buffer, 8);
+        memcpy(&record.pn, buffer + 8, 4);
+        memcpy(&record.dn, buffer + 12, 4);
+        memcpy(&record.work, buffer + 16, 4);
+        if (!solvedOnly || record.pn == 0 || record.dn == 0) records.push_back(record);
+    }
+
+    fclose(in);
+    return true;
+}
+
+bool ProofMeta::read(const std::string& directory, std::string& error) {
+    std::string path = proofPath(directory, PROOF_META_FILE);
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != "bowers-dfpn 1") {
+        error = path + " is not a solver checkpoint";
+        return false;
+    }
+
+    attacker = NONE;
+    maxPlies = DEFAULT_PROOF_PLIES;
+    runs.clear();
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+        fields >> std::ws;
+
+        if (name == "attacker") {
+            int side = 0;
+            fields >> side;
+            attacker = (side == 1) ? PLAYER1 : (side == 2) ? PLAYER2 : NONE;
+        }
+        else if (name == "position") std::getline(fields, position);
+        else if (name == "plies") fields >> maxPlies;
+        else if (name == "nodes") fields >> nodes;
+        else if (name == "time") fields >> timeMs;
+        else if (name == "run") {
+            std::string run;
+            fields >> run;
+            runs.push_back(run);
+        }
+    }
+
+    if (attacker == NONE || position.empty()) {
+        error = path + " has no attacker or position";
+        return false;
+    }
+    return true;
+}
+
+// Written beside and renamed over the old file, so a crash mid-write
+// leaves the previous checkpoint intact.
+bool ProofMeta::write(const std::string& directory, std::string& error) const {
+    std::string path = proofPath(directory, PROOF_META_FILE);
+    std::string temp = path + ".tmp";
+
+    {
+        std::ofstream out(temp);
+        if (!out) {
+            error = "cannot write " + temp;
+            return false;
+        }
+        out << "bowers-dfpn 1\n";
+        out << "attacker " << (int)attacker << "\n";
+        out << "position " << position << "\n";
+        out << "plies " << maxPlies << "\n";
+        out << "nodes " << nodes << "\n";
+        out << "time " << timeMs << "\n";
+        for (const auto& run : runs) out << "run " << run << "\n";
+        if (!out.flush()) {
+            error = "short write to " + temp;
+            return false;
+        }
+    }
+
+    remove(path.c_str());
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        error = "cannot replace " + path;
+        return false;
+    }
+    return true;
+}
+
+ProofTable::ProofTable() : attacker(NONE), maxPlies(DEFAULT_PROOF_PLIES) {}
+
+bool ProofTable::load(const std::string& directory, std::string& error) {
+    ProofMeta meta;
+    if (!meta.read(directory, error)) return false;
+
+    resident.clear();
+    runs.clear();
+
+    // Only solved entries of the table snapshot are of use here
+    std::vector<TableRecord> table;
+    if (!readTableFile(proofPath(directory, PROOF_TABLE_FILE), table, true, error)) return false;
+
+    for (const auto& entry : table) {
+        SolvedRecord solved;
+        solved.key = entry.key;
+        solved.result = (uint8_t)(entry.pn == 0 ? PROOF_WIN : PROOF_NO_WIN);
+        resident.push_back(solved);
+    }
+
+    std::sort(resident.begin(), resident.end(),
+        [](const SolvedRecord& a, const SolvedRecord& b) { return a.key < b.key; });
+
+    for (const auto& name : meta.runs) {
+        std::unique_ptr<SolvedRun> run(new SolvedRun());
+        if (!run->open(proofPath(directory, name), error)) return false;
+        runs.push_back(std::move(run));
+    }
+
+    attacker = meta.attacker;
+    maxPlies = meta.maxPlies;
+    return true;
+}
+
+ProofResult ProofTable::probe(uint64_t key) const {
+    auto it = std::lower_bound(resident.begin(), resident.end(), key,
+        [](const SolvedRecord& record, uint64_t k) { return record.key < k; });
+    if (it != resident.end() && it->key == key) return (ProofResult)it->result;
+
+    for (const auto& run : runs) {
+        ProofResult result = run->find(key);
+        if (result != PROOF_UNKNOWN) return result;
+    }
+    return PROOF_UNKNOWN;
+}
+
+uint64_t ProofTable::size() const {
+    uint64_t total = resident.size();
+    for (const auto& run : runs) total += run->size();
+    return total;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "GameTypes.h"
+
+// Outcome of a solved position for the attacker the solver was run for
+enum ProofResult { PROOF_UNKNOWN = 0, PROOF_WIN = 1, PROOF_NO_WIN = 2 };
+
+struct SolvedRecord {
+    uint64_t key;               // GameBoard::getHash
+    uint8_t result;             // ProofResult
+};
+
+// Fixed-size Bloom filter over position keys. Keys are Zobrist hashes, so
+// the probe positions are taken straight from their bits.
+class KeyFilter {
+public:
+    void reset(size_t expectedKeys);
+    void add(uint64_t key);
+    bool mayContain(uint64_t key) const;
+
+private:
+    std::vector<uint64_t> bits;
+    uint64_t mask;
+};
+
+// Sorted file of solved positions. Lookups go through a Bloom filter and a
+// sparse in-memory index, then read one block from disk.
+//
+// File: "BWRUN001", uint64 record count, then 9-byte records (key, result)
+// in ascending key order, little endian.
+class SolvedRun {
+public:
+    SolvedRun();
+    ~SolvedRun();
+
+    static bool write(const std::string& path, const std::vector<SolvedRecord>& sorted, std::string& error);
+    bool open(const std::string& path, std::string& error);
+
+    // Safe to call from several threads
+    ProofResult find(uint64_t key) const;
+
+    const std::string& getPath() const { return path; }
+    uint64_t size() const { return count; }
+
+private:
+    std::string path;
+    FILE* file;
+    uint64_t count;
+    std::vector<uint64_t> blockFirst;   // first key of every block
+    KeyFilter filter;
+    mutable std::mutex readMutex;
+
+    SolvedRun(const SolvedRun&) = delete;
+    SolvedRun& operator=(const SolvedRun&) = delete;
+};
+
+// Streams a run back in key order, for merging
+class SolvedRunReader {
+public:
+    SolvedRunReader();
+    ~SolvedRunReader();
+
+    bool open(const std::string& path);
+    bool next(SolvedRecord& record);
+
+private:
+    FILE* file;
+    uint64_t remaining;
+};
+
+const char* proofResultName(ProofResult result);
+
+// Solver line length cap unless configured; checkpoints without a "plies"
+// line were searched with it
+const int DEFAULT_PROOF_PLIES = 1000;
+
+// File names inside a solver directory
+extern const char* const PROOF_META_FILE;      // text: attacker, root, runs
+extern const char* const PROOF_TABLE_FILE;     // in-memory table of the last checkpoint
+extern const char* const PROOF_BOARD_FILE;     // topology, only for non-standard boards
+
+// dfpn.meta, one "name value" pair per line:
+//   bowers-dfpn 1
+//   attacker 1
+//   position 11111/...../...../...../22222 1 0 0
+//   plies 1000
+//   nodes 123456
+//   time 60000
+//   run spill-0000.run
+struct ProofMeta {
+    Player attacker;
+    std::string position;       // Notation board string of the root
+    int maxPlies;               // every proven win ends within this many plies
+    uint64_t nodes;
+    int64_t timeMs;
+    std::vector<std::string> runs;  // relative to the directory
+
+    ProofMeta() : attacker(NONE), maxPlies(DEFAULT_PROOF_PLIES), nodes(0), timeMs(0) {}
+
+    bool read(const std::string& directory, std::string& error);
+    bool write(const std::string& directory, std::string& error) const;
+};
+
+std::string proofPath(const std::string& directory, const std::string& name);
+
+// Snapshot of the solver's transposition table (dfpn.tt): "BWTT0001",
+// uint64 count, then 20-byte records (key, pn, dn, work).
+struct TableRecord {
+    uint64_t key;
+    uint32_t pn;                // 0: proven win for the attacker
+    uint32_t dn;                // 0: attacker cannot win
+    uint32_t work;              // nodes spent below the position
+};
+
+bool writeTableFile(const std::string& path, const std::vector<TableRecord>& records, std::string& error);
+bool readTableFile(const std::string& path, std::vector<TableRecord>& records, bool solvedOnly, std::string& error);
+
+// Read-only view of a ProofSolver directory, for AIPlayer to look up
+// proven positions during play. Results are for getAttacker(): PROOF_WIN
+// means that side forces a fill of its goal row from the position, within
+// getMaxPlies() plies.
+class ProofTable {
+public:
+    ProofTable();
+
+    bool load(const std::string& directory, std::string& error);
+    bool isLoaded() const { return attacker != NONE; }
+
+    Player getAttacker() const { return attacker; }
+    int getMaxPlies() const { return maxPlies; }
+    ProofResult probe(uint64_t key) const;
+    uint64_t size() const;
+
+private:
+    Player attacker;
+    int maxPlies;
+    std::vector<SolvedRecord> resident;     // solved entries of the last checkpoint, sorted
+    std::vector<std::unique_ptr<SolvedRun>> runs;
+};
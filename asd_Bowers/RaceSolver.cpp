@@ -0,0 +1,253 @@
+#include "RaceSolver.h"
+#include <algorithm>
+
+namespace {
+    const int MAX_RACE_MOVES = 64;
+    const uint64_t NODE_BUDGET = 20000;     // per raceLength
+    const int MAX_GOAL_NODES = 12;          // lowerBound keeps 2^goal nodes costs
+    const int UNREACHABLE = 1000;
+    const size_t REACHED_ENTRIES = 1 << 15;     // above the node budget; a power of two
+    const size_t VERDICT_ENTRIES = 1 << 14;     // a power of two
+}
+
+RaceSolver::RaceSolver(const BoardTopology& rules) :
+    topology(rules), nodes(rules.nodeCount()), scratch(rules), moveLists(MAX_RACE_MOVES + 1),
+    reached(REACHED_ENTRIES, ReachedEntry{ 0, 0, 0 }), iteration(0), verdicts(VERDICT_ENTRIES, VerdictEntry{ 0, -1, 0 }),
+    visited(0), outOfBudget(false) {
+    // Breadth-first from every node
+    distances.assign((size_t)nodes * nodes, UNREACHABLE);
+    for (int from = 0; from < nodes; from++) {
+        int* row = &distances[(size_t)from * nodes];
+        row[from] = 0;
+        NodeMask seen = nodeBit(from), frontier = seen;
+        for (int steps = 1; frontier; steps++) {
+            NodeMask next = 0;
+            for (NodeMask m = frontier; m; m &= m - 1) next |= topology.adjacencyMask[lowestNode(m)];
+            next &= ~seen;
+            for (NodeMask m = next; m; m &= m - 1) row[lowestNode(m)] = steps;
+            seen |= next;
+            frontier = next;
+        }
+    }
+
+    balls.assign((size_t)nodes * (nodes + 1), 0);
+    for (int from = 0; from < nodes; from++) {
+        for (int to = 0; to < nodes; to++) {
+            int steps = distances[(size_t)from * nodes + to];
+            for (int s = steps; s <= nodes && steps < UNREACHABLE; s++) balls[(size_t)from * (nodes + 1) + s] |= nodeBit(to);
+        }
+    }
+
+    for (int p = PLAYER1; p <= PLAYER2; p++) {
+        for (NodeMask m = topology.goalMask[p]; m; m &= m - 1) goalNodes[p].push_back(lowestNode(m));
+    }
+}
+
+int RaceSolver::distance(int from, int to) const {
+    int steps = distances[(size_t)from * nodes + to];
+    return (steps >= UNREACHABLE) ? -1 : steps;
+}
+
+// Cheapest way to send one unit to every goal node: each move brings one
+// unit one step closer at best, so no race is shorter
+int RaceSolver::lowerBound(NodeMask units, Player player) {
+    const std::vector<int>& goals = goalNodes[player];
+    int width = (int)goals.size();
+    if (countNodes(units) < width) return UNREACHABLE;
+
+    int full = (1 << width) - 1;
+    assignment.assign((size_t)full + 1, UNREACHABLE);
+    assignment[0] = 0;
+
+    for (NodeMask m = units; m; m &= m - 1) {
+        const int* row = &distances[(size_t)lowestNode(m) * nodes];
+        // Downwards, so every unit takes at most one goal node
+        for (int mask = full; mask >= 0; mask--) {
+            int cost = assignment[mask];
+            if (cost >= UNREACHABLE) continue;
+            for (int g = 0; g < width; g++) {
+                if (mask & (1 << g)) continue;
+                int& target = assignment[mask | (1 << g)];
+                target = std::min(target, cost + row[goals[g]]);
+            }
+        }
+    }
+    return std::min(assignment[full], UNREACHABLE);
+}
+
+// One move per goal node still empty
+int RaceSolver::quickBound(NodeMask units, Player player) const {
+    NodeMask goal = topology.goalMask[player];
+    if (countNodes(units) < countNodes(goal)) return UNREACHABLE;
+    return countNodes(goal & ~units);
+}
+
+NodeMask RaceSolver::reach(NodeMask from, int steps) const {
+    steps = std::min(steps, nodes);
+    NodeMask area = 0;
+    for (NodeMask m = from; m; m &= m - 1) area |= balls[(size_t)lowestNode(m) * (nodes + 1) + steps];
+    return area;
+}
+
+// Whether the sides could meet within the given number of moves each: share
+// a node, or land next to an enemy off the mover's goal row (a shot)
+bool RaceSolver::touches(NodeMask player1, NodeMask player2, int steps1, int steps2) const {
+    NodeMask area1 = reach(player1, steps1);
+    NodeMask area2 = reach(player2, steps2);
+    if (area1 & area2) return true;
+
+    for (NodeMask m = area1 & ~topology.goalMask[PLAYER1]; m; m &= m - 1) {
+        if (topology.adjacencyMask[lowestNode(m)] & area2) return true;
+    }
+    for (NodeMask m = area2 & ~topology.goalMask[PLAYER2]; m; m &= m - 1) {
+        if (topology.adjacencyMask[lowestNode(m)] & area1) return true;
+    }
+    return false;
+}
+
+bool RaceSolver::boundedSearch(Player player, int moves, int limit) {
+    if (++visited > NODE_BUDGET) {
+        outOfBudget = true;
+        return false;
+    }
+
+    NodeMask units = scratch.getPieces(player);
+    NodeMask goal = topology.goalMask[player];
+    if ((units & goal) == goal) return true;
+    if (moves + lowerBound(units, player) > limit) return false;
+
+    // A collision just overwrites: the table only prunes, it never decides
+    uint64_t key = scratch.getHash();
+    ReachedEntry& seen = reached[key & (REACHED_ENTRIES - 1)];
+    if (seen.iteration == iteration && seen.key == key && seen.moves <= moves) return false;
+    seen = ReachedEntry{ key, iteration, moves };
+
+    // The side keeps the move: the other one is not on the board
+    std::vector<Move>& list = moveLists[moves];
+    scratch.getLegalMoves(list);
+    for (const auto& move : list) {
+        MoveUndo undo;
+        scratch.makeMove(move, undo);
+        bool found = boundedSearch(player, moves + 1, limit);
+        scratch.unmakeMove(move, undo);
+        if (found) return true;
+        if (outOfBudget) return false;
+    }
+    return false;
+}
+
+int RaceSolver::raceLength(const GameBoard& board, Player player) {
+    if ((int)goalNodes[player].size() > MAX_GOAL_NODES) return -2;
+
+    NodeMask units = board.getPieces(player);
+    int bound = lowerBound(units, player);
+    if (bound >= UNREACHABLE) return -1;
+
+    scratch.setup((player == PLAYER1) ? units : 0, (player == PLAYER2) ? units : 0, player,
+        board.getKilledUnits(PLAYER1), board.getKilledUnits(PLAYER2));
+    for (int node = 0; node < nodes; node++) {
+        if (board.getHistoryFrom(node) >= 0) scratch.setHistory(node, board.getHistoryFrom(node), board.getHistoryCount(node));
+    }
+
+    visited = 0;
+    outOfBudget = false;
+    for (int limit = bound; limit <= MAX_RACE_MOVES; limit++) {
+        // Zero is never a live iteration, so fresh entries never match
+        if (++iteration == 0) {
+            std::fill(reached.begin(), reached.end(), ReachedEntry{ 0, 0, 0 });
+            iteration = 1;
+        }
+        if (boundedSearch(player, 0, limit)) return limit;
+        if (outOfBudget) return -2;
+    }
+    return -2;
+}
+
+bool RaceSolver::solve(const GameBoard& board, RaceResult& result) {
+    if (board.isGameOver()) return false;
+    if ((int)std::max(goalNodes[PLAYER1].size(), goalNodes[PLAYER2].size()) > MAX_GOAL_NODES) return false;
+
+    Player mover = board.getCurrentPlayer();
+    Player other = (mover == PLAYER1) ? PLAYER2 : PLAYER1;
+    NodeMask pieces[3] = { 0, board.getPieces(PLAYER1), board.getPieces(PLAYER2) };
+
+    // The game lasts at least as long as a lower bound on either race; if
+    // the sides can meet even then, this is no race. Counting the empty goal
+    // nodes is nearly free and turns away most positions, the assignment
+    // bound the rest.
+    int steps[3];
+    int quickMover = quickBound(pieces[mover], mover);
+    int quickOther = quickBound(pieces[other], other);
+    steps[mover] = std::min(quickMover, quickOther);
+    steps[other] = std::min(quickMover - 1, quickOther);
+    if (touches(pieces[PLAYER1], pieces[PLAYER2], steps[PLAYER1], steps[PLAYER2])) return false;
+
+    int boundMover = lowerBound(pieces[mover], mover);
+    int boundOther = lowerBound(pieces[other], other);
+    if (boundMover >= UNREACHABLE && boundOther >= UNREACHABLE) return false;
+
+    steps[mover] = std::min(boundMover, boundOther);
+    steps[other] = std::min(boundMover - 1, boundOther);
+    if (touches(pieces[PLAYER1], pieces[PLAYER2], steps[PLAYER1], steps[PLAYER2])) return false;
+
+    int movesMover = UNREACHABLE, movesOther = UNREACHABLE;
+    if (boundMover < UNREACHABLE) {
+        int length = raceLength(board, mover);
+        if (length == -2) return false;
+        if (length >= 0) movesMover = length;
+    }
+    // The other side cannot be faster than its bound
+    if (movesMover > boundOther) {
+        int length = (boundOther < UNREACHABLE) ? raceLength(board, other) : -1;
+        if (length == -2) return false;
+        if (length >= 0) movesOther = length;
+    }
+    if (movesMover >= UNREACHABLE && movesOther >= UNREACHABLE) return false;
+
+    // The mover fills on its movesMover-th move, the other side on its
+    // movesOther-th, one ply later in the same round
+    bool moverWins = movesMover <= movesOther;
+    if (moverWins) {
+        steps[mover] = movesMover;
+        steps[other] = movesMover - 1;
+    }
+    else {
+        steps[mover] = movesOther;
+        steps[other] = movesOther;
+    }
+    if (touches(pieces[PLAYER1], pieces[PLAYER2], steps[PLAYER1], steps[PLAYER2])) return false;
+
+    result.winner = moverWins ? mover : other;
+    result.plies = moverWins ? 2 * movesMover - 1 : 2 * movesOther;
+    return true;
+}
+
+bool RaceSolver::inContact(const GameBoard& board) const {
+    NodeMask player1 = board.getPieces(PLAYER1);
+    NodeMask player2 = board.getPieces(PLAYER2);
+
+    // touches() with no moves: a unit off its goal row next to an enemy
+    NodeMask near1 = 0, near2 = 0;
+    for (NodeMask m = player1; m; m &= m - 1) near1 |= topology.adjacencyMask[lowestNode(m)];
+    for (NodeMask m = player2; m; m &= m - 1) near2 |= topology.adjacencyMask[lowestNode(m)];
+    return (player1 & ~topology.goalMask[PLAYER1] & near2) || (player2 & ~topology.goalMask[PLAYER2] & near1);
+}
+
+bool RaceSolver::probe(const GameBoard& board, RaceResult& result) {
+    if (inContact(board)) return false;
+
+    uint64_t key = board.getHash();
+    VerdictEntry& entry = verdicts[key & (VERDICT_ENTRIES - 1)];
+    if (entry.key != key) {
+        bool race = solve(board, result);
+        entry.key = key;
+        entry.plies = race ? (int16_t)result.plies : -1;
+        entry.winner = race ? (int8_t)result.winner : (int8_t)NONE;
+        return race;
+    }
+
+    if (entry.plies < 0) return false;
+    result.winner = (Player)entry.winner;
+    result.plies = entry.plies;
+    return true;
+}
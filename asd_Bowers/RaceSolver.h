@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "GameBoard.h"
+
+struct RaceResult {
+    Player winner;
+    int plies;                  // until the winning move, inclusive
+};
+
+// Exact results for races: positions where, for as long as the game can
+// still last, no unit of either side can step next to (and so shoot, or be
+// shot by) an enemy unit or onto a node the other side can reach. Each side
+// then fills its goal row on its own, and the one needing fewer moves wins,
+// the side to move on a tie.
+//
+// How long a side needs is searched exactly (IDA* with GameBoard's own move
+// generator, so the three-move rule holds), guided by the cheapest
+// assignment of units to goal nodes over the precomputed shortest paths.
+// Reach is measured on the same paths, ignoring units in the way, which can
+// only overstate it.
+class RaceSolver {
+public:
+    explicit RaceSolver(const BoardTopology& topology);
+
+    const BoardTopology& getTopology() const { return topology; }
+
+    // Steps from one node to another, -1 if there is no path
+    int distance(int from, int to) const;
+
+    // False if the position is not a race, or the race was too long to
+    // search within the node budget
+    bool solve(const GameBoard& board, RaceResult& result);
+
+    // solve() for a search, which meets the same positions again and again:
+    // turns away armies still in contact at once and remembers verdicts by
+    // position hash (which covers everything solve() looks at)
+    bool probe(const GameBoard& board, RaceResult& result);
+
+    // Whether an enemy unit is next to one off its mover's goal row right
+    // now; such a position is never a race
+    bool inContact(const GameBoard& board) const;
+
+    // Fewest moves for player to fill its goal row if the other side were
+    // not there; -1 if it never can, -2 if the budget ran out
+    int raceLength(const GameBoard& board, Player player);
+
+private:
+    const BoardTopology& topology;
+    int nodes;
+    std::vector<int> distances;             // [from * nodes + to]
+    std::vector<NodeMask> balls;            // [from * (nodes + 1) + steps]: nodes within steps
+    std::vector<int> goalNodes[3];
+    std::vector<int> assignment;            // scratch for lowerBound
+
+    // Least moves a position was reached with in this iteration, direct
+    // mapped by hash; an entry of an older iteration counts as empty
+    struct ReachedEntry {
+        uint64_t key;
+        uint32_t iteration;
+        int moves;
+    };
+
+    // Verdict of solve() for a position, direct mapped by hash
+    struct VerdictEntry {
+        uint64_t key;
+        int16_t plies;          // -1: no race (or not solved)
+        int8_t winner;
+    };
+
+    GameBoard scratch;
+    std::vector<std::vector<Move>> moveLists;
+    std::vector<ReachedEntry> reached;
+    uint32_t iteration;
+    std::vector<VerdictEntry> verdicts;
+    uint64_t visited;
+    bool outOfBudget;
+
+    int quickBound(NodeMask units, Player player) const;
+    int lowerBound(NodeMask units, Player player);
+    NodeMask reach(NodeMask from, int steps) const;
+    bool touches(NodeMask player1, NodeMask player2, int steps1, int steps2) const;
+    bool boundedSearch(Player player, int moves, int limit);
+};
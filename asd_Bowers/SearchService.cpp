@@ -0,0 +1,399 @@
+#include "SearchService.h"
+#include <algorithm>
+#include "Trace.h"
+
+namespace {
+    // Search time a job with a deadline is left at least: once it would get
+    // less by waiting on, it stops a less urgent running job
+    const std::chrono::milliseconds START_RESERVE(20);
+}
+
+const char* searchStatusName(SearchStatus status) {
+    switch (status) {
+    case SEARCH_DONE: return "done";
+    case SEARCH_PREEMPTED: return "preempted";
+    case SEARCH_CANCELLED: return "cancelled";
+    case SEARCH_REJECTED: return "rejected";
+    }
+    return "unknown";
+}
+
+SearchService::SearchService(int workerCount, size_t maxQueued)
+    : queueLimit(maxQueued), queuedCount(0), nextJobId(1), nextTurn(0), stopping(false), preemptsInFlight(0) {
+    counters = SearchServiceStats();
+
+    if (workerCount <= 0) workerCount = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&SearchService::workerLoop, this);
+    }
+    deadlineWatcher = std::thread(&SearchService::watchDeadlines, this);
+}
+
+SearchService::~SearchService() {
+    std::vector<Job> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+
+        for (auto& entry : running) {
+            entry.second->cancelled = true;
+            entry.second->stop = true;
+        }
+        for (auto& level : levels) {
+            for (auto& owner : level.second.byOwner) {
+                for (auto& job : owner.second.jobs) dropped.push_back(std::move(job));
+            }
+        }
+        levels.clear();
+        queuedAt.clear();
+        queuedCount = 0;
+        counters.cancelled += dropped.size();
+    }
+    jobReady.notify_all();
+    queueChanged.notify_all();
+
+    for (auto& job : dropped) {
+        SearchOutcome outcome = SearchOutcome();
+        outcome.jobId = job.id;
+        outcome.status = SEARCH_CANCELLED;
+        if (job.onDone) job.onDone(outcome);
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    deadlineWatcher.join();
+}
+
+uint64_t SearchService::submit(SearchRequest request, SearchDoneCallback onDone) {
+    Job job;
+    job.request = std::move(request);
+    job.onDone = std::move(onDone);
+    job.submitTime = Clock::now();
+    job.deadline = (job.request.deadlineMs > 0) ?
+        job.submitTime + std::chrono::milliseconds(job.request.deadlineMs) : Clock::time_point::max();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!stopping && queuedCount < queueLimit) {
+            job.id = nextJobId++;
+            int priority = job.request.priority;
+            uint64_t owner = job.request.owner;
+            uint64_t id = job.id;
+
+            Clock::time_point submitTime = job.submitTime;
+
+            Level& level = levels[priority];
+            Level::Queue& queue = level.byOwner[owner];
+            if (queue.jobs.empty()) {
+                queue.turn = nextTurn++;
+            }
+            else {
+                level.order.erase(Level::Slot(queue.jobs.front().deadline, queue.turn, owner));
+            }
+
+            // Equal deadlines keep their submit order
+            auto at = std::upper_bound(queue.jobs.begin(), queue.jobs.end(), job.deadline,
+                [](Clock::time_point deadline, const Job& queued) { return deadline < queued.deadline; });
+            queue.jobs.insert(at, std::move(job));
+            level.order.insert(Level::Slot(queue.jobs.front().deadline, queue.turn, owner));
+            level.count++;
+
+            queuedAt[id] = std::make_pair(priority, owner);
+            queuedCount++;
+
+            preemptFor(priority);
+            preemptForDeadlines(submitTime);
+            jobReady.notify_one();
+            queueChanged.notify_one();
+            return id;
+        }
+
+        counters.rejected++;
+    }
+
+    SearchOutcome outcome = SearchOutcome();
+    outcome.status = SEARCH_REJECTED;
+    if (job.onDone) job.onDone(outcome);
+    return 0;
+}
+
+bool SearchService::cancel(uint64_t jobId) {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto active = running.find(jobId);
+        if (active != running.end()) {
+            active->second->cancelled = true;
+            active->second->stop = true;
+            return true;
+        }
+
+        auto queued = queuedAt.find(jobId);
+        if (queued == queuedAt.end()) return false;
+
+        auto levelIt = levels.find(queued->second.first);
+        Level& level = levelIt->second;
+        uint64_t owner = queued->second.second;
+        Level::Queue& queue = level.byOwner[owner];
+        level.order.erase(Level::Slot(queue.jobs.front().deadline, queue.turn, owner));
+
+        auto it = std::find_if(queue.jobs.begin(), queue.jobs.end(), [jobId](const Job& j) { return j.id == jobId; });
+        job = std::move(*it);
+        queue.jobs.erase(it);
+
+        if (queue.jobs.empty()) {
+            level.byOwner.erase(owner);
+        }
+        else {
+            level.order.insert(Level::Slot(queue.jobs.front().deadline, queue.turn, owner));
+        }
+        if (--level.count == 0) levels.erase(levelIt);
+
+        queuedAt.erase(queued);
+        queuedCount--;
+        counters.cancelled++;
+    }
+
+    SearchOutcome outcome = SearchOutcome();
+    outcome.jobId = job.id;
+    outcome.status = SEARCH_CANCELLED;
+    outcome.queueUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.submitTime).count();
+    if (job.onDone) job.onDone(outcome);
+    return true;
+}
+
+SearchServiceStats SearchService::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    SearchServiceStats stats = counters;
+    stats.queued = queuedCount;
+    stats.running = running.size();
+    return stats;
+}
+
+void SearchService::workerLoop() {
+    TRACE_THREAD_NAME("search worker");
+
+    for (;;) {
+        Job job;
+        std::shared_ptr<Running> state;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this] { return stopping || queuedCount > 0; });
+            if (stopping) return;
+
+            popJob(job);
+
+            state = std::make_shared<Running>();
+            state->priority = job.request.priority;
+            state->deadline = job.deadline;
+            state->stop = false;
+            state->searched = false;
+            state->preempted = false;
+            state->cancelled = false;
+            running[job.id] = state;
+        }
+
+        runJob(job, state);
+    }
+}
+
+// Deadlines of queued jobs come due while every worker is busy, with no
+// submit or finished iteration to notice them
+void SearchService::watchDeadlines() {
+    TRACE_THREAD_NAME("search deadlines");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        Clock::time_point now = Clock::now();
+        preemptForDeadlines(now);
+
+        Clock::time_point wake = nextUrgentTime(now);
+        if (wake == Clock::time_point::max()) {
+            queueChanged.wait(lock);
+        }
+        else {
+            queueChanged.wait_until(lock, wake);
+        }
+    }
+}
+
+// Takes the next job of the highest non-empty priority: the earliest
+// deadline, owners with equal ones in turn
+bool SearchService::popJob(Job& job) {
+    if (levels.empty()) return false;
+
+    auto levelIt = levels.begin();
+    Level& level = levelIt->second;
+
+    uint64_t owner = std::get<2>(*level.order.begin());
+    level.order.erase(level.order.begin());
+
+    Level::Queue& queue = level.byOwner[owner];
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+
+    if (queue.jobs.empty()) {
+        level.byOwner.erase(owner);
+    }
+    else {
+        queue.turn = nextTurn++;
+        level.order.insert(Level::Slot(queue.jobs.front().deadline, queue.turn, owner));
+    }
+    if (--level.count == 0) levels.erase(levelIt);
+
+    queuedAt.erase(job.id);
+    queuedCount--;
+
+    // The level's first deadline may have moved closer
+    queueChanged.notify_one();
+    return true;
+}
+
+size_t SearchService::queuedAbove(int priority) const {
+    size_t count = 0;
+    for (const auto& level : levels) {
+        if (level.first <= priority) break;
+        count += level.second.count;
+    }
+    return count;
+}
+
+// Called under the lock. Stops the least urgent running job that is outranked
+// by a waiting one, unless a worker is free or already being freed for it.
+void SearchService::preemptFor(int priority) {
+    if (running.size() < workers.size()) return;
+
+    Running* victim = nullptr;
+    for (auto& entry : running) {
+        Running* candidate = entry.second.get();
+        if (candidate->priority >= priority || candidate->preempted || candidate->cancelled) continue;
+        if (!candidate->searched) continue;
+
+        if (!victim || candidate->priority < victim->priority ||
+            (candidate->priority == victim->priority && candidate->deadline > victim->deadline)) {
+            victim = candidate;
+        }
+    }
+
+    if (victim && queuedAbove(victim->priority) > preemptsInFlight) {
+        victim->preempted = true;
+        victim->stop = true;
+        preemptsInFlight++;
+    }
+}
+
+// Called under the lock. Only the first job of a level can start next
+// there, so only those are checked: one that can no longer wait for a
+// worker to come free stops a running job with a later deadline.
+void SearchService::preemptForDeadlines(Clock::time_point now) {
+    if (running.size() < workers.size()) return;
+
+    size_t urgent = 0;
+    for (const auto& level : levels) {
+        Clock::time_point deadline = std::get<0>(*level.second.order.begin());
+        if (deadline == Clock::time_point::max() || now < deadline - START_RESERVE) continue;
+        if (++urgent <= preemptsInFlight) continue;
+
+        Running* victim = nullptr;
+        for (auto& entry : running) {
+            Running* candidate = entry.second.get();
+            if (candidate->priority > level.first || candidate->deadline <= deadline) continue;
+            if (candidate->preempted || candidate->cancelled || !candidate->searched) continue;
+
+            if (!victim || candidate->priority < victim->priority ||
+                (candidate->priority == victim->priority && candidate->deadline > victim->deadline)) {
+                victim = candidate;
+            }
+        }
+
+        if (victim) {
+            victim->preempted = true;
+            victim->stop = true;
+            preemptsInFlight++;
+        }
+    }
+}
+
+// Called under the lock. When the next first job of a level becomes urgent;
+// those already urgent are retried whenever a running job gets preemptible.
+SearchService::Clock::time_point SearchService::nextUrgentTime(Clock::time_point now) const {
+    Clock::time_point wake = Clock::time_point::max();
+    for (const auto& level : levels) {
+        Clock::time_point deadline = std::get<0>(*level.second.order.begin());
+        if (deadline == Clock::time_point::max()) continue;
+
+        Clock::time_point urgent = deadline - START_RESERVE;
+        if (urgent > now) wake = std::min(wake, urgent);
+    }
+    return wake;
+}
+
+void SearchService::runJob(Job& job, const std::shared_ptr<Running>& state) {
+    TRACE_SCOPE_ARG("service.job", "priority", job.request.priority);
+
+    Clock::time_point start = Clock::now();
+
+    SearchOutcome outcome = SearchOutcome();
+    outcome.jobId = job.id;
+    outcome.queueUs = std::chrono::duration_cast<std::chrono::microseconds>(start - job.submitTime).count();
+
+    // Whatever is left of the deadline bounds the search time
+    SearchLimits limits = job.request.limits;
+    if (state->deadline != Clock::time_point::max()) {
+        int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(state->deadline - start).count();
+        remaining = std::max<int64_t>(1, remaining);
+        if (limits.moveTimeMs == 0 || remaining < limits.moveTimeMs) {
+            limits.moveTimeMs = remaining;
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.deadlineCut++;
+        }
+    }
+
+    AIPlayer ai(job.request.board.getCurrentPlayer());
+    ai.setDrawRules(job.request.drawRules);
+
+    auto onInfo = [&](const SearchInfo& info) {
+        outcome.depth = info.depth;
+        outcome.score = info.score;
+
+        // A job started before a more urgent one arrived yields at the
+        // first iteration boundary after it has something to show.
+        if (!state->searched) {
+            state->searched = true;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queuedCount > 0) {
+                preemptFor(levels.begin()->first);
+                preemptForDeadlines(Clock::now());
+            }
+        }
+    };
+
+    const PositionHistory* history = job.request.history.empty() ? nullptr : &job.request.history;
+    outcome.bestMove = ai.search(job.request.board, limits, history, &state->stop, onInfo);
+    outcome.nodes = ai.getNodeCount();
+    outcome.searchUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (state->preempted) preemptsInFlight--;
+
+        if (state->cancelled) {
+            outcome.status = SEARCH_CANCELLED;
+            counters.cancelled++;
+        }
+        else if (state->preempted) {
+            outcome.status = SEARCH_PREEMPTED;
+            counters.preempted++;
+        }
+        else {
+            outcome.status = SEARCH_DONE;
+            counters.completed++;
+        }
+        running.erase(job.id);
+    }
+
+    if (job.onDone) job.onDone(outcome);
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "AIPlayer.h"
+
+enum SearchStatus {
+    SEARCH_DONE,        // ran to its own limits
+    SEARCH_PREEMPTED,   // stopped early for a more urgent job; best move so far
+    SEARCH_CANCELLED,   // cancel() or shutdown; bestMove is only set if it had started
+    SEARCH_REJECTED     // queue was full, never ran
+};
+
+const char* searchStatusName(SearchStatus status);
+
+struct SearchRequest {
+    GameBoard board;
+    PositionHistory history;    // game so far, ending with board; may be empty
+    DrawRules drawRules;
+    SearchLimits limits;        // at least one limit or a deadline should be set
+    int priority;               // higher runs first
+    int64_t deadlineMs;         // answer wanted this long after submit, 0 = none
+    uint64_t owner;             // jobs of one owner share a fair turn with other owners
+
+    SearchRequest() : priority(0), deadlineMs(0), owner(0) {}
+};
+
+struct SearchOutcome {
+    uint64_t jobId;
+    SearchStatus status;
+    Move bestMove;
+    int depth;                  // last completed iteration, 0 if none
+    int score;
+    uint64_t nodes;
+    int64_t queueUs;            // submit to start
+    int64_t searchUs;           // start to finish
+};
+
+typedef std::function<void(const SearchOutcome&)> SearchDoneCallback;
+
+struct SearchServiceStats {
+    size_t queued;
+    size_t running;
+    uint64_t completed;
+    uint64_t preempted;
+    uint64_t cancelled;
+    uint64_t rejected;
+    uint64_t deadlineCut;       // jobs whose budget was shortened by their deadline
+};
+
+// Runs AI searches from many callers on a fixed pool of threads.
+//
+// Queued jobs are ordered by priority, then by deadline, earliest first
+// (jobs without one come last). Owners with equal deadlines take turns in
+// round-robin order, so a caller flooding the queue cannot starve the
+// others. A deadline caps the search time to what is left of it when the
+// job starts, so a backed-up queue gives shallower searches rather than late
+// answers.
+//
+// Every worker busy, a running job is stopped once it has completed one
+// iteration, and reports its best move so far, when a job of higher
+// priority arrives, or when a waiting job would otherwise start with less
+// than a small reserve of its deadline left and the running job's deadline
+// is later (at no higher priority). The least urgent such job goes first.
+//
+// onDone is called exactly once per accepted or rejected job, on a worker
+// thread (or inside submit/cancel/the destructor), never under the lock.
+class SearchService {
+public:
+    // workers = 0 uses one thread per core
+    explicit SearchService(int workers = 0, size_t queueLimit = 4096);
+    ~SearchService();
+
+    SearchService(const SearchService&) = delete;
+    SearchService& operator=(const SearchService&) = delete;
+
+    // Returns the job id, or 0 if the queue is full (onDone gets SEARCH_REJECTED)
+    uint64_t submit(SearchRequest request, SearchDoneCallback onDone);
+
+    // Drops a queued job or stops a running one; false if it already finished
+    bool cancel(uint64_t jobId);
+
+    SearchServiceStats getStats() const;
+    int getWorkerCount() const { return (int)workers.size(); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job {
+        uint64_t id;
+        SearchRequest request;
+        SearchDoneCallback onDone;
+        Clock::time_point submitTime;
+        Clock::time_point deadline;     // max() when none
+    };
+
+    struct Running {
+        int priority;
+        Clock::time_point deadline;     // max() when none
+        std::atomic<bool> stop;
+        std::atomic<bool> searched;     // at least one iteration finished
+        bool preempted;
+        bool cancelled;
+    };
+
+    // Jobs of one priority. Each owner's jobs wait in deadline order; owners
+    // are served by the deadline of their first job, and an owner that was
+    // served goes behind the others with the same deadline.
+    struct Level {
+        struct Queue {
+            std::deque<Job> jobs;
+            uint64_t turn;              // place among owners with an equal deadline
+        };
+        typedef std::tuple<Clock::time_point, uint64_t, uint64_t> Slot;    // first deadline, turn, owner
+
+        std::unordered_map<uint64_t, Queue> byOwner;
+        std::set<Slot> order;
+        size_t count;
+
+        Level() : count(0) {}
+    };
+
+    std::vector<std::thread> workers;
+    std::thread deadlineWatcher;
+    size_t queueLimit;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable queueChanged;   // wakes the deadline watcher
+    std::map<int, Level, std::greater<int>> levels;
+    std::unordered_map<uint64_t, std::pair<int, uint64_t>> queuedAt;   // id -> priority, owner
+    std::unordered_map<uint64_t, std::shared_ptr<Running>> running;
+    size_t queuedCount;
+    uint64_t nextJobId;
+    uint64_t nextTurn;
+    bool stopping;
+    size_t preemptsInFlight;
+    SearchServiceStats counters;
+
+    void workerLoop();
+    void watchDeadlines();
+    bool popJob(Job& job);
+    size_t queuedAbove(int priority) const;
+    void preemptFor(int priority);
+    void preemptForDeadlines(Clock::time_point now);
+    Clock::time_point nextUrgentTime(Clock::time_point now) const;
+    void runJob(Job& job, const std::shared_ptr<Running>& state);
+};
@@ -0,0 +1,144 @@
+#include "SelfPlay.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "AIPlayer.h"
+#include "Tablebase.h"
+
+namespace {
+    const char DATA_MAGIC[8] = { 'B', 'W', 'T', 'D', '0', '0', '0', '1' };
+    const size_t RECORD_BYTES = 40;
+
+    struct TrainingRecord {
+        NodeMask units[2];
+        NodeMask killers[2];
+        uint8_t killed[2];
+        uint8_t toMove;
+        int16_t score;
+        uint16_t ply;
+    };
+
+    void appendRecord(const TrainingRecord& record, int8_t result, std::vector<unsigned char>& out) {
+        unsigned char bytes[RECORD_BYTES];
+        memcpy(bytes, record.units, 16);
+        memcpy(bytes + 16, record.killers, 16);
+        bytes[32] = record.killed[0];
+        bytes[33] = record.killed[1];
+        bytes[34] = record.toMove;
+        bytes[35] = (unsigned char)result;
+        memcpy(bytes + 36, &record.score, 2);
+        memcpy(bytes + 38, &record.ply, 2);
+        out.insert(out.end(), bytes, bytes + RECORD_BYTES);
+    }
+}
+
+SelfPlay::SelfPlay(const BoardTopology& topology, const SelfPlayConfig& config) :
+    topology(topology), config(config), network(nullptr) {}
+
+bool SelfPlay::run(const SelfPlayCallback& onGame, std::string& error) {
+    FILE* out = fopen(config.path.c_str(), "wb");
+    if (!out) {
+        error = "cannot write " + config.path;
+        return false;
+    }
+
+    uint32_t shape[2] = { (uint32_t)topology.rows, (uint32_t)topology.cols };
+    uint64_t key = topologyKey(topology);
+    bool ok = fwrite(DATA_MAGIC, 1, 8, out) == 8 && fwrite(shape, 4, 2, out) == 2 && fwrite(&key, 8, 1, out) == 1;
+
+    int threadCount = (config.threads > 0) ? config.threads : std::max(1, (int)std::thread::hardware_concurrency());
+    std::atomic<int> nextGame(0);
+    std::mutex outMutex;
+
+    auto worker = [&]() {
+        std::vector<TrainingRecord> records;
+        std::vector<unsigned char> bytes;
+
+        for (int game = nextGame.fetch_add(1); game < config.games; game = nextGame.fetch_add(1)) {
+            std::mt19937_64 rng(config.seed * 0x9E3779B97F4A7C15ULL + (uint64_t)game);
+            GameBoard board(topology);
+            PositionHistory history;
+            history.push(board.getHash());
+
+            AIPlayer players[2] = { AIPlayer(PLAYER1, config.depth), AIPlayer(PLAYER2, config.depth) };
+            SearchLimits limits;
+            limits.depth = config.depth;
+            for (AIPlayer& ai : players) {
+                ai.setDrawRules(config.drawRules);
+                ai.setNetwork(network);
+            }
+
+            records.clear();
+            Player winner = NONE;
+            for (int ply = 0; ; ply++) {
+                winner = board.getWinner();
+                if (winner != NONE || history.checkDraw(config.drawRules) != DRAW_NONE) break;
+
+                std::vector<Move> moves = board.getLegalMovesOrPass();
+
+                // A side without moves passes; there is nothing to record
+                Move move;
+                if (moves.front().isPass) {
+                    move = moves.front();
+                }
+                else if (ply < config.randomPlies) {
+                    move = moves[rng() % moves.size()];
+                }
+                else {
+                    Player mover = board.getCurrentPlayer();
+                    int score = 0;
+                    move = players[mover - 1].search(board, limits, &history, nullptr, [&score](const SearchInfo& info) {
+                        score = info.score;
+                    });
+
+                    TrainingRecord record;
+                    for (int p = PLAYER1; p <= PLAYER2; p++) {
+                        record.units[p - 1] = board.getPieces((Player)p);
+                        record.killers[p - 1] = board.getKillerNodes((Player)p);
+                        record.killed[p - 1] = (uint8_t)board.getKilledUnits((Player)p);
+                    }
+                    record.toMove = (uint8_t)mover;
+                    record.score = (int16_t)std::clamp(score, -10000, 10000);
+                    record.ply = (uint16_t)std::min(ply, 65535);
+                    records.push_back(record);
+                }
+
+                board.makeMove(move);
+                board.switchPlayer();
+                history.push(board.getHash());
+            }
+
+            bytes.clear();
+            for (const TrainingRecord& record : records) {
+                int8_t result = (winner == NONE) ? 0 : (winner == record.toMove) ? 1 : -1;
+                appendRecord(record, result, bytes);
+            }
+
+            SelfPlayGameStats stats;
+            stats.game = game;
+            stats.plies = history.plies();
+            stats.winner = winner;
+            stats.positions = (int)records.size();
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            if (ok && fwrite(bytes.data(), 1, bytes.size(), out) != bytes.size()) ok = false;
+            if (onGame) onGame(stats);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++) threads.emplace_back(worker);
+    for (std::thread& thread : threads) thread.join();
+
+    if (fclose(out) != 0) ok = false;
+    if (!ok) {
+        error = "short write to " + config.path;
+        return false;
+    }
+    return true;
+}
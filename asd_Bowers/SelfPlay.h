@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "GameBoard.h"
+#include "Nnue.h"
+#include "PositionHistory.h"
+
+struct SelfPlayConfig {
+    int games;
+    int depth;                  // search depth per move
+    int randomPlies;            // random moves opening each game, for variety
+    int threads;                // 0 = one per core
+    uint64_t seed;
+    DrawRules drawRules;
+    std::string path;
+
+    SelfPlayConfig() : games(100), depth(4), randomPlies(6), threads(0), seed(1), drawRules(3, 200),
+        path("selfplay.bwtd") {}
+};
+
+struct SelfPlayGameStats {
+    int game;
+    int plies;
+    Player winner;              // NONE for a draw
+    int positions;              // records written
+};
+
+typedef std::function<void(const SelfPlayGameStats&)> SelfPlayCallback;
+
+// Plays engine-vs-engine games and writes every searched position as a
+// training record for the evaluation network.
+//
+// File, little endian: "BWTD0001", uint32 rows, cols, uint64 topology key,
+// then 40-byte records: uint64 units of player 1, units of player 2, kill
+// nodes of player 1, of player 2, uint8 killed 1, killed 2, side to move,
+// int8 game result for the side to move (1, 0, -1), int16 search score for
+// the side to move, uint16 ply.
+class SelfPlay {
+public:
+    SelfPlay(const BoardTopology& topology, const SelfPlayConfig& config);
+
+    // Searches with network instead of the handcrafted evaluation if set
+    void setNetwork(const NnueNetwork* net) { network = net; }
+
+    bool run(const SelfPlayCallback& onGame, std::string& error);
+
+private:
+    const BoardTopology& topology;
+    SelfPlayConfig config;
+    const NnueNetwork* network;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BOWERS_X86 1
+#endif
+
+// MSVC emits any intrinsic regardless of /arch, GCC and Clang need the
+// target attribute on functions that use instructions above the baseline.
+#if defined(BOWERS_X86) && !defined(_MSC_VER)
+#define BOWERS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BOWERS_TARGET_AVX2
+#endif
+
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_SSE2 = 1, SIMD_AVX2 = 2 };
+
+// Best instruction set supported by both the CPU and the OS, detected once.
+SimdLevel getSimdLevel();
+const char* simdLevelName(SimdLevel level);
@@ -0,0 +1,244 @@
+#include "Spectator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const float TILE_MARGIN = 0.04f;            // of the tile size, around the board
+    const float FRAME_WIDTH = 0.025f;           // result frame of a finished game
+
+    const SDL_Color BACKGROUND_COLOR = { 240, 230, 210, 255 };
+    const SDL_Color TILE_COLOR = { 250, 243, 228, 255 };
+    const SDL_Color RESULT_COLOR[3] = { { 120, 120, 120, 255 }, { 50, 100, 255, 255 }, { 255, 50, 50, 255 } };
+}
+
+SpectatorGames::SpectatorGames(const BoardTopology& topology, const SpectatorConfig& config) :
+    topology(topology), config(config), drawRules(3, 200), totals(), service(config.workers) {
+    Clock::time_point now = Clock::now();
+
+    games.resize(std::max(1, config.games));
+    for (size_t i = 0; i < games.size(); i++) {
+        Slot& slot = games[i];
+        slot.version = 0;
+        slot.searching = false;
+        slot.rng.seed((unsigned)(i * 7919 + 1));
+        restart(slot, now);
+    }
+}
+
+void SpectatorGames::restart(Slot& slot, Clock::time_point now) {
+    slot.board = GameBoard(topology);
+    slot.history.clear();
+    slot.history.push(slot.board.getHash());
+    slot.winner = NONE;
+    slot.draw = DRAW_NONE;
+    slot.due = now + std::chrono::milliseconds(config.moveIntervalMs);
+    slot.version++;
+}
+
+void SpectatorGames::play(Slot& slot, const Move& move, Clock::time_point now) {
+    slot.board.makeMove(move);
+    slot.board.switchPlayer();
+    totals.moves++;
+    endTurn(slot, now);
+}
+
+// After a move or a pass: records the position and settles a finished game
+void SpectatorGames::endTurn(Slot& slot, Clock::time_point now) {
+    slot.history.push(slot.board.getHash());
+    slot.version++;
+
+    slot.winner = slot.board.getWinner();
+    slot.draw = (slot.winner == NONE) ? slot.history.checkDraw(drawRules) : DRAW_NONE;
+    if (slot.winner != NONE || slot.draw != DRAW_NONE) {
+        totals.finished++;
+        totals.wins[slot.winner]++;
+        slot.due = now + std::chrono::milliseconds(config.restartMs);
+    }
+    else {
+        slot.due = now + std::chrono::milliseconds(config.moveIntervalMs);
+    }
+}
+
+void SpectatorGames::update() {
+    std::vector<std::pair<int, SearchRequest>> requests;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+
+        for (int i = 0; i < (int)games.size(); i++) {
+            Slot& slot = games[i];
+            if (slot.searching || now < slot.due) continue;
+
+            if (slot.winner != NONE || slot.draw != DRAW_NONE) {
+                restart(slot, now);
+                continue;
+            }
+
+            // A side without moves passes
+            std::vector<Move> moves = slot.board.getLegalMovesOrPass();
+            if (moves.front().isPass || slot.history.plies() < config.randomPlies) {
+                play(slot, moves[slot.rng() % moves.size()], now);
+                continue;
+            }
+
+            SearchRequest request;
+            request.board = slot.board;
+            request.history = slot.history;
+            request.drawRules = drawRules;
+            request.limits.depth = config.depth;
+            request.limits.moveTimeMs = config.moveTimeMs;
+            request.owner = (uint64_t)i + 1;
+            slot.searching = true;
+            requests.emplace_back(i, std::move(request));
+        }
+    }
+
+    // Outside the lock: a rejected job calls back from inside submit
+    for (auto& entry : requests) {
+        int index = entry.first;
+        service.submit(std::move(entry.second), [this, index](const SearchOutcome& outcome) {
+            onSearchDone(index, outcome);
+        });
+    }
+}
+
+void SpectatorGames::onSearchDone(int index, const SearchOutcome& outcome) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot& slot = games[index];
+    slot.searching = false;
+
+    Clock::time_point now = Clock::now();
+    if ((outcome.status == SEARCH_DONE || outcome.status == SEARCH_PREEMPTED) && outcome.depth > 0) {
+        play(slot, outcome.bestMove, now);
+    }
+    else {
+        slot.due = now + std::chrono::milliseconds(config.moveIntervalMs);
+    }
+}
+
+bool SpectatorGames::snapshot(int index, uint64_t& version, GameBoard& board, Player& winner, DrawReason& draw) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Slot& slot = games[index];
+    if (slot.version == version) return false;
+
+    version = slot.version;
+    board = slot.board;
+    winner = slot.winner;
+    draw = slot.draw;
+    return true;
+}
+
+SpectatorTotals SpectatorGames::getTotals() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totals;
+}
+
+SpectatorView::SpectatorView(SpectatorGames& games, const BoardTopology& topology) : games(games),
+boards(topology), canvas(nullptr), canvasFailed(false), area{ 0, 0, 0, 0 }, columns(1), tileSize(0.0f),
+versions(games.size(), 0), snapshots(games.size(), GameBoard(topology)), winners(games.size(), NONE),
+draws(games.size(), DRAW_NONE), allDirty(true), lastDirty(0) {}
+
+SpectatorView::~SpectatorView() {
+    if (canvas) SDL_DestroyTexture(canvas);
+}
+
+void SpectatorView::setArea(const SDL_Rect& newArea) {
+    if (newArea.w != area.w || newArea.h != area.h) invalidate();
+    area = newArea;
+    allDirty = true;
+
+    // Columns giving the largest square tiles
+    int count = games.size();
+    tileSize = 0.0f;
+    for (int c = 1; c <= count; c++) {
+        int rows = (count + c - 1) / c;
+        float size = std::floor(std::min((float)area.w / c, (float)area.h / rows));
+        if (size > tileSize) {
+            tileSize = size;
+            columns = c;
+        }
+    }
+}
+
+void SpectatorView::invalidate() {
+    if (canvas) SDL_DestroyTexture(canvas);
+    canvas = nullptr;
+    canvasFailed = false;
+    allDirty = true;
+}
+
+SDL_FRect SpectatorView::tileRect(int index) const {
+    int rows = (games.size() + columns - 1) / columns;
+
+    // Grid centred in the area
+    float left = std::floor((area.w - tileSize * columns) * 0.5f);
+    float top = std::floor((area.h - tileSize * rows) * 0.5f);
+    SDL_FRect rect = { left + (index % columns) * tileSize, top + (index / columns) * tileSize, tileSize, tileSize };
+    return rect;
+}
+
+void SpectatorView::drawTile(int index, float dx, float dy) {
+    SDL_FRect tile = tileRect(index);
+    tile.x += dx;
+    tile.y += dy;
+
+    bool finished = winners[index] != NONE || draws[index] != DRAW_NONE;
+    if (finished) {
+        float frame = std::max(1.0f, std::floor(tileSize * FRAME_WIDTH));
+        boards.addRect(tile, RESULT_COLOR[winners[index]]);
+        SDL_FRect inner = { tile.x + frame, tile.y + frame, tile.w - 2 * frame, tile.h - 2 * frame };
+        boards.addRect(inner, TILE_COLOR);
+    }
+    else {
+        boards.addRect(tile, TILE_COLOR);
+    }
+
+    float margin = tileSize * TILE_MARGIN;
+    SDL_FRect board = { tile.x + margin, tile.y + margin, tile.w - 2 * margin, tile.h - 2 * margin };
+    boards.addBoard(board, snapshots[index]);
+}
+
+void SpectatorView::render(SDL_Renderer* renderer) {
+    if (area.w <= 0 || area.h <= 0) return;
+
+    int count = games.size();
+    std::vector<int> dirty;
+    for (int i = 0; i < count; i++) {
+        if (games.snapshot(i, versions[i], snapshots[i], winners[i], draws[i]) || allDirty) dirty.push_back(i);
+    }
+
+    if (!canvas && !canvasFailed) {
+        canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, area.w, area.h);
+        if (canvas) {
+            SDL_SetTextureBlendMode(canvas, SDL_BLENDMODE_NONE);
+        }
+        else {
+            canvasFailed = true;
+        }
+        allDirty = true;
+    }
+
+    SDL_FRect whole = { 0.0f, 0.0f, (float)area.w, (float)area.h };
+    if (canvas && SDL_SetRenderTarget(renderer, canvas) == 0) {
+        if (allDirty) {
+            boards.addRect(whole, BACKGROUND_COLOR);
+            dirty.clear();
+            for (int i = 0; i < count; i++) dirty.push_back(i);
+        }
+        for (int i : dirty) drawTile(i, 0.0f, 0.0f);
+        boards.flush(renderer);
+        SDL_SetRenderTarget(renderer, nullptr);
+
+        SDL_RenderCopy(renderer, canvas, nullptr, &area);
+        lastDirty = (int)dirty.size();
+    }
+    else {
+        whole.x = (float)area.x;
+        whole.y = (float)area.y;
+        boards.addRect(whole, BACKGROUND_COLOR);
+        for (int i = 0; i < count; i++) drawTile(i, (float)area.x, (float)area.y);
+        boards.flush(renderer);
+        lastDirty = count;
+    }
+    allDirty = false;
+}
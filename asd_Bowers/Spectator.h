@@ -0,0 +1,114 @@
+#pragma once
+#include <SDL.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "BoardRenderer.h"
+#include "SearchService.h"
+
+struct SpectatorConfig {
+    int games;
+    int depth;                  // search depth per move
+    int64_t moveTimeMs;         // search time cap per move
+    int64_t moveIntervalMs;     // least time between two moves of one game
+    int64_t restartMs;          // finished games stay up this long
+    int randomPlies;            // random opening moves, so the games differ
+    int workers;                // search threads, 0 = one per core
+
+    SpectatorConfig() : games(16), depth(4), moveTimeMs(250), moveIntervalMs(400), restartMs(3000),
+        randomPlies(4), workers(0) {}
+};
+
+struct SpectatorTotals {
+    uint64_t finished;
+    uint64_t wins[3];           // [NONE] counts draws
+    uint64_t moves;
+};
+
+// AI-vs-AI games played in the background. Searches run on a
+// SearchService with one owner per game, so every game gets its turn
+// however many there are. Each game carries a version that changes with
+// every move, letting a view redraw only the games that moved.
+class SpectatorGames {
+public:
+    SpectatorGames(const BoardTopology& topology, const SpectatorConfig& config);
+
+    // Starts the moves that are due and restarts finished games; call once a frame
+    void update();
+
+    int size() const { return (int)games.size(); }
+
+    // Copies game index if its version differs from version, updating it
+    bool snapshot(int index, uint64_t& version, GameBoard& board, Player& winner, DrawReason& draw) const;
+    SpectatorTotals getTotals() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Slot {
+        GameBoard board;
+        PositionHistory history;
+        uint64_t version;
+        bool searching;
+        Player winner;
+        DrawReason draw;
+        Clock::time_point due;      // next move, or the restart of a finished game
+        std::mt19937 rng;
+    };
+
+    const BoardTopology& topology;
+    SpectatorConfig config;
+    DrawRules drawRules;
+
+    mutable std::mutex mutex;
+    std::vector<Slot> games;
+    SpectatorTotals totals;
+
+    // Last, so it is destroyed first and no callback outlives the games
+    SearchService service;
+
+    void restart(Slot& slot, Clock::time_point now);
+    void play(Slot& slot, const Move& move, Clock::time_point now);
+    void endTurn(Slot& slot, Clock::time_point now);
+    void onSearchDone(int index, const SearchOutcome& outcome);
+};
+
+// Grid of live boards. The tiles are drawn into a texture that persists
+// between frames; a frame only redraws the tiles whose game moved, then
+// copies the texture to the screen. Without render target support every
+// tile is drawn every frame.
+class SpectatorView {
+public:
+    SpectatorView(SpectatorGames& games, const BoardTopology& topology);
+    ~SpectatorView();
+
+    // Lays the tiles out over area (in output pixels); marks every tile dirty
+    void setArea(const SDL_Rect& area);
+    // Call when the renderer reset its render targets or textures
+    void invalidate();
+
+    void render(SDL_Renderer* renderer);
+
+    int getDirtyTiles() const { return lastDirty; }
+
+private:
+    SpectatorGames& games;
+    BoardRenderer boards;
+    SDL_Texture* canvas;
+    bool canvasFailed;
+    SDL_Rect area;
+    int columns;
+    float tileSize;
+
+    std::vector<uint64_t> versions;
+    std::vector<GameBoard> snapshots;
+    std::vector<Player> winners;
+    std::vector<DrawReason> draws;
+    bool allDirty;
+    int lastDirty;
+
+    SDL_FRect tileRect(int index) const;
+    void drawTile(int index, float dx, float dy);
+};
@@ -0,0 +1,469 @@
+#include "StateSpace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+namespace {
+    const char KEY_RUN_MAGIC[8] = { 'B', 'W', 'K', 'E', 'Y', 'S', '0', '1' };
+    const size_t MIN_SLOTS = (size_t)1 << 22;
+    const size_t READ_BUFFER = 4096;
+    const size_t CHUNK_RECORDS = 256;
+    const size_t MAX_RUNS = 8;
+
+    int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Frontier record: uint64 units of player 1 and 2, uint8 side to move,
+    // killed 1, killed 2, history entry count, then (node, from, count) per
+    // three-move entry. Kill records are left out: they only matter for
+    // revivals, which cannot happen.
+    void packBoard(const GameBoard& board, std::vector<unsigned char>& out) {
+        uint64_t pieces[2] = { board.getPieces(PLAYER1), board.getPieces(PLAYER2) };
+        size_t start = out.size();
+        out.resize(start + 20);
+        memcpy(&out[start], pieces, 16);
+        out[start + 16] = (unsigned char)board.getCurrentPlayer();
+        out[start + 17] = (unsigned char)board.getKilledUnits(PLAYER1);
+        out[start + 18] = (unsigned char)board.getKilledUnits(PLAYER2);
+
+        unsigned char entries = 0;
+        for (int node = 0; node < board.getTopology().nodeCount(); node++) {
+            if (board.getHistoryFrom(node) < 0) continue;
+            out.push_back((unsigned char)node);
+            out.push_back((unsigned char)board.getHistoryFrom(node));
+            out.push_back((unsigned char)board.getHistoryCount(node));
+            entries++;
+        }
+        out[start + 19] = entries;
+    }
+
+    const unsigned char* unpackBoard(const unsigned char* p, GameBoard& board) {
+        uint64_t pieces[2];
+        memcpy(pieces, p, 16);
+        board.setup(pieces[0], pieces[1], (Player)p[16], p[17], p[18]);
+
+        int entries = p[19];
+        p += 20;
+        for (int i = 0; i < entries; i++, p += 3) {
+            board.setHistory(p[0], p[1], p[2]);
+        }
+        return p;
+    }
+
+    const unsigned char* skipBoard(const unsigned char* p) {
+        return p + 20 + 3 * (size_t)p[19];
+    }
+}
+
+ConcurrentKeySet::ConcurrentKeySet(size_t memoryBytes) : count(0) {
+    size_t wanted = std::max(MIN_SLOTS, memoryBytes / sizeof(uint64_t));
+    size_t size = MIN_SLOTS;
+    while (size * 2 <= wanted) size *= 2;
+
+    slots.assign(size, 0);
+    mask = size - 1;
+    limit = size / 4 * 3;
+}
+
+bool ConcurrentKeySet::insert(uint64_t key) {
+    if (key == 0) key = 1;
+
+    // Zobrist keys are uniform, so the low bits make a good slot index
+    for (uint64_t slot = key & mask;; slot = (slot + 1) & mask) {
+        std::atomic_ref<uint64_t> entry(slots[slot]);
+        uint64_t current = entry.load(std::memory_order_relaxed);
+        if (current == key) return false;
+        if (current != 0) continue;
+
+        if (entry.compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (current == key) return false;
+    }
+}
+
+size_t ConcurrentKeySet::sortKeys() {
+    size_t used = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (slots[i] != 0) slots[used++] = slots[i];
+    }
+    std::fill(slots.begin() + used, slots.end(), 0);
+    std::sort(slots.begin(), slots.begin() + used);
+    return used;
+}
+
+void ConcurrentKeySet::clear() {
+    std::fill(slots.begin(), slots.end(), 0);
+    count.store(0);
+}
+
+bool writeKeyRun(const std::string& path, const uint64_t* sorted, size_t count, std::string& error) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    uint64_t total = count;
+    bool ok = fwrite(KEY_RUN_MAGIC, 1, 8, file) == 8 && fwrite(&total, 8, 1, file) == 1 &&
+        fwrite(sorted, 8, count, file) == count;
+    if (fclose(file) != 0) ok = false;
+    if (!ok) error = "short write to " + path;
+    return ok;
+}
+
+KeyRunReader::KeyRunReader() : file(nullptr), remaining(0), position(0) {}
+
+KeyRunReader::~KeyRunReader() {
+    if (file) fclose(file);
+}
+
+bool KeyRunReader::open(const std::string& path) {
+    file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    char magic[8];
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, KEY_RUN_MAGIC, 8) != 0 ||
+        fread(&remaining, 8, 1, file) != 1) {
+        return false;
+    }
+    return true;
+}
+
+bool KeyRunReader::next(uint64_t& key) {
+    if (position == buffer.size()) {
+        if (remaining == 0) return false;
+        buffer.resize((size_t)std::min<uint64_t>(remaining, READ_BUFFER));
+        if (fread(buffer.data(), 8, buffer.size(), file) != buffer.size()) {
+            remaining = 0;
+            return false;
+        }
+        remaining -= buffer.size();
+        position = 0;
+    }
+    key = buffer[position++];
+    return true;
+}
+
+// One ply's positions, split into a part per thread. Each record also keeps
+// its key and the number of runs that existed when it was added: only keys
+// spilled before then can make it a repeat.
+struct StateEnumerator::Frontier {
+    struct Part {
+        std::vector<unsigned char> records;
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> epochs;
+    };
+
+    std::vector<Part> parts;
+
+    explicit Frontier(int count) : parts(count) {}
+
+    uint64_t size() const {
+        uint64_t total = 0;
+        for (const auto& part : parts) total += part.keys.size();
+        return total;
+    }
+
+    uint64_t memoryBytes() const {
+        uint64_t total = 0;
+        for (const auto& part : parts) {
+            total += part.records.capacity() + part.keys.capacity() * 8 + part.epochs.capacity() * 4;
+        }
+        return total;
+    }
+};
+
+StateEnumerator::StateEnumerator(const BoardTopology& rules, const EnumeratorConfig& enumeratorConfig) :
+    topology(rules), config(enumeratorConfig), runSerial(0), peakBytes(0) {
+    threadCount = (config.threads > 0) ? config.threads : std::max(1, (int)std::thread::hardware_concurrency());
+    maxUnits = std::max(countNodes(topology.startMask[PLAYER1]), countNodes(topology.startMask[PLAYER2]));
+    materialCounts.assign((size_t)(maxUnits + 1) * (maxUnits + 1), 0);
+}
+
+StateEnumerator::~StateEnumerator() {
+    removeRuns();
+}
+
+void StateEnumerator::removeRuns() {
+    for (const auto& run : runs) remove(run.c_str());
+    runs.clear();
+}
+
+bool StateEnumerator::spill(std::string& error) {
+    char name[32];
+    snprintf(name, sizeof(name), "keys-%04d.run", runSerial++);
+    std::string path = (std::filesystem::path(config.directory) / name).string();
+
+    size_t count = keys->sortKeys();
+    bool ok = writeKeyRun(path, keys->sortedKeys(), count, error);
+    keys->clear();
+    if (!ok) return false;
+
+    runs.push_back(path);
+    return true;
+}
+
+// Only between plies: merging loses which run a key came from
+bool StateEnumerator::compactRuns(std::string& error) {
+    if (runs.size() <= MAX_RUNS) return true;
+
+    char name[32];
+    snprintf(name, sizeof(name), "keys-%04d.run", runSerial++);
+    std::string path = (std::filesystem::path(config.directory) / name).string();
+
+    std::vector<std::unique_ptr<KeyRunReader>> readers;
+    std::vector<uint64_t> heads;
+    std::vector<bool> live;
+    for (const auto& run : runs) {
+        readers.emplace_back(new KeyRunReader());
+        uint64_t key = 0;
+        bool ok = readers.back()->open(run);
+        live.push_back(ok && readers.back()->next(key));
+        heads.push_back(key);
+        if (!ok) {
+            error = "cannot read " + run;
+            return false;
+        }
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    uint64_t written = 0;
+    bool ok = fwrite(KEY_RUN_MAGIC, 1, 8, file) == 8 && fwrite(&written, 8, 1, file) == 1;
+    std::vector<uint64_t> buffer;
+    uint64_t last = 0;
+
+    for (;;) {
+        int best = -1;
+        for (size_t i = 0; i < readers.size(); i++) {
+            if (live[i] && (best < 0 || heads[i] < heads[best])) best = (int)i;
+        }
+        if (best < 0) break;
+
+        uint64_t key = heads[best];
+        live[best] = readers[best]->next(heads[best]);
+        if (written > 0 && key == last) continue;   // the same position spilled twice
+
+        buffer.push_back(key);
+        last = key;
+        written++;
+        if (buffer.size() == READ_BUFFER) {
+            ok = ok && fwrite(buffer.data(), 8, buffer.size(), file) == buffer.size();
+            buffer.clear();
+        }
+    }
+    ok = ok && fwrite(buffer.data(), 8, buffer.size(), file) == buffer.size();
+    ok = ok && fseek(file, 8, SEEK_SET) == 0 && fwrite(&written, 8, 1, file) == 1;
+    if (fclose(file) != 0) ok = false;
+
+    if (!ok) {
+        error = "short write to " + path;
+        return false;
+    }
+
+    readers.clear();
+    removeRuns();
+    runs.push_back(path);
+    return true;
+}
+
+// Drops the records whose key is in a run written before they were added
+bool StateEnumerator::filterSeen(Frontier& next, std::string& error) {
+    struct Candidate {
+        uint64_t key;
+        uint32_t part;
+        uint32_t record;
+    };
+
+    std::vector<Candidate> candidates;
+    for (size_t p = 0; p < next.parts.size(); p++) {
+        const auto& part = next.parts[p];
+        for (size_t r = 0; r < part.keys.size(); r++) {
+            if (part.epochs[r] > 0) candidates.push_back({ part.keys[r], (uint32_t)p, (uint32_t)r });
+        }
+    }
+    if (candidates.empty()) return true;
+
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.key < b.key; });
+    peakBytes = std::max(peakBytes, keys->memoryBytes() + next.memoryBytes() + candidates.capacity() * sizeof(Candidate));
+
+    std::vector<std::vector<bool>> seen(next.parts.size());
+    for (size_t p = 0; p < next.parts.size(); p++) seen[p].assign(next.parts[p].keys.size(), false);
+
+    for (size_t run = 0; run < runs.size(); run++) {
+        KeyRunReader reader;
+        if (!reader.open(runs[run])) {
+            error = "cannot read " + runs[run];
+            return false;
+        }
+
+        uint64_t key;
+        bool more = reader.next(key);
+        for (const auto& candidate : candidates) {
+            while (more && key < candidate.key) more = reader.next(key);
+            if (!more) break;
+            if (key == candidate.key && next.parts[candidate.part].epochs[candidate.record] > run) {
+                seen[candidate.part][candidate.record] = true;
+            }
+        }
+    }
+
+    for (size_t p = 0; p < next.parts.size(); p++) {
+        auto& part = next.parts[p];
+        std::vector<unsigned char> records;
+        std::vector<uint64_t> partKeys;
+        std::vector<uint32_t> epochs;
+
+        const unsigned char* record = part.records.data();
+        for (size_t r = 0; r < part.keys.size(); r++) {
+            const unsigned char* end = skipBoard(record);
+            if (!seen[p][r]) {
+                records.insert(records.end(), record, end);
+                partKeys.push_back(part.keys[r]);
+                epochs.push_back(part.epochs[r]);
+            }
+            record = end;
+        }
+        part.records.swap(records);
+        part.keys.swap(partKeys);
+        part.epochs.swap(epochs);
+    }
+    return true;
+}
+
+void StateEnumerator::countFrontier(const Frontier& frontier, PlyStats& stats) {
+    GameBoard board(topology);
+    for (const auto& part : frontier.parts) {
+        const unsigned char* record = part.records.data();
+        for (size_t r = 0; r < part.keys.size(); r++) {
+            uint64_t pieces[2];
+            memcpy(pieces, record, 16);
+            int units1 = countNodes(pieces[0]), units2 = countNodes(pieces[1]);
+            if (units1 <= maxUnits && units2 <= maxUnits) materialCounts[units1 * (maxUnits + 1) + units2]++;
+
+            NodeMask goal1 = topology.goalMask[PLAYER1], goal2 = topology.goalMask[PLAYER2];
+            if ((pieces[0] & goal1) == goal1 || (pieces[1] & goal2) == goal2) stats.finished++;
+            record = skipBoard(record);
+        }
+    }
+    stats.unique = frontier.size();
+}
+
+bool StateEnumerator::run(const PlyStatsCallback& onPly, std::string& error) {
+    std::error_code code;
+    std::filesystem::create_directories(config.directory, code);
+    keys.reset(new ConcurrentKeySet(config.memoryMb * 1024 * 1024));
+
+    std::unique_ptr<Frontier> frontier(new Frontier(1));
+    GameBoard start(topology);
+    keys->insert(start.getHash());
+    frontier->parts[0].keys.push_back(start.getHash());
+    frontier->parts[0].epochs.push_back(0);
+    packBoard(start, frontier->parts[0].records);
+
+    PlyStats stats = PlyStats();
+    countFrontier(*frontier, stats);
+    stats.total = stats.unique;
+    stats.peakBytes = peakBytes = keys->memoryBytes() + frontier->memoryBytes();
+    if (onPly) onPly(stats);
+
+    for (int ply = 1; ply <= config.depth && frontier->size() > 0; ply++) {
+        int64_t startMs = nowMs();
+        if (!compactRuns(error)) return false;
+
+        // Work list: every CHUNK_RECORDS records of every part
+        struct Chunk {
+            const unsigned char* begin;
+            size_t records;
+        };
+        std::vector<Chunk> chunks;
+        for (const auto& part : frontier->parts) {
+            const unsigned char* record = part.records.data();
+            for (size_t r = 0; r < part.keys.size(); r += CHUNK_RECORDS) {
+                Chunk chunk = { record, std::min(CHUNK_RECORDS, part.keys.size() - r) };
+                for (size_t i = 0; i < chunk.records; i++) record = skipBoard(record);
+                chunks.push_back(chunk);
+            }
+        }
+
+        std::unique_ptr<Frontier> next(new Frontier(threadCount));
+        std::atomic<size_t> nextChunk(0);
+        std::atomic<uint64_t> generated(0);
+
+        auto worker = [&](int index) {
+            Frontier::Part& out = next->parts[index];
+            uint32_t epoch = (uint32_t)runs.size();
+            GameBoard board(topology);
+            std::vector<Move> moves;
+            uint64_t produced = 0;
+
+            while (!keys->isFull()) {
+                size_t claimed = nextChunk.fetch_add(1);
+                if (claimed >= chunks.size()) break;
+
+                const unsigned char* record = chunks[claimed].begin;
+                for (size_t i = 0; i < chunks[claimed].records; i++) {
+                    record = unpackBoard(record, board);
+                    if (board.isGameOver()) continue;
+
+                    // A side without moves passes
+                    board.getLegalMovesOrPass(moves);
+                    for (const auto& move : moves) {
+                        MoveUndo undo;
+                        board.makeMove(move, undo);
+                        board.switchPlayer();
+                        produced++;
+                        if (keys->insert(board.getHash())) {
+                            out.keys.push_back(board.getHash());
+                            out.epochs.push_back(epoch);
+                            packBoard(board, out.records);
+                        }
+                        board.switchPlayer();
+                        board.unmakeMove(move, undo);
+                    }
+                }
+            }
+            generated.fetch_add(produced);
+        };
+
+        // Runs until the frontier is done, spilling the key set whenever it fills
+        while (nextChunk.load() < chunks.size()) {
+            std::vector<std::thread> pool;
+            for (int i = 1; i < threadCount; i++) pool.emplace_back(worker, i);
+            worker(0);
+            for (auto& thread : pool) thread.join();
+
+            peakBytes = std::max(peakBytes, keys->memoryBytes() + frontier->memoryBytes() + next->memoryBytes());
+            if (keys->isFull() && !spill(error)) return false;
+        }
+
+        if (!runs.empty() && !filterSeen(*next, error)) return false;
+        frontier.swap(next);
+        next.reset();
+
+        uint64_t total = stats.total;
+        stats = PlyStats();
+        stats.ply = ply;
+        countFrontier(*frontier, stats);
+        stats.total = total + stats.unique;
+        stats.generated = generated.load();
+        stats.timeMs = nowMs() - startMs;
+        stats.peakBytes = peakBytes;
+        stats.runs = runs.size();
+        if (onPly) onPly(stats);
+    }
+
+    removeRuns();
+    return true;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GameBoard.h"
+
+// Lock-free open-addressing set of position keys (GameBoard::getHash).
+// Key 0 marks an empty slot, so a position hashing to 0 is stored as 1.
+// Inserts may run on any number of threads; everything else needs them
+// stopped.
+class ConcurrentKeySet {
+public:
+    explicit ConcurrentKeySet(size_t memoryBytes);
+
+    // True if the key was not in the set yet
+    bool insert(uint64_t key);
+
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+    size_t capacity() const { return slots.size(); }
+    size_t memoryBytes() const { return slots.size() * sizeof(uint64_t); }
+    // Past the load where probing slows down; time to spill
+    bool isFull() const { return size() >= limit; }
+
+    // Packs the keys ascending at the front of the slots and returns how
+    // many there are; no inserts until clear()
+    size_t sortKeys();
+    const uint64_t* sortedKeys() const { return slots.data(); }
+    void clear();
+
+private:
+    std::vector<uint64_t> slots;    // accessed through std::atomic_ref
+    uint64_t mask;
+    size_t limit;
+    std::atomic<size_t> count;
+};
+
+// Sorted key file: "BWKEYS01", uint64 count, then the keys ascending
+bool writeKeyRun(const std::string& path, const uint64_t* sorted, size_t count, std::string& error);
+
+// Streams a key run in order
+class KeyRunReader {
+public:
+    KeyRunReader();
+    ~KeyRunReader();
+
+    bool open(const std::string& path);
+    bool next(uint64_t& key);
+
+private:
+    FILE* file;
+    uint64_t remaining;
+    std::vector<uint64_t> buffer;
+    size_t position;
+
+    KeyRunReader(const KeyRunReader&) = delete;
+    KeyRunReader& operator=(const KeyRunReader&) = delete;
+};
+
+struct EnumeratorConfig {
+    int depth;                  // last ply to enumerate
+    int threads;                // 0 = one per core
+    size_t memoryMb;            // key set; keys beyond it spill to runs
+    std::string directory;      // for the runs
+
+    EnumeratorConfig() : depth(8), threads(0), memoryMb(1024), directory("statespace") {}
+};
+
+struct PlyStats {
+    int ply;
+    uint64_t unique;            // positions first reached at this ply
+    uint64_t total;             // unique positions up to and including this ply
+    uint64_t finished;          // of unique, games already won
+    uint64_t generated;         // successors produced while expanding the previous ply
+    int64_t timeMs;             // for this ply
+    uint64_t peakBytes;         // key set + frontiers + bookkeeping, so far
+    size_t runs;                // key runs on disk after this ply
+};
+
+typedef std::function<void(const PlyStats&)> PlyStatsCallback;
+
+// Breadth-first enumeration of the positions reachable from the start, one
+// ply at a time. A position is its full rule state as GameBoard::getHash
+// sees it (units, side to move, killed counts, three-move history), so the
+// counts are exact up to 64-bit key collisions.
+//
+// Each ply's frontier is kept in memory as packed records. Successors are
+// deduplicated through a ConcurrentKeySet; when it fills up its keys go to
+// a sorted run on disk and it starts over, and at the end of the ply the
+// successors that might have been seen before the spill are checked
+// against the runs in one merge pass.
+class StateEnumerator {
+public:
+    StateEnumerator(const BoardTopology& topology, const EnumeratorConfig& config);
+    ~StateEnumerator();
+
+    bool run(const PlyStatsCallback& onPly, std::string& error);
+
+    // Unique positions over all plies, by units left: [units1 * (maxUnits + 1) + units2]
+    const std::vector<uint64_t>& getMaterialCounts() const { return materialCounts; }
+    int getMaxUnits() const { return maxUnits; }
+
+private:
+    struct Frontier;
+
+    const BoardTopology& topology;
+    EnumeratorConfig config;
+    int threadCount;
+    int maxUnits;
+    std::unique_ptr<ConcurrentKeySet> keys;
+    std::vector<std::string> runs;
+    int runSerial;
+    std::vector<uint64_t> materialCounts;
+    uint64_t peakBytes;
+
+    bool spill(std::string& error);
+    bool compactRuns(std::string& error);
+    bool filterSeen(Frontier& next, std::string& error);
+    void countFrontier(const Frontier& frontier, PlyStats& stats);
+    void removeRuns();
+};
@@ -0,0 +1,470 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char TABLE_MAGIC[8] = { 'B', 'W', 'T', 'B', '0', '0', '0', '1' };
+    const size_t HEADER_BYTES = 48;
+    const uint32_t BLOCK_VALUES = 4096;
+    const unsigned char BLOCK_RUNS = 0;
+    const unsigned char BLOCK_PACKED = 1;
+
+    // binomial(n, k) for n, k <= MAX_BOARD_NODES
+    struct BinomialTable {
+        uint64_t value[MAX_BOARD_NODES + 1][MAX_BOARD_NODES + 1];
+
+        BinomialTable() {
+            for (int n = 0; n <= MAX_BOARD_NODES; n++) {
+                value[n][0] = 1;
+                for (int k = 1; k <= MAX_BOARD_NODES; k++) {
+                    value[n][k] = (n == 0) ? 0 : value[n - 1][k - 1] + value[n - 1][k];
+                }
+            }
+        }
+    };
+
+    const BinomialTable binomials;
+
+    uint64_t binomial(int n, int k) {
+        return (n < 0 || k < 0) ? 0 : binomials.value[n][k];
+    }
+
+    // Colex rank of the set bits of mask among the first n bits
+    uint64_t rankSet(NodeMask mask) {
+        uint64_t rank = 0;
+        int i = 1;
+        for (; mask; mask &= mask - 1, i++) {
+            rank += binomial(lowestNode(mask), i);
+        }
+        return rank;
+    }
+
+    NodeMask unrankSet(uint64_t rank, int count, int n) {
+        NodeMask mask = 0;
+        int c = n - 1;
+        for (int i = count; i >= 1; i--) {
+            while (binomial(c, i) > rank) c--;
+            mask |= nodeBit(c);
+            rank -= binomial(c, i);
+            c--;
+        }
+        return mask;
+    }
+
+    // Packs the bits of mask that lie outside holes together
+    NodeMask compress(NodeMask mask, NodeMask holes) {
+        NodeMask packed = 0;
+        int bit = 0;
+        for (int node = 0; node < MAX_BOARD_NODES && mask; node++) {
+            if (holes & nodeBit(node)) continue;
+            if (mask & nodeBit(node)) {
+                packed |= nodeBit(bit);
+                mask &= ~nodeBit(node);
+            }
+            bit++;
+        }
+        return packed;
+    }
+
+    NodeMask expand(NodeMask packed, NodeMask holes) {
+        NodeMask mask = 0;
+        int bit = 0;
+        for (int node = 0; node < MAX_BOARD_NODES && packed; node++) {
+            if (holes & nodeBit(node)) continue;
+            if (packed & nodeBit(bit)) {
+                mask |= nodeBit(node);
+                packed &= ~nodeBit(bit);
+            }
+            bit++;
+        }
+        return mask;
+    }
+
+    void putVarint(std::vector<unsigned char>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((unsigned char)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((unsigned char)value);
+    }
+
+    uint64_t getVarint(const unsigned char*& p) {
+        uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            unsigned char byte = *p++;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    uint64_t zigzag(TablebaseValue value) {
+        int wide = value;
+        return (uint64_t)(uint32_t)((wide << 1) ^ (wide >> 31));
+    }
+
+    TablebaseValue unzigzag(uint64_t value) {
+        return (TablebaseValue)((int64_t)(value >> 1) ^ -(int64_t)(value & 1));
+    }
+
+    uint32_t readU32(const unsigned char* p) {
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return value;
+    }
+
+    uint64_t readU64(const unsigned char* p) {
+        uint64_t value;
+        memcpy(&value, p, 8);
+        return value;
+    }
+}
+
+TablebaseIndexer::TablebaseIndexer() : nodes(0), player2Count(0), total(0) {
+    units[0] = units[1] = units[2] = 0;
+}
+
+TablebaseIndexer::TablebaseIndexer(int nodeCount, int units1, int units2) : nodes(nodeCount) {
+    units[0] = 0;
+    units[PLAYER1] = units1;
+    units[PLAYER2] = units2;
+    player2Count = binomial(nodeCount - units1, units2);
+    total = binomial(nodeCount, units1) * player2Count * 2;
+}
+
+uint64_t TablebaseIndexer::index(NodeMask player1, NodeMask player2, Player toMove) const {
+    uint64_t placement = rankSet(player1) * player2Count + rankSet(compress(player2, player1));
+    return placement * 2 + (toMove == PLAYER2 ? 1 : 0);
+}
+
+void TablebaseIndexer::position(uint64_t index, NodeMask& player1, NodeMask& player2, Player& toMove) const {
+    toMove = (index & 1) ? PLAYER2 : PLAYER1;
+    uint64_t placement = index / 2;
+    player1 = unrankSet(placement / player2Count, units[PLAYER1], nodes);
+    player2 = expand(unrankSet(placement % player2Count, units[PLAYER2], nodes - units[PLAYER1]), player1);
+}
+
+MappedFile::MappedFile() : file(nullptr), mapping(nullptr), descriptor(-1), base(nullptr), length(0) {}
+
+MappedFile::~MappedFile() {
+#if defined(_WIN32)
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle((HANDLE)mapping);
+    if (file) CloseHandle((HANDLE)file);
+#else
+    if (base) munmap((void*)base, (size_t)length);
+    if (descriptor >= 0) close(descriptor);
+#endif
+}
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        error = "cannot open " + path;
+        return false;
+    }
+    file = handle;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        error = "cannot map " + path;
+        return false;
+    }
+    length = (uint64_t)fileSize.QuadPart;
+
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) base = (const unsigned char*)MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        error = "cannot map " + path;
+        return false;
+    }
+    length = (uint64_t)info.st_size;
+
+    void* view = mmap(nullptr, (size_t)length, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (view != MAP_FAILED) base = (const unsigned char*)view;
+#endif
+    if (!base) {
+        error = "cannot map " + path;
+        return false;
+    }
+    return true;
+}
+
+Tablebase::Tablebase() : blockSize(0), blockCount(0), offsets(nullptr), blocks(nullptr) {}
+
+std::string Tablebase::fileName(int units1, int units2) {
+    return "tb_" + std::to_string(units1) + "v" + std::to_string(units2) + ".bwtb";
+}
+
+bool Tablebase::write(const std::string& path, const BoardTopology& topology, int units1, int units2,
+    const std::vector<TablebaseValue>& values, std::string& error) {
+    std::vector<unsigned char> data;
+    std::vector<uint64_t> blockOffsets;
+    std::vector<unsigned char> runs, packed;
+    std::vector<TablebaseValue> dictionary;
+
+    for (size_t start = 0; start < values.size(); start += BLOCK_VALUES) {
+        blockOffsets.push_back(data.size());
+        size_t end = std::min(values.size(), start + (size_t)BLOCK_VALUES);
+
+        runs.assign(1, BLOCK_RUNS);
+        for (size_t i = start; i < end;) {
+            size_t run = 1;
+            while (i + run < end && values[i + run] == values[i]) run++;
+            putVarint(runs, run);
+            putVarint(runs, zigzag(values[i]));
+            i += run;
+        }
+
+        dictionary.assign(values.begin() + start, values.begin() + end);
+        std::sort(dictionary.begin(), dictionary.end());
+        dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+
+        int bits = 0;
+        while (((size_t)1 << bits) < dictionary.size()) bits++;
+        packed.assign(1, BLOCK_PACKED);
+        packed.push_back((unsigned char)bits);
+        putVarint(packed, dictionary.size());
+        for (TablebaseValue value : dictionary) putVarint(packed, zigzag(value));
+
+        size_t codes = packed.size();
+        packed.resize(codes + ((end - start) * bits + 7) / 8, 0);
+        for (size_t i = start; i < end && bits > 0; i++) {
+            size_t code = std::lower_bound(dictionary.begin(), dictionary.end(), values[i]) - dictionary.begin();
+            size_t bit = (i - start) * bits;
+            for (int b = 0; b < bits; b++, bit++) {
+                if (code & ((size_t)1 << b)) packed[codes + bit / 8] |= (unsigned char)(1 << (bit % 8));
+            }
+        }
+
+        const std::vector<unsigned char>& smaller = (packed.size() < runs.size()) ? packed : runs;
+        data.insert(data.end(), smaller.begin(), smaller.end());
+    }
+    blockOffsets.push_back(data.size());
+
+    std::string temp = path + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (!out) {
+        error = "cannot write " + temp;
+        return false;
+    }
+
+    uint32_t header32[4] = { (uint32_t)topology.rows, (uint32_t)topology.cols, (uint32_t)units1, (uint32_t)units2 };
+    uint64_t key = topologyKey(topology);
+    uint64_t count = values.size();
+    uint32_t block[2] = { BLOCK_VALUES, (uint32_t)(blockOffsets.size() - 1) };
+
+    bool ok = fwrite(TABLE_MAGIC, 1, 8, out) == 8 &&
+        fwrite(header32, 4, 4, out) == 4 &&
+        fwrite(&key, 8, 1, out) == 1 &&
+        fwrite(&count, 8, 1, out) == 1 &&
+        fwrite(block, 4, 2, out) == 2 &&
+        fwrite(blockOffsets.data(), 8, blockOffsets.size(), out) == blockOffsets.size() &&
+        fwrite(data.data(), 1, data.size(), out) == data.size();
+    if (fclose(out) != 0) ok = false;
+
+    if (!ok) {
+        error = "short write to " + temp;
+        return false;
+    }
+
+    remove(path.c_str());
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        error = "cannot replace " + path;
+        return false;
+    }
+    return true;
+}
+
+bool Tablebase::open(const std::string& path, const BoardTopology& topology, std::string& error) {
+    if (!file.open(path, error)) return false;
+
+    const unsigned char* p = file.data();
+    if (file.size() < HEADER_BYTES || memcmp(p, TABLE_MAGIC, 8) != 0) {
+        error = path + " is not a tablebase";
+        return false;
+    }
+
+    int rows = (int)readU32(p + 8), cols = (int)readU32(p + 12);
+    int units1 = (int)readU32(p + 16), units2 = (int)readU32(p + 20);
+    if (rows != topology.rows || cols != topology.cols || readU64(p + 24) != topologyKey(topology)) {
+        error = path + " was built for another board";
+        return false;
+    }
+
+    indexer = TablebaseIndexer(topology.nodeCount(), units1, units2);
+    blockSize = readU32(p + 40);
+    blockCount = readU32(p + 44);
+
+    uint64_t dataStart = HEADER_BYTES + ((uint64_t)blockCount + 1) * 8;
+    if (readU64(p + 32) != indexer.size() || blockSize == 0 || dataStart > file.size() ||
+        (uint64_t)blockCount != (indexer.size() + blockSize - 1) / blockSize) {
+        error = path + " is damaged";
+        return false;
+    }
+
+    offsets = p + HEADER_BYTES;
+    blocks = p + dataStart;
+    if (dataStart + readU64(offsets + (uint64_t)blockCount * 8) != file.size()) {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
+
+TablebaseValue Tablebase::value(uint64_t index) const {
+    uint64_t block = index / blockSize;
+    uint64_t skip = index % blockSize;
+
+    const unsigned char* p = blocks + readU64(offsets + block * 8);
+    if (*p++ == BLOCK_PACKED) {
+        int bits = *p++;
+        uint64_t size = getVarint(p);
+        uint64_t code = 0;
+        if (bits > 0) {
+            // codes start after the dictionary
+            const unsigned char* entry = p;
+            for (uint64_t i = 0; i < size; i++) getVarint(entry);
+            uint64_t bit = skip * bits;
+            for (int b = 0; b < bits; b++, bit++) {
+                code |= (uint64_t)((entry[bit / 8] >> (bit % 8)) & 1) << b;
+            }
+        }
+        for (uint64_t i = 0; i < code; i++) getVarint(p);
+        return unzigzag(getVarint(p));
+    }
+
+    for (;;) {
+        uint64_t run = getVarint(p);
+        uint64_t value = getVarint(p);
+        if (skip < run) return unzigzag(value);
+        skip -= run;
+    }
+}
+
+// FNV-1a over everything that decides the rules of a position
+uint64_t topologyKey(const BoardTopology& topology) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001B3ULL;
+        }
+    };
+
+    mix((uint64_t)topology.rows);
+    mix((uint64_t)topology.cols);
+    mix((uint64_t)topology.startRow[PLAYER1]);
+    mix((uint64_t)topology.startRow[PLAYER2]);
+    for (int node = 0; node < topology.nodeCount(); node++) {
+        mix(topology.adjacencyMask[node]);
+    }
+    return hash;
+}
+
+TablebaseSet::TablebaseSet() : topology(nullptr), maxUnits(0) {
+    goalWidth[0] = goalWidth[1] = goalWidth[2] = 0;
+}
+
+bool TablebaseSet::load(const std::string& directory, const BoardTopology& boardTopology, std::string& error) {
+    topology = nullptr;
+    maxUnits = std::max(countNodes(boardTopology.startMask[PLAYER1]), countNodes(boardTopology.startMask[PLAYER2]));
+    goalWidth[PLAYER1] = countNodes(boardTopology.goalMask[PLAYER1]);
+    goalWidth[PLAYER2] = countNodes(boardTopology.goalMask[PLAYER2]);
+    tables.clear();
+    tables.resize((size_t)(maxUnits + 1) * (maxUnits + 1));
+
+    std::error_code code;
+    if (!std::filesystem::is_directory(directory, code)) {
+        error = "no tablebase directory " + directory;
+        return false;
+    }
+
+    for (int units1 = 0; units1 <= maxUnits; units1++) {
+        for (int units2 = 0; units2 <= maxUnits; units2++) {
+            std::string path = (std::filesystem::path(directory) / Tablebase::fileName(units1, units2)).string();
+            if (!std::filesystem::exists(path, code)) continue;
+
+            std::unique_ptr<Tablebase> table(new Tablebase());
+            if (!table->open(path, boardTopology, error)) return false;
+            tables[units1 * (maxUnits + 1) + units2] = std::move(table);
+        }
+    }
+
+    topology = &boardTopology;
+    return true;
+}
+
+size_t TablebaseSet::getTableCount() const {
+    size_t count = 0;
+    for (const auto& table : tables) {
+        if (table) count++;
+    }
+    return count;
+}
+
+bool TablebaseSet::lookup(NodeMask player1, NodeMask player2, Player toMove, TablebaseValue& value) const {
+    if (!topology) return false;
+
+    int units1 = countNodes(player1), units2 = countNodes(player2);
+    if (units1 < goalWidth[PLAYER1] && units2 < goalWidth[PLAYER2]) {
+        value = 0;
+        return true;
+    }
+    if (units1 > maxUnits || units2 > maxUnits) return false;
+
+    const Tablebase* table = tables[units1 * (maxUnits + 1) + units2].get();
+    if (!table) return false;
+
+    value = table->value(table->getIndexer().index(player1, player2, toMove));
+    return true;
+}
+
+TablebaseProbe TablebaseSet::probe(const GameBoard& board) const {
+    TablebaseProbe result;
+    if (&board.getTopology() != topology || board.isGameOver()) return result;
+
+    // A unit under the three-move rule may be banned from the table's move
+    NodeMask units = board.getPieces(PLAYER1) | board.getPieces(PLAYER2);
+    for (NodeMask m = units; m; m &= m - 1) {
+        if (board.getHistoryCount(lowestNode(m)) >= 2) return result;
+    }
+
+    TablebaseValue value = 0;
+    if (!lookup(board.getPieces(PLAYER1), board.getPieces(PLAYER2), board.getCurrentPlayer(), value)) return result;
+
+    if (value == 0) {
+        result.outcome = TB_DRAW;
+    }
+    else {
+        result.outcome = (value > 0) ? TB_WIN : TB_LOSS;
+        result.plies = (value > 0) ? value - 1 : -value - 1;
+    }
+    return result;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GameBoard.h"
+
+// Stored value of a position for the side to move: 0 draw, n + 1 a win in
+// n plies, -(n + 1) a loss in n plies, both with best play.
+typedef int16_t TablebaseValue;
+
+enum TablebaseOutcome { TB_UNKNOWN = 0, TB_WIN, TB_LOSS, TB_DRAW };
+
+struct TablebaseProbe {
+    TablebaseOutcome outcome;
+    int plies;                  // to the end of the game, for TB_WIN and TB_LOSS
+
+    TablebaseProbe() : outcome(TB_UNKNOWN), plies(0) {}
+};
+
+// Numbers the positions of one material class (units of player 1 and 2 on
+// a board of nodeCount nodes): combination rank of the player 1 nodes, then
+// of the player 2 nodes among the nodes left free, then the side to move.
+class TablebaseIndexer {
+public:
+    TablebaseIndexer();
+    TablebaseIndexer(int nodeCount, int units1, int units2);
+
+    uint64_t size() const { return total; }
+    int getUnits(Player player) const { return units[player]; }
+
+    uint64_t index(NodeMask player1, NodeMask player2, Player toMove) const;
+    void position(uint64_t index, NodeMask& player1, NodeMask& player2, Player& toMove) const;
+
+private:
+    int nodes;
+    int units[3];
+    uint64_t player2Count;      // placements of player 2 per placement of player 1
+    uint64_t total;
+};
+
+// Read-only file mapping
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& path, std::string& error);
+    const unsigned char* data() const { return base; }
+    uint64_t size() const { return length; }
+
+private:
+    void* file;
+    void* mapping;
+    int descriptor;
+    const unsigned char* base;
+    uint64_t length;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+// One material class on disk, memory-mapped.
+//
+// File "tb_<units1>v<units2>.bwtb", little endian:
+//   "BWTB0001", uint32 rows, cols, units1, units2, uint64 topology key,
+//   uint64 positions, uint32 block size, uint32 block count,
+//   uint64 offsets[block count + 1] into the data that follows.
+// Values are zigzag varints. A block starts with its kind: 0 run-length
+// codes it as (varint run, value) pairs, 1 packs it as uint8 bits, varint
+// dictionary size, the sorted dictionary, then one bits-wide code per value,
+// least significant bit first. The generator keeps whichever is smaller.
+class Tablebase {
+public:
+    Tablebase();
+
+    static std::string fileName(int units1, int units2);
+    static bool write(const std::string& path, const BoardTopology& topology, int units1, int units2,
+        const std::vector<TablebaseValue>& values, std::string& error);
+
+    bool open(const std::string& path, const BoardTopology& topology, std::string& error);
+
+    const TablebaseIndexer& getIndexer() const { return indexer; }
+    TablebaseValue value(uint64_t index) const;
+
+private:
+    MappedFile file;
+    TablebaseIndexer indexer;
+    uint32_t blockSize;
+    uint32_t blockCount;
+    const unsigned char* offsets;
+    const unsigned char* blocks;
+};
+
+uint64_t topologyKey(const BoardTopology& topology);
+
+// All tables of a directory for one topology. Classes where neither side
+// has enough units to fill its goal row need no file: nothing can be won
+// there, since no unit is ever revived.
+//
+// The tables are built without the three-move rule and ignore killed
+// counts, which no longer affect play once revival is impossible; results
+// are exact for positions whose move history restricts nothing.
+class TablebaseSet {
+public:
+    TablebaseSet();
+
+    bool load(const std::string& directory, const BoardTopology& topology, std::string& error);
+    bool isLoaded() const { return topology != nullptr; }
+    size_t getTableCount() const;
+
+    // False if the class is neither trivial nor loaded
+    bool lookup(NodeMask player1, NodeMask player2, Player toMove, TablebaseValue& value) const;
+    // TB_UNKNOWN for finished games, positions outside the tables and
+    // positions where the three-move rule restricts a unit
+    TablebaseProbe probe(const GameBoard& board) const;
+
+private:
+    const BoardTopology* topology;
+    int maxUnits;
+    int goalWidth[3];
+    std::vector<std::unique_ptr<Tablebase>> tables;    // [units1 * (maxUnits + 1) + units2]
+};
@@ -0,0 +1,316 @@
+#include "TablebaseGen.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    const int MAX_PLIES = 32000;            // distances must fit a TablebaseValue
+    const uint64_t CHUNK = 1 << 16;
+
+    Player opponent(Player player) {
+        return (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+
+    Player winnerOf(const BoardTopology& topology, NodeMask player1, NodeMask player2) {
+        if ((player1 & topology.goalMask[PLAYER1]) == topology.goalMask[PLAYER1]) return PLAYER1;
+        if ((player2 & topology.goalMask[PLAYER2]) == topology.goalMask[PLAYER2]) return PLAYER2;
+        return NONE;
+    }
+
+    // Runs body(begin, end) over [0, count) in chunks on all threads
+    template <typename Body>
+    void parallelFor(int threads, uint64_t count, const Body& body) {
+        std::atomic<uint64_t> next(0);
+        auto worker = [&]() {
+            for (;;) {
+                uint64_t begin = next.fetch_add(CHUNK);
+                if (begin >= count) return;
+                body(begin, std::min(count, begin + CHUNK));
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; i++) pool.emplace_back(worker);
+        worker();
+        for (auto& thread : pool) thread.join();
+    }
+
+    int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+// One class being solved. values[] holds the final TablebaseValue of each
+// position, or 0 while unresolved; a win found through a shot is stored right
+// away and may still be replaced by a shorter one. remaining[] counts the
+// moves inside the class not yet known to lose, plus one if some move leaves
+// the class without losing, so a position reaching 0 is lost.
+struct TablebaseGenerator::Context {
+    const BoardTopology& topology;
+    const TablebaseSet& known;
+    TablebaseIndexer indexer;
+    std::vector<TablebaseValue> values;
+    std::vector<uint8_t> remaining;
+    std::atomic<int> maxPlies;
+    std::atomic<bool> failed;
+    std::mutex errorLock;
+    std::string error;
+
+    Context(const BoardTopology& rules, const TablebaseSet& tables, int units1, int units2) :
+        topology(rules), known(tables), indexer(rules.nodeCount(), units1, units2),
+        values(indexer.size(), 0), remaining(indexer.size(), 0), maxPlies(0), failed(false) {}
+
+    void fail(const std::string& message) {
+        std::lock_guard<std::mutex> guard(errorLock);
+        if (!failed.exchange(true)) error = message;
+    }
+
+    void noteValue(TablebaseValue value) {
+        int plies = std::abs((int)value) - 1;
+        int seen = maxPlies.load(std::memory_order_relaxed);
+        while (plies > seen && !maxPlies.compare_exchange_weak(seen, plies)) {}
+    }
+
+    // Sorts the moves of toMove: those staying in the class are counted, the
+    // shots looked up in the smaller tables. A side without moves passes,
+    // which stays in the class too.
+    bool scanMoves(NodeMask player1, NodeMask player2, Player toMove,
+        int& inClass, int& shortestWin, int& longestLoss, bool& escape) {
+        NodeMask pieces[3] = { 0, player1, player2 };
+        Player enemy = opponent(toMove);
+        NodeMask empty = ~(player1 | player2);
+        bool anyMove = false;
+
+        inClass = 0;
+        shortestWin = MAX_PLIES + 1;
+        longestLoss = 0;
+        escape = false;
+
+        for (NodeMask own = pieces[toMove]; own; own &= own - 1) {
+            int from = lowestNode(own);
+            for (NodeMask targets = topology.adjacencyMask[from] & empty; targets; targets &= targets - 1) {
+                int to = lowestNode(targets);
+                anyMove = true;
+
+                NodeMask victims = topology.adjacencyMask[to] & pieces[enemy];
+                if ((topology.goalMask[toMove] & nodeBit(to)) || !victims) {
+                    inClass++;
+                    continue;
+                }
+
+                NodeMask after[3] = { 0, player1, player2 };
+                after[toMove] ^= nodeBit(from) | nodeBit(to);
+                after[enemy] ^= nodeBit(lowestNode(victims));
+
+                TablebaseValue value;
+                if (!known.lookup(after[PLAYER1], after[PLAYER2], enemy, value)) {
+                    fail("missing table " + Tablebase::fileName(countNodes(after[PLAYER1]), countNodes(after[PLAYER2])));
+                    return false;
+                }
+
+                if (value < 0) shortestWin = std::min(shortestWin, -value);
+                else if (value == 0) escape = true;
+                else longestLoss = std::max(longestLoss, (int)value);
+            }
+        }
+
+        if (!anyMove) inClass = 1;
+        return true;
+    }
+
+    void initRange(uint64_t begin, uint64_t end) {
+        for (uint64_t index = begin; index < end && !failed.load(std::memory_order_relaxed); index++) {
+            NodeMask player1, player2;
+            Player toMove;
+            indexer.position(index, player1, player2, toMove);
+
+            Player winner = winnerOf(topology, player1, player2);
+            if (winner != NONE) {
+                values[index] = (winner == toMove) ? 1 : -1;
+                continue;
+            }
+
+            int inClass, shortestWin, longestLoss;
+            bool escape;
+            if (!scanMoves(player1, player2, toMove, inClass, shortestWin, longestLoss, escape)) return;
+
+            bool winning = shortestWin <= MAX_PLIES;
+            int count = inClass + ((escape || winning) ? 1 : 0);
+            if (count > 255) {
+                fail("too many moves in one position");
+                return;
+            }
+            remaining[index] = (uint8_t)count;
+
+            if (winning) {
+                values[index] = (TablebaseValue)(shortestWin + 1);
+                noteValue(values[index]);
+            }
+            else if (count == 0) {
+                values[index] = (TablebaseValue)-(longestLoss + 1);
+                noteValue(values[index]);
+            }
+        }
+    }
+
+    // A predecessor of a position decided at plies
+    void reach(uint64_t index, NodeMask player1, NodeMask player2, Player toMove, bool childLost, int plies) {
+        std::atomic_ref<TablebaseValue> value(values[index]);
+
+        if (childLost) {
+            TablebaseValue win = (TablebaseValue)(plies + 2);
+            TablebaseValue current = value.load(std::memory_order_relaxed);
+            while (current == 0 || current > win) {
+                if (value.compare_exchange_weak(current, win, std::memory_order_relaxed)) {
+                    noteValue(win);
+                    return;
+                }
+            }
+            return;
+        }
+
+        std::atomic_ref<uint8_t> count(remaining[index]);
+        if (count.fetch_sub(1, std::memory_order_relaxed) != 1) return;
+
+        int inClass, shortestWin, longestLoss;
+        bool escape;
+        if (!scanMoves(player1, player2, toMove, inClass, shortestWin, longestLoss, escape)) return;
+
+        int loss = std::max(plies + 1, longestLoss);
+        if (loss >= MAX_PLIES) {
+            fail("distance too long for the table format");
+            return;
+        }
+        value.store((TablebaseValue)-(loss + 1), std::memory_order_relaxed);
+        noteValue((TablebaseValue)-(loss + 1));
+    }
+
+    // Un-makes every move into the positions decided at plies. Only moves
+    // without a shot can have led here; a shot leaves the class.
+    void sweepRange(uint64_t begin, uint64_t end, int plies) {
+        for (uint64_t index = begin; index < end && !failed.load(std::memory_order_relaxed); index++) {
+            TablebaseValue value = std::atomic_ref<TablebaseValue>(values[index]).load(std::memory_order_relaxed);
+            if (value != plies + 1 && value != -(plies + 1)) continue;
+
+            NodeMask pieces[3];
+            Player toMove;
+            indexer.position(index, pieces[PLAYER1], pieces[PLAYER2], toMove);
+            Player mover = opponent(toMove);
+            NodeMask occupied = pieces[PLAYER1] | pieces[PLAYER2];
+            bool lost = value < 0;
+
+            for (NodeMask own = pieces[mover]; own; own &= own - 1) {
+                int to = lowestNode(own);
+                if (!(topology.goalMask[mover] & nodeBit(to)) && (topology.adjacencyMask[to] & pieces[toMove])) continue;
+
+                for (NodeMask sources = topology.reverseAdjacencyMask[to] & ~occupied; sources; sources &= sources - 1) {
+                    NodeMask before[3] = { 0, pieces[PLAYER1], pieces[PLAYER2] };
+                    before[mover] ^= nodeBit(to) | nodeBit(lowestNode(sources));
+                    if (winnerOf(topology, before[PLAYER1], before[PLAYER2]) != NONE) continue;
+
+                    reach(indexer.index(before[PLAYER1], before[PLAYER2], mover),
+                        before[PLAYER1], before[PLAYER2], mover, lost, plies);
+                }
+            }
+
+            // The mover may also have passed, if it had no move at all
+            if (winnerOf(topology, pieces[PLAYER1], pieces[PLAYER2]) != NONE) continue;
+            bool blocked = true;
+            for (NodeMask own = pieces[mover]; own && blocked; own &= own - 1) {
+                if (topology.adjacencyMask[lowestNode(own)] & ~occupied) blocked = false;
+            }
+            if (blocked) {
+                reach(indexer.index(pieces[PLAYER1], pieces[PLAYER2], mover),
+                    pieces[PLAYER1], pieces[PLAYER2], mover, lost, plies);
+            }
+        }
+    }
+};
+
+TablebaseGenerator::TablebaseGenerator(const BoardTopology& rules, const TablebaseGenConfig& generatorConfig) :
+    topology(rules), config(generatorConfig) {
+    threadCount = (config.threads > 0) ? config.threads : std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+bool TablebaseGenerator::isTrivial(int units1, int units2) const {
+    return units1 < countNodes(topology.goalMask[PLAYER1]) && units2 < countNodes(topology.goalMask[PLAYER2]);
+}
+
+bool TablebaseGenerator::run(const TablebaseClassCallback& onClass, std::string& error) {
+    int startUnits = std::max(countNodes(topology.startMask[PLAYER1]), countNodes(topology.startMask[PLAYER2]));
+    int units = (config.units > 0) ? config.units : startUnits;
+    if (units > startUnits) {
+        error = "at most " + std::to_string(startUnits) + " units per side on this board";
+        return false;
+    }
+
+    std::error_code code;
+    std::filesystem::create_directories(config.directory, code);
+    if (!known.load(config.directory, topology, error)) return false;
+
+    for (int total = 0; total <= 2 * units; total++) {
+        for (int units1 = std::min(units, total); units1 >= 0 && total - units1 <= units; units1--) {
+            int units2 = total - units1;
+            if (isTrivial(units1, units2) || total > topology.nodeCount()) continue;
+
+            TablebaseClassStats stats = TablebaseClassStats();
+            stats.units1 = units1;
+            stats.units2 = units2;
+
+            std::string path = (std::filesystem::path(config.directory) / Tablebase::fileName(units1, units2)).string();
+            if (!config.rebuild && std::filesystem::exists(path, code)) {
+                stats.positions = TablebaseIndexer(topology.nodeCount(), units1, units2).size();
+                stats.fileBytes = std::filesystem::file_size(path, code);
+                stats.existing = true;
+            }
+            else {
+                if (!generateClass(units1, units2, stats, error)) return false;
+                if (!known.load(config.directory, topology, error)) return false;
+            }
+            if (onClass) onClass(stats);
+        }
+    }
+    return true;
+}
+
+bool TablebaseGenerator::generateClass(int units1, int units2, TablebaseClassStats& stats, std::string& error) {
+    int64_t startMs = nowMs();
+    Context context(topology, known, units1, units2);
+    uint64_t count = context.indexer.size();
+
+    parallelFor(threadCount, count, [&](uint64_t begin, uint64_t end) { context.initRange(begin, end); });
+
+    for (int plies = 0; plies <= context.maxPlies.load() && !context.failed.load(); plies++) {
+        parallelFor(threadCount, count, [&](uint64_t begin, uint64_t end) { context.sweepRange(begin, end, plies); });
+    }
+
+    if (context.failed.load()) {
+        error = context.error;
+        return false;
+    }
+
+    // Whatever was never decided is a draw
+    stats.positions = count;
+    for (uint64_t index = 0; index < count; index++) {
+        TablebaseValue value = context.values[index];
+        if (value > 0) stats.wins++;
+        else if (value < 0) stats.losses++;
+        else stats.draws++;
+    }
+    stats.longestPlies = context.maxPlies.load();
+
+    std::string path = (std::filesystem::path(config.directory) / Tablebase::fileName(units1, units2)).string();
+    context.remaining = std::vector<uint8_t>();
+    if (!Tablebase::write(path, topology, units1, units2, context.values, error)) return false;
+
+    std::error_code code;
+    stats.fileBytes = std::filesystem::file_size(path, code);
+    stats.timeMs = nowMs() - startMs;
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "Tablebase.h"
+
+struct TablebaseGenConfig {
+    int units;                  // largest unit count per side; 0 = the start row
+    int threads;                // 0 = one per core
+    std::string directory;
+    bool rebuild;               // regenerate classes that already have a file
+
+    TablebaseGenConfig() : units(0), threads(0), rebuild(false) {}
+};
+
+struct TablebaseClassStats {
+    int units1, units2;
+    uint64_t positions;
+    uint64_t wins, losses, draws;     // for the side to move
+    int longestPlies;                 // longest forced win or loss
+    uint64_t fileBytes;
+    int64_t timeMs;
+    bool existing;                    // file was already there and kept
+};
+
+typedef std::function<void(const TablebaseClassStats&)> TablebaseClassCallback;
+
+// Solves every material class with up to config.units units per side by
+// retrograde analysis and writes one Tablebase file per class. Classes are
+// built in order of total units, so the positions after a shot are always
+// found in tables written before (or are trivially drawn).
+//
+// Each class is solved in memory: a pass over all positions marks the
+// finished games and counts the moves that stay in the class, then plies are
+// swept outwards from the finished games, un-making moves to reach the
+// positions one ply further away. Both passes are split over threads.
+class TablebaseGenerator {
+public:
+    TablebaseGenerator(const BoardTopology& topology, const TablebaseGenConfig& config);
+
+    bool run(const TablebaseClassCallback& onClass, std::string& error);
+
+private:
+    struct Context;
+
+    const BoardTopology& topology;
+    TablebaseGenConfig config;
+    int threadCount;
+    TablebaseSet known;         // tables finished so far
+
+    bool isTrivial(int units1, int units2) const;
+    bool generateClass(int units1, int units2, TablebaseClassStats& stats, std::string& error);
+};
@@ -0,0 +1,213 @@
+#include "Trace.h"
+
+#if defined(BOWERS_TRACE)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    const size_t TRACE_RING_EVENTS = 1 << 16;   // per thread, a power of two
+
+    // Written only by the owning thread; fields are atomics so a concurrent
+    // dump is a well-defined read that may just see a torn event, which the
+    // sequence check below throws away.
+    struct TraceEvent {
+        std::atomic<const char*> name;
+        std::atomic<const char*> argName;
+        std::atomic<int64_t> arg;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> end;
+    };
+
+    struct ThreadRing {
+        int tid;
+        bool inUse;                         // owned by a live thread; under registryMutex
+        std::atomic<const char*> threadName;
+        std::atomic<uint64_t> written;      // events ever recorded
+        std::atomic<uint64_t> clearedAt;    // events before this were cleared
+        TraceEvent events[TRACE_RING_EVENTS];
+
+        explicit ThreadRing(int id) : tid(id), inUse(true), threadName(nullptr), written(0), clearedAt(0) {}
+    };
+
+    struct EventCopy {
+        const char* name;
+        const char* argName;
+        int64_t arg;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // A thread gets a ring with its first recorded event, so threads that
+    // never record while tracing is on cost nothing. Rings are kept when
+    // their thread exits, so a dump still shows its events, and are handed
+    // to the next thread that records: memory is bounded by the number of
+    // threads recording at once, not by how many were ever started (the
+    // engine starts one per search).
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+
+    struct RingOwner {
+        ThreadRing* ring = nullptr;
+        const char* name = nullptr;
+
+        ~RingOwner() {
+            if (ring) {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                ring->inUse = false;
+            }
+        }
+    };
+
+    thread_local RingOwner localRing;
+
+    const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+    ThreadRing* currentRing() {
+        if (!localRing.ring) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto& ring : rings) {
+                if (!ring->inUse) {
+                    ring->inUse = true;
+                    localRing.ring = ring.get();
+                    break;
+                }
+            }
+            if (!localRing.ring) {
+                rings.emplace_back(new ThreadRing((int)rings.size() + 1));
+                localRing.ring = rings.back().get();
+            }
+            localRing.ring->threadName.store(localRing.name, std::memory_order_relaxed);
+        }
+        return localRing.ring;
+    }
+
+    void writeString(FILE* file, const char* text) {
+        fputc('"', file);
+        for (const char* p = text; *p; p++) {
+            if (*p == '"' || *p == '\\') fputc('\\', file);
+            fputc(*p, file);
+        }
+        fputc('"', file);
+    }
+
+    // Copies the live part of a ring, dropping events the writer may have
+    // overwritten while they were being read.
+    void snapshot(const ThreadRing& ring, std::vector<EventCopy>& out) {
+        uint64_t end = ring.written.load(std::memory_order_acquire);
+        uint64_t begin = std::max(ring.clearedAt.load(std::memory_order_relaxed),
+            end > TRACE_RING_EVENTS ? end - TRACE_RING_EVENTS : 0);
+
+        size_t first = out.size();
+        for (uint64_t i = begin; i < end; i++) {
+            const TraceEvent& e = ring.events[i & (TRACE_RING_EVENTS - 1)];
+            EventCopy copy;
+            copy.name = e.name.load(std::memory_order_relaxed);
+            copy.argName = e.argName.load(std::memory_order_relaxed);
+            copy.arg = e.arg.load(std::memory_order_relaxed);
+            copy.start = e.start.load(std::memory_order_relaxed);
+            copy.end = e.end.load(std::memory_order_relaxed);
+            out.push_back(copy);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring.written.load(std::memory_order_relaxed);
+
+        // Index i is intact while the writer has not reached i + RING
+        uint64_t firstIntact = (after >= TRACE_RING_EVENTS) ? after - TRACE_RING_EVENTS + 1 : 0;
+        if (firstIntact > begin) {
+            size_t torn = (size_t)std::min<uint64_t>(firstIntact - begin, end - begin);
+            out.erase(out.begin() + first, out.begin() + first + torn);
+        }
+    }
+}
+
+namespace Trace {
+    std::atomic<bool> enabledFlag(false);
+
+    void setEnabled(bool enabled) {
+        enabledFlag.store(enabled, std::memory_order_relaxed);
+    }
+
+    void setThreadName(const char* name) {
+        localRing.name = name;
+        if (localRing.ring) localRing.ring->threadName.store(name, std::memory_order_relaxed);
+    }
+
+    uint64_t nowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - traceEpoch).count();
+    }
+
+    void record(const char* name, uint64_t startNs, uint64_t endNs, const char* argName, int64_t argValue) {
+        ThreadRing* ring = currentRing();
+        uint64_t index = ring->written.load(std::memory_order_relaxed);
+        TraceEvent& e = ring->events[index & (TRACE_RING_EVENTS - 1)];
+
+        e.name.store(name, std::memory_order_relaxed);
+        e.argName.store(argName, std::memory_order_relaxed);
+        e.arg.store(argValue, std::memory_order_relaxed);
+        e.start.store(startNs, std::memory_order_relaxed);
+        e.end.store(endNs, std::memory_order_relaxed);
+
+        ring->written.store(index + 1, std::memory_order_release);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& ring : rings) {
+            ring->clearedAt.store(ring->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    bool dump(const char* path) {
+        FILE* file = fopen(path, "w");
+        if (!file) return false;
+
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool firstLine = true;
+        auto separator = [&]() {
+            if (!firstLine) fprintf(file, ",\n");
+            firstLine = false;
+        };
+
+        std::vector<EventCopy> events;
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        for (const auto& ring : rings) {
+            const char* threadName = ring->threadName.load(std::memory_order_relaxed);
+            if (threadName) {
+                separator();
+                fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", ring->tid);
+                writeString(file, threadName);
+                fprintf(file, "}}");
+            }
+
+            events.clear();
+            snapshot(*ring, events);
+
+            for (const auto& e : events) {
+                separator();
+                fprintf(file, "{\"name\":");
+                writeString(file, e.name);
+                fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    ring->tid, e.start / 1000.0, (e.end - e.start) / 1000.0);
+                if (e.argName) {
+                    fprintf(file, ",\"args\":{");
+                    writeString(file, e.argName);
+                    fprintf(file, ":%lld}", (long long)e.arg);
+                }
+                fprintf(file, "}");
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+        return fclose(file) == 0;
+    }
+}
+
+#endif
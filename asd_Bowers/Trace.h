@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Scoped timing markers exported as Chrome / Perfetto trace JSON
+// (load the file in chrome://tracing or ui.perfetto.dev).
+//
+//   TRACE_SCOPE("render");
+//   TRACE_SCOPE_ARG("search.iteration", "depth", depth);
+//
+// Names must be string literals. Each thread writes into its own ring of
+// the most recent TRACE_RING_EVENTS events without locking; dumping copies
+// the rings while they are being written and skips anything overwritten
+// meanwhile. Rings of exited threads are reused, so short-lived threads of
+// the same kind share one row. Both projects define BOWERS_TRACE in every
+// configuration, Release included, so field builds can record hitches;
+// recording starts off, and a disabled trace costs one relaxed load per
+// scope and allocates nothing. Without BOWERS_TRACE the macros compile to
+// nothing.
+
+#if defined(BOWERS_TRACE)
+
+namespace Trace {
+    extern std::atomic<bool> enabledFlag;
+
+    inline bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    // Shown as the thread's row name; the name must outlive the trace.
+    // Allocates nothing; the ring comes with the first recorded event.
+    void setThreadName(const char* name);
+
+    // Writes everything recorded so far; false if the file can't be written
+    bool dump(const char* path);
+    void clear();
+
+    uint64_t nowNs();
+    void record(const char* name, uint64_t startNs, uint64_t endNs, const char* argName, int64_t argValue);
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* eventName, const char* eventArgName = nullptr, int64_t eventArg = 0)
+        : name(nullptr), argName(eventArgName), arg(eventArg), start(0) {
+        if (Trace::isEnabled()) {
+            name = eventName;
+            start = Trace::nowNs();
+        }
+    }
+
+    ~TraceScope() {
+        if (name) Trace::record(name, start, Trace::nowNs(), argName, arg);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* argName;
+    int64_t arg;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, argName, value) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, argName, (int64_t)(value))
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+
+#else
+
+namespace Trace {
+    inline bool isEnabled() { return false; }
+    inline void setEnabled(bool) {}
+    inline bool dump(const char*) { return false; }
+    inline void clear() {}
+}
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_ARG(name, argName, value) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
@@ -1,8 +1,77 @@
 #include "Game.h"
+#include "Bench.h"
+#include "HeadlessRender.h"
+#include "Trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 int main(int argc, char* argv[]) {
+    // Headless benchmark: bench [depth]
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return runBench(argc > 2 ? atoi(argv[2]) : 0);
+    }
+
+    // Headless rendering of positions and games: render <input file> [options]
+    if (argc > 1 && strcmp(argv[1], "render") == 0) {
+        return runRender(argc, argv);
+    }
+
     Game game;
 
+    // Optional rule variant: --board <description file>
+    // Optional trace recording: --trace <output file>
+    // Optional solved positions for the AI: --proof <solver directory>
+    // Optional endgame tablebases for the AI: --tb <tbgen directory>
+    // Optional evaluation network for the AI: --nnue <weights file>
+    // Optional spectator wall of AI-vs-AI games: --spectate <games>
+    static BoardTopology topology;
+    const char* tablebaseDir = nullptr;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) {
+            // Record from the start; written on exit or when T is pressed
+            game.setTracePath(argv[i + 1]);
+            Trace::setEnabled(true);
+        }
+        else if (strcmp(argv[i], "--board") == 0) {
+            std::string error;
+            if (!topology.loadFromFile(argv[i + 1], error)) {
+                fprintf(stderr, "%s: %s\n", argv[i + 1], error.c_str());
+                return 1;
+            }
+            game.setTopology(topology);
+        }
+        else if (strcmp(argv[i], "--proof") == 0) {
+            std::string error;
+            if (!game.loadProofTable(argv[i + 1], error)) {
+                fprintf(stderr, "%s: %s\n", argv[i + 1], error.c_str());
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--tb") == 0) {
+            tablebaseDir = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--spectate") == 0) {
+            game.setSpectator(atoi(argv[i + 1]));
+        }
+        else if (strcmp(argv[i], "--nnue") == 0) {
+            std::string error;
+            if (!game.loadNetwork(argv[i + 1], error)) {
+                fprintf(stderr, "%s: %s\n", argv[i + 1], error.c_str());
+                return 1;
+            }
+        }
+    }
+
+    // Tables belong to a board, so load them once --board has been seen
+    if (tablebaseDir) {
+        std::string error;
+        if (!game.loadTablebases(tablebaseDir, error)) {
+            fprintf(stderr, "%s: %s\n", tablebaseDir, error.c_str());
+            return 1;
+        }
+    }
+
     if (!game.init()) {
         return 1;
     }